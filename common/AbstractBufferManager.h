@@ -171,6 +171,23 @@ public:
     // OPTIONAL.
     virtual uint32_t realizeBuffer( buffer_handle_t handle ) = 0;
 
+    // Result of analysing the alpha channel of a buffer's content.
+    enum EContentAlpha {
+        eContentAlpha_Unknown = 0,      // Not analysed, or the content has changed since.
+        eContentAlpha_Opaque,           // Every pixel has alpha 0xFF.
+        eContentAlpha_Translucent,      // At least one pixel is not fully opaque.
+    };
+
+    // Record the result of analysing a buffer's current content.
+    // The result is held with the buffer's tracking state and is discarded when the buffer is freed.
+    // The caller must reset it to eContentAlpha_Unknown when new content is queued to the buffer.
+    // OPTIONAL.
+    virtual void setBufferContentAlpha( buffer_handle_t handle, EContentAlpha alpha ) = 0;
+
+    // Get the result last recorded by setBufferContentAlpha.
+    // OPTIONAL.
+    virtual EContentAlpha getBufferContentAlpha( buffer_handle_t handle ) = 0;
+
     // Dump info about the buffermanager.
     virtual String8 dump( void ) = 0;
 };
@@ -85,6 +85,11 @@ public:
     // previously from onEvaluate(), or NULL if no state was provided.
     virtual void onCompose(const Content::LayerStack& src, const Layer& target, AbstractComposer::CompositionState* pState ) = 0;
 
+    // Returns true if onCompose may be called from a worker thread, concurrently with compositions
+    // on other composers. The CompositionManager never enters any one composer concurrently,
+    // including its onAcquire and onRelease, which are serialised with onCompose.
+    virtual bool isConcurrentComposeSupported() const { return false; }
+
     // Acquire/Release any resources required for the specified composition.
     // onAcquire must return non-NULL on success.
     // Any acquired resources must be explicitly released when they are no-longer required.
@@ -51,6 +51,10 @@ public:
     // is already valid for the current state
     virtual void onCompose() = 0;
 
+    // Wait for the work started by onCompose to complete. The CompositionManager may hand
+    // compositions to worker threads, so the target must not be used until this returns.
+    virtual void waitCompose() {}
+
     // Acquire and release any resources required for this composition.
     // Acquire can fail if the resources required are already committed elsewhere.
     virtual bool onAcquire() = 0;
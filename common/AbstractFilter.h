@@ -44,6 +44,15 @@ public:
     // layer list in some way
     virtual const Content& onApply(const Content& ref) = 0;
 
+    // Output memoization.
+    // A filter whose output depends only on its input content and on some other state that it
+    // can summarise (eg options) may return true and set signature to a value that changes
+    // whenever that other state changes. If the input content generation and the signature are
+    // both unchanged since the last call, the FilterManager skips onApply and reuses the previous
+    // output. Filters with per-frame state (counters, timers, deferred work) must return false.
+    // Only honoured for filters in SF display space.
+    virtual bool getDependencySignature( uint64_t& /*signature*/ ) const { return false; }
+
     // Called once displays are ready but before first frame(s).
     // This provides the filter with the context (Hwc) if it is required and
     // also gives the filter opportunity to run one-time initialization.
@@ -30,9 +30,12 @@ LOCAL_SRC_FILES :=                      \
     DisplayQueue.cpp                    \
     EmptyFilter.cpp                     \
     FakeDisplay.cpp                     \
+    FenceLatencyTracker.cpp             \
     FilterManager.cpp                   \
+    FrameArena.cpp                      \
     GlCellComposer.cpp                  \
     GlobalScalingFilter.cpp             \
+    HotPathStats.cpp                    \
     Hwc.cpp                             \
     HwcService.cpp                      \
     InputAnalyzer.cpp                   \
@@ -40,26 +43,34 @@ LOCAL_SRC_FILES :=                      \
     LayerBlanker.cpp                    \
     LogicalDisplay.cpp                  \
     LogicalDisplayManager.cpp           \
+    OcclusionFilter.cpp                 \
+    OpaqueDetectionFilter.cpp           \
     Option.cpp                          \
     OptionManager.cpp                   \
     PartitionedComposer.cpp             \
     PassthroughDisplay.cpp              \
     PersistentRegistry.cpp              \
+    PixelScan.cpp                       \
     PhysicalDisplay.cpp                 \
     PhysicalDisplayManager.cpp          \
     PlaneAllocatorJB.cpp                \
     PlaneComposition.cpp                \
     Rotate180Filter.cpp                 \
+    ScanPool.cpp                        \
     SoftwareVsyncThread.cpp             \
+    SolidColorFilter.cpp                \
     SurfaceFlingerComposer.cpp          \
     SurfaceFlingerProcs.cpp             \
+    ThreadManager.cpp                   \
     Timeline.cpp                        \
     Timer.cpp                           \
     Transform.cpp                       \
     TransparencyFilter.cpp              \
+    VSyncPhaseScheduler.cpp             \
     VideoModeDetectionFilter.cpp        \
     VirtualDisplay.cpp                  \
-    VisibleRectFilter.cpp
+    VisibleRectFilter.cpp               \
+    WorkerPool.cpp
 
 # Compile in debug support if this is an engineering build
 ifeq ($(strip $(INTEL_HWC_INTERNAL_BUILD)),true)
@@ -169,6 +169,10 @@ uint32_t BufferManager::purgeBuffer( buffer_handle_t /*handle*/ ) { return 0; }
 
 uint32_t BufferManager::realizeBuffer( buffer_handle_t /*handle*/ ) { return 0; }
 
+void BufferManager::setBufferContentAlpha( buffer_handle_t /*handle*/, EContentAlpha /*alpha*/ ) { }
+
+AbstractBufferManager::EContentAlpha BufferManager::getBufferContentAlpha( buffer_handle_t /*handle*/ ) { return eContentAlpha_Unknown; }
+
 }; // namespace hwc
 }; // namespace ufo
 }; // namespace intel
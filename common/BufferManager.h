@@ -100,6 +100,14 @@ public:
     // Returns zero if the call fails or is not implemented.
     // OPTIONAL.
     virtual uint32_t realizeBuffer( buffer_handle_t handle );
+
+    // Record the result of analysing a buffer's current content.
+    // OPTIONAL.
+    virtual void setBufferContentAlpha( buffer_handle_t handle, EContentAlpha alpha );
+
+    // Get the result last recorded by setBufferContentAlpha.
+    // OPTIONAL.
+    virtual EContentAlpha getBufferContentAlpha( buffer_handle_t handle );
 };
 
 }; // namespace hwc
@@ -16,6 +16,7 @@
 
 #include "AbstractBufferManager.h"
 #include "BufferQueue.h"
+#include "HotPathStats.h"
 
 namespace intel {
 namespace ufo {
@@ -507,6 +508,7 @@ uint32_t BufferQueue::getBlockedBuffers( uint32_t* pBitmask )
 
 BufferQueue::BufferHandle BufferQueue::dequeue(uint32_t width, uint32_t height, int32_t bufferFormat, uint32_t usage, Timeline::Fence** ppReleaseFence)
 {
+    HOTPATH_SCOPE( BUFFER_DEQUEUE );
     ALOGD_IF(BUFFERQUEUE_DEBUG, "BufferQueue::dequeue %dx%d %x %x", width, height, bufferFormat, usage);
     ALOG_ASSERT( mDequeuedBuffer == ~0U );
     Buffer* pBuffer;
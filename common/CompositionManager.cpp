@@ -16,6 +16,8 @@
 
 #include "Hwc.h"
 #include "CompositionManager.h"
+#include "HotPathStats.h"
+#include "VSyncPhaseScheduler.h"
 #include "Log.h"
 #include "Utils.h"
 #include "ufo/graphics.h"
@@ -51,7 +53,7 @@ static const uint32_t cReuseCompositionMs = 100;
 // There are multiple uses for this class. If a composition has been requested twice on a single HWC update,
 // this class allows us to return the same result as last time. Also if a composition from a previous frame
 // contains identical state (including the handle) then again we may reuse it.
-class CompositionManager::Composition : public AbstractComposition, public BufferQueue::BufferReference
+class CompositionManager::Composition : public AbstractComposition, public BufferQueue::BufferReference, public WorkerPool::Job
 {
 public:
 
@@ -72,6 +74,7 @@ public:
     void            onUpdateFences(const Content::LayerStack& src);
     void            onUpdateOutputLayer(const Layer& target);
     void            onCompose();
+    void            waitCompose();
     bool            onAcquire();
     void            onRelease();
 
@@ -91,6 +94,10 @@ public:
     // Implements BufferQueue::BufferReference.
     virtual         void referenceInvalidate( BufferQueue::BufferHandle handle );
 
+protected:
+    // Implements WorkerPool::Job.
+    virtual         void onRun();
+
 private:
     friend class CompositionManager;
 
@@ -100,6 +107,7 @@ private:
     void onUpdateBufferPavpSession();
     void onUpdateMediaTimestampFps();
     void expireBuffer( buffer_handle_t bufferHandle );
+    void updateHandleIndex( void );
 
 private:
     CompositionManager*                     mpCompositionManager;   // Pointer back to the manager
@@ -127,19 +135,32 @@ private:
 
     nsecs_t                                 mTimestamp;             // Timestamp for when this was last valid
     uint32_t                                mLocks;                 // A count of locks on this composition (a lock will keep the composition 'live')..
+    std::vector<buffer_handle_t>            mIndexedHandles;        // Sorted handles this composition is indexed under by the manager.
 
 
     bool                                    mbEvaluationValid:1;    // The evaluation was performed and is valid.
     bool                                    mbTargetValid:1;        // This indicates that the target needs to be regenerated as something changed.
     bool                                    mbTargetProvided:1;     // The target buffer was allocated externally and provided already.
     bool                                    mbConsiderForReuse:1;   // Anything left as invalid at the end of a frame should be marked for reuse in the next frame.
+    bool                                    mbComposePending:1;     // The composer call has been handed to the workers and not yet waited for.
+    uint32_t                                mComposeDisplay;        // Physical display the pending composer call was dispatched for.
+
+    // Speculative composition, started at the end of prepare from a copy of the source layers
+    // without fences and checked against the acquire fences at set.
+    std::vector<Layer>                      mSpeculativeLayers;
+    nsecs_t                                 mSpeculativeTime;       // When the speculative composition was started.
+    bool                                    mbSpeculative:1;        // mSourceStack currently refers to mSpeculativeLayers.
 };
 
 CompositionManager::Composition::Composition() :
     mpCompositionManager(NULL),
     mRenderTargetBuffer(NULL),
     mpComposerCompositionState(NULL),
-    mLocks(0)
+    mLocks(0),
+    mbComposePending(false),
+    mComposeDisplay(INVALID_DISPLAY_ID),
+    mSpeculativeTime(0),
+    mbSpeculative(false)
     // Initialization should be in the clear function
 {
     clear();
@@ -180,6 +201,7 @@ void CompositionManager::Composition::invalidateRenderTarget( void )
     setRenderTargetBuffer( NULL );
     mbTargetValid = false;
     mbTargetProvided = false;
+    updateHandleIndex();
 }
 
 void CompositionManager::Composition::referenceInvalidate( BufferQueue::BufferHandle handle )
@@ -198,6 +220,8 @@ void CompositionManager::Composition::referenceInvalidate( BufferQueue::BufferHa
 void CompositionManager::Composition::clear()
 {
     ALOG_ASSERT( !mLocks );
+    ALOG_ASSERT( !mbComposePending );
+    ALOG_ASSERT( !mbSpeculative );
     delete mpComposerCompositionState;
     mpComposerCompositionState = NULL;
     mpComposer              = NULL;
@@ -212,6 +236,8 @@ void CompositionManager::Composition::clear()
     mbTargetProvided        = false;
     setRenderTargetBuffer( NULL );
     mRenderTarget.clear();
+    mSourceLayers.clear();
+    updateHandleIndex();
 }
 
 bool CompositionManager::Composition::match(const Content::LayerStack& src, uint32_t width, uint32_t height, uint32_t format,
@@ -291,6 +317,16 @@ void CompositionManager::Composition::expireBuffer( buffer_handle_t bufferHandle
             mbTargetValid = false;
         }
     }
+    updateHandleIndex();
+}
+
+void CompositionManager::Composition::updateHandleIndex( void )
+{
+    // Compositions are not indexed until they are owned by the manager.
+    if ( mpCompositionManager )
+    {
+        mpCompositionManager->updateHandleIndex( *this );
+    }
 }
 
 void CompositionManager::Composition::onUpdateAll(const Content::LayerStack& src, uint32_t width, uint32_t height, uint32_t format, ECompressionType compression, nsecs_t timestamp)
@@ -375,6 +411,8 @@ void CompositionManager::Composition::onUpdateAll(const Content::LayerStack& src
     // Propagate media timestamp to the render target if required.
     onUpdateMediaTimestampFps();
 
+    updateHandleIndex();
+
     ALOG_ASSERT( mRenderTarget.getComposition() == this );
 }
 
@@ -397,11 +435,13 @@ void CompositionManager::Composition::onUpdate(const Content::LayerStack& src)
     ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::onUpdate: src %s", src.dump().string());
 
     // Run through the handles in the composition updating them if required
+    bool bHandlesChanged = false;
     for (uint32_t ly = 0; ly < mSourceLayers.size(); ly++)
     {
         Layer& internalCopy = mSourceLayers[ly];
         const Layer& inputLayer = src.getLayer(ly);
 
+        bHandlesChanged |= (internalCopy.getHandle() != inputLayer.getHandle());
         if (internalCopy.getHandle() != inputLayer.getHandle() || inputLayer.isComposition())
         {
             // The previous composition remains valid unless a handle changes
@@ -416,6 +456,11 @@ void CompositionManager::Composition::onUpdate(const Content::LayerStack& src)
         ALOGD_IF( COMPOSITION_DEBUG, "%u %s", ly, internalCopy.dump().string());
     }
 
+    if (bHandlesChanged)
+    {
+        updateHandleIndex();
+    }
+
     mbConsiderForReuse = false;
     if (mbTargetValid)
         Log::add(mSourceStack, mRenderTarget, "Smart Composition Reuse: ");
@@ -447,6 +492,7 @@ void CompositionManager::Composition::onUpdateOutputLayer(const Layer& target)
     mRenderTarget.setComposition( this );
     mbTargetProvided = true;
     mbTargetValid = false;
+    updateHandleIndex();
 
     ALOG_ASSERT( mRenderTarget.getComposition() == this );
 }
@@ -503,6 +549,9 @@ void CompositionManager::Composition::onCompose()
     ALOGD_IF( COMPOSITION_DEBUG, "%s", mSourceStack.dump().string());
     ALOGD_IF( COMPOSITION_DEBUG, "%s", mRenderTarget.dump(" T").string());
 
+    // A composition shared between displays may still be running for the first of them.
+    waitCompose();
+
     // Just in case no evaluation has been done yet, find an appropriate engine and forward
     if (!mbEvaluationValid)
     {
@@ -519,8 +568,11 @@ void CompositionManager::Composition::onCompose()
 
     if (!mbTargetValid)
     {
-        // Make sure that any composition elements in the source have been triggered correctly
+        // Make sure that any composition elements in the source have been triggered correctly.
+        // These are composed before we return so that our composer sees their results.
+        mpCompositionManager->mComposeDepth++;
         mSourceStack.onCompose();
+        mpCompositionManager->mComposeDepth--;
 
         if (!mbTargetProvided)
         {
@@ -547,6 +599,7 @@ void CompositionManager::Composition::onCompose()
 
             // Update the handle of the render target
             mRenderTarget.onUpdateFrameState(pGB->handle, mpCompositionManager->getTimestamp());
+            updateHandleIndex();
 
             // Queue this immediately, the release fence will be filled in later.
             mpCompositionManager->getBufferQueue().queue();
@@ -568,10 +621,12 @@ void CompositionManager::Composition::onCompose()
         mpCompositionManager->getBufferQueue().markUsed( mRenderTargetBuffer );
 
         AbstractBufferManager::get().requestCompression(mRenderTarget.getHandle(), mRenderTarget.getBufferCompression());
-        mpComposer->onCompose(mSourceStack, mRenderTarget, mpComposerCompositionState);
 
         mbTargetProvided = false;
         mbTargetValid = true;
+
+        // Run the composer now or hand it to the workers.
+        mpCompositionManager->dispatchCompose(*this);
     }
     else
     {
@@ -596,10 +651,33 @@ void CompositionManager::Composition::onCompose()
     ALOG_ASSERT( mRenderTarget.getComposition() == this );
 }
 
+void CompositionManager::Composition::waitCompose()
+{
+    if (mbComposePending)
+    {
+        mpCompositionManager->waitCompose(*this);
+    }
+}
+
+void CompositionManager::Composition::onRun()
+{
+    // Only hold compositions on the workers. If the primary thread runs it, the display is
+    // being set now.
+    if ((mComposeDisplay != INVALID_DISPLAY_ID) && (gettid() != mpCompositionManager->mPrimaryTid))
+    {
+        VSyncPhaseScheduler::get().waitForComposePhase(mComposeDisplay);
+    }
+    mpCompositionManager->runCompose(*this);
+}
+
 bool CompositionManager::Composition::onAcquire()
 {
     mRefCount++;
-    mComposerResource = mpComposer->onAcquire(mSourceStack, mRenderTarget);
+    {
+        // The composer may be composing for another composition on a worker.
+        Mutex::Autolock _l(mpCompositionManager->getComposerLock(mpComposer));
+        mComposerResource = mpComposer->onAcquire(mSourceStack, mRenderTarget);
+    }
 
     ALOG_ASSERT( mRenderTarget.getComposition() == this );
 
@@ -608,16 +686,35 @@ bool CompositionManager::Composition::onAcquire()
 
 void CompositionManager::Composition::onRelease()
 {
-    mpComposer->onRelease(mComposerResource);
+    {
+        Mutex::Autolock _l(mpCompositionManager->getComposerLock(mpComposer));
+        mpComposer->onRelease(mComposerResource);
+    }
     mRefCount--;
 }
 
 CompositionManager::CompositionManager() :
+    mOptionConcurrentCompose("concurrentcompose", 1),
+    mOptionSpeculativeCompose("speccompose", 1, false),
+    mComposePool("hwc_compose", cComposeWorkers, PRIORITY_URGENT_DISPLAY),
+    mbConcurrentCompose(false),
+    mComposeDisplay(INVALID_DISPLAY_ID),
+    mComposeDepth(0),
+    mbSpeculating(false),
+    mConcurrentCompositions(0),
+    mSpeculativeCompositions(0),
+    mSpeculativeDiscards(0),
     mPrimaryTid(0),
     mTimestamp(0)
 {
     // This should always be the first composer in the array
-    mpComposers.push_back(&mSurfaceFlingerComposer);
+    add(&mSurfaceFlingerComposer);
+}
+
+void CompositionManager::add(AbstractComposer* pComposer)
+{
+    mpComposers.push_back(pComposer);
+    mpComposerLocks.emplace_back(new Mutex);
 }
 
 CompositionManager::~CompositionManager()
@@ -653,6 +750,9 @@ void CompositionManager::onPrepareBegin(size_t numDisplays, hwc_display_contents
 
     mTimestamp = timestamp;
 
+    // A speculative composition from a prepare that was not followed by a set is not used.
+    finishSpeculativeCompositions(true);
+
     // Process the stale buffer handle list at the top of the frame.
     expireBuffers();
 
@@ -664,6 +764,9 @@ void CompositionManager::onPrepareBegin(size_t numDisplays, hwc_display_contents
 
 void CompositionManager::onPrepareEnd()
 {
+    // This needs the buffer queue, which is only held until the end of prepare.
+    startSpeculativeCompositions();
+
     mSurfaceFlingerComposer.onPrepareEnd();
     mBufferQueue.onPrepareEnd();
     return;
@@ -671,10 +774,78 @@ void CompositionManager::onPrepareEnd()
 
 void CompositionManager::invalidate(buffer_handle_t handle)
 {
-    for (uint32_t i = 0; i < mCompositions.size(); i++)
+    if (handle == 0)
+        return;
+
+    // Expiring the buffer removes the composition from the index, so gather them first.
+    mInvalidateScratch.clear();
+    auto range = mHandleIndex.equal_range(handle);
+    for (auto it = range.first; it != range.second; ++it)
     {
-        Composition& c = mCompositions[i];
-        c.expireBuffer( handle );
+        mInvalidateScratch.push_back(it->second);
+    }
+
+    for (Composition* pComposition : mInvalidateScratch)
+    {
+        ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::invalidate: handle %p composition %p %s", handle, pComposition, pComposition->dump(mTimestamp).string() );
+        pComposition->expireBuffer( handle );
+    }
+    ALOG_ASSERT( mHandleIndex.count(handle) == 0 );
+}
+
+void CompositionManager::updateHandleIndex(Composition& c)
+{
+    // Collect the distinct handles the composition currently references.
+    mIndexScratch.clear();
+    if (c.mRenderTarget.getHandle())
+    {
+        mIndexScratch.push_back(c.mRenderTarget.getHandle());
+    }
+    for (const Layer& layer : c.mSourceLayers)
+    {
+        if (layer.getHandle())
+        {
+            mIndexScratch.push_back(layer.getHandle());
+        }
+    }
+    std::sort(mIndexScratch.begin(), mIndexScratch.end());
+    mIndexScratch.erase(std::unique(mIndexScratch.begin(), mIndexScratch.end()), mIndexScratch.end());
+
+    if (mIndexScratch == c.mIndexedHandles)
+    {
+        return;
+    }
+
+    for (buffer_handle_t handle : c.mIndexedHandles)
+    {
+        auto range = mHandleIndex.equal_range(handle);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == &c)
+            {
+                mHandleIndex.erase(it);
+                break;
+            }
+        }
+    }
+    for (buffer_handle_t handle : mIndexScratch)
+    {
+        mHandleIndex.emplace(handle, &c);
+    }
+    c.mIndexedHandles.swap(mIndexScratch);
+}
+
+void CompositionManager::releaseHandleUsage(buffer_handle_t handle, uint32_t d)
+{
+    auto it = mCurrentHandleUsage.find(handle);
+    if (it == mCurrentHandleUsage.end())
+        return;
+
+    it->second.reset(d);
+    if (it->second.none())
+    {
+        mCurrentHandleUsage.erase(it);
+        invalidate(handle);
     }
 }
 
@@ -705,9 +876,7 @@ void CompositionManager::onAccept(const Content::Display& display, uint32_t d)
             if (!bFound)
             {
                 // Mark this handle as unused. Invalidate any compositions containing the handle if no displays reference this now.
-                mCurrentHandleUsage[handle] &= ~(1 << d);
-                if (mCurrentHandleUsage[handle] == 0)
-                    invalidate(handle);
+                releaseHandleUsage(handle, d);
             }
         }
 
@@ -718,7 +887,7 @@ void CompositionManager::onAccept(const Content::Display& display, uint32_t d)
             const Layer& layer = layerStack.getLayer(ly);
             buffer_handle_t handle = layer.getHandle();
             mCurrentHandles[d][ly] = handle;
-            mCurrentHandleUsage[handle] |= (1 << d);
+            mCurrentHandleUsage[handle].set(d);
         }
     }
     else
@@ -730,12 +899,11 @@ void CompositionManager::onAccept(const Content::Display& display, uint32_t d)
             if (mCurrentHandles[d][ly] != layer.getHandle())
             {
                 buffer_handle_t handle = mCurrentHandles[d][ly];
-                mCurrentHandleUsage[handle] &= ~(1 << d);
-                if (mCurrentHandleUsage[handle] == 0)
-                    invalidate(handle);
+                releaseHandleUsage(handle, d);
 
-                invalidate(mCurrentHandles[d][ly]);
+                invalidate(handle);
                 mCurrentHandles[d][ly] = layer.getHandle();
+                mCurrentHandleUsage[layer.getHandle()].set(d);
             }
         }
     }
@@ -746,6 +914,9 @@ void CompositionManager::onSetBegin(size_t numDisplays, hwc_display_contents_1_t
     mSurfaceFlingerComposer.onSet(numDisplays, ppDisplayContents, mTimestamp);
     mBufferQueue.onSetBegin();
 
+    // The acquire fences are now available to check the speculative compositions against.
+    finishSpeculativeCompositions(false);
+
     // Update any SF compositions to have the right dst layer,
     for (uint32_t i = 0; i < mCompositions.size(); i++)
     {
@@ -783,6 +954,7 @@ void CompositionManager::onEndOfFrame( uint32_t hwcFrameIndex )
 
 AbstractComposition* CompositionManager::requestComposition(const Content::LayerStack& src, uint32_t width, uint32_t height, uint32_t format, ECompressionType compression, AbstractComposer::Cost type)
 {
+    HOTPATH_SCOPE( COMPOSITION_REQUEST );
     ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::requestComposition: Looking for composition to %dx%d %s. compositions known:%d %p", width, height, getHALFormatShortString(format), mCompositions.size(), this);
     ALOGD_IF( COMPOSITION_DEBUG, "%s", src.dump().string());
 
@@ -890,6 +1062,7 @@ AbstractComposition* CompositionManager::requestComposition(const Content::Layer
 
 uint32_t CompositionManager::lockComposition( AbstractComposition* pComposition )
 {
+    HOTPATH_SCOPE( COMPOSITION_LOOKUP );
     for (uint32_t i = 0; i < mCompositions.size(); i++)
     {
         Composition& c = mCompositions[i];
@@ -908,6 +1081,7 @@ uint32_t CompositionManager::lockComposition( AbstractComposition* pComposition
 
 uint32_t CompositionManager::unlockComposition( AbstractComposition* pComposition )
 {
+    HOTPATH_SCOPE( COMPOSITION_LOOKUP );
     for (uint32_t i = 0; i < mCompositions.size(); i++)
     {
         Composition& c = mCompositions[i];
@@ -933,7 +1107,12 @@ void CompositionManager::chooseBestCompositionEngine(Composition& c, AbstractCom
     {
         AbstractComposer& composer = *mpComposers[i];
         AbstractComposer::CompositionState *pState = NULL;
-        float cost = composer.onEvaluate(c.mSourceStack, c.mRenderTarget, &pState, type);
+        float cost;
+        {
+            // The composer may be busy with a dispatched composition.
+            Mutex::Autolock _l(*mpComposerLocks[i]);
+            cost = composer.onEvaluate(c.mSourceStack, c.mRenderTarget, &pState, type);
+        }
         // If cost is negative, composer failed in some way.
         if (cost >= AbstractComposer::Eval_Cost_Min)
         {
@@ -993,9 +1172,10 @@ void CompositionManager::notifyBufferFree( buffer_handle_t handle )
         Mutex::Autolock _l( mStaleBufferMutex );
         mStaleBufferHandles.push_back( handle );
     }
-    if ( gettid() == mPrimaryTid )
+    if ( ( gettid() == mPrimaryTid ) && mPendingCompositions.empty() )
     {
-        // Process immediately if this is the main thread.
+        // Process immediately if this is the main thread
+        // and no composition is running on the workers.
         expireBuffers();
     }
 }
@@ -1010,15 +1190,218 @@ void CompositionManager::expireBuffers( void )
         for (buffer_handle_t handle : mStaleBufferHandles)
         {
             ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::expireBuffers buffer %p", handle );
-            // Expire any compositions for which this buffer was a source.
-            for (uint32_t i = 0; i < mCompositions.size(); i++)
+            // Expire any compositions for which this buffer was a source or target.
+            invalidate( handle );
+        }
+        mStaleBufferHandles.clear();
+    }
+}
+
+Mutex& CompositionManager::getComposerLock(const AbstractComposer* pComposer)
+{
+    for (uint32_t i = 0; i < mpComposers.size(); i++)
+    {
+        if (mpComposers[i] == pComposer)
+        {
+            return *mpComposerLocks[i];
+        }
+    }
+    ALOG_ASSERT(false, "Unknown composer %p", pComposer);
+    return *mpComposerLocks[0];
+}
+
+void CompositionManager::beginConcurrentCompose()
+{
+    ALOG_ASSERT( gettid() == mPrimaryTid );
+    ALOG_ASSERT( mPendingCompositions.empty() );
+    mbConcurrentCompose = mOptionConcurrentCompose;
+    mComposeDisplay = INVALID_DISPLAY_ID;
+}
+
+void CompositionManager::setComposeDisplay(uint32_t phyIndex)
+{
+    ALOG_ASSERT( gettid() == mPrimaryTid );
+    mComposeDisplay = phyIndex;
+}
+
+void CompositionManager::endConcurrentCompose()
+{
+    mbConcurrentCompose = false;
+    mComposeDisplay = INVALID_DISPLAY_ID;
+}
+
+void CompositionManager::dispatchCompose(Composition& c)
+{
+    // Compositions nested in another's source must be complete before the outer composition
+    // is dispatched, so only top level compositions are handed to the workers.
+    if (mbConcurrentCompose && (mComposeDepth == 0) && c.mpComposer->isConcurrentComposeSupported())
+    {
+        ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::dispatchCompose %p %s to workers", &c, c.getName() );
+        c.mbComposePending = true;
+        c.mComposeDisplay = mComposeDisplay;
+        mPendingCompositions.push_back(&c);
+        ++mConcurrentCompositions;
+        mComposePool.submit(c);
+    }
+    else
+    {
+        runCompose(c);
+    }
+}
+
+void CompositionManager::runCompose(Composition& c)
+{
+    ATRACE_NAME_IF(HWC_TRACE, c.getName());
+    Mutex::Autolock _l(getComposerLock(c.mpComposer));
+    c.mpComposer->onCompose(c.mSourceStack, c.mRenderTarget, c.mpComposerCompositionState);
+}
+
+void CompositionManager::waitCompose(Composition& c)
+{
+    ALOG_ASSERT( c.mbComposePending );
+    mComposePool.wait(c);
+    c.mbComposePending = false;
+}
+
+void CompositionManager::waitCompositions()
+{
+    for (Composition* pComposition : mPendingCompositions)
+    {
+        pComposition->waitCompose();
+    }
+    mPendingCompositions.clear();
+}
+
+bool CompositionManager::isSpeculationCandidate(const Composition& c) const
+{
+    // Only compositions in use for this frame that would otherwise be composed at set,
+    // on a composer that can run on the workers.
+    if ((c.mRefCount == 0) || (c.mTimestamp != mTimestamp) || !c.mbEvaluationValid || (c.mpComposer == NULL)
+     || c.mbTargetValid || c.mbTargetProvided || !c.mpComposer->isConcurrentComposeSupported())
+    {
+        return false;
+    }
+
+    // Protected content needs its session state at set.
+    if (c.mSourceStack.isEncrypted() || c.mSourceStack.isFrontBufferRendered())
+    {
+        return false;
+    }
+
+    // Nested compositions are composed at set, and late producers would just be discarded.
+    for (uint32_t ly = 0; ly < c.mSourceStack.size(); ly++)
+    {
+        const Layer& layer = c.mSourceStack.getLayer(ly);
+        if (layer.isComposition() || layer.isLateProducer())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompositionManager::startSpeculativeCompositions()
+{
+    if (!mOptionSpeculativeCompose)
+    {
+        return;
+    }
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    beginConcurrentCompose();
+    if (!mbConcurrentCompose)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < mCompositions.size(); i++)
+    {
+        Composition& c = mCompositions[i];
+        if (!isSpeculationCandidate(c))
+        {
+            continue;
+        }
+
+        // SurfaceFlinger fills in the acquire fences for set, possibly while the composer runs,
+        // so compose from a copy of the source layers with no fences attached.
+        c.mSpeculativeLayers = c.mSourceLayers;
+        for (Layer& layer : c.mSpeculativeLayers)
+        {
+            layer.setAcquireFenceReturn(Timeline::NullNativeFenceReference);
+            layer.setReleaseFenceReturn(Timeline::NullNativeFenceReference);
+        }
+        c.mSourceStack = Content::LayerStack(c.mSpeculativeLayers.data(), c.mSpeculativeLayers.size());
+        c.mSourceStack.updateLayerFlags();
+        c.mSpeculativeTime = now;
+        c.mbSpeculative = true;
+
+        ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::startSpeculativeCompositions %p %s", &c, c.getName() );
+        c.onCompose();
+        mbSpeculating = true;
+        ++mSpeculativeCompositions;
+    }
+    endConcurrentCompose();
+}
+
+bool CompositionManager::isSpeculationValid(const Composition& c) const
+{
+    // Each source buffer must have been complete before the composer could have read it.
+    for (uint32_t ly = 0; ly < c.mSourceLayers.size(); ly++)
+    {
+        const Layer& layer = c.mSourceLayers[ly];
+        if (layer.getHandle() != c.mSpeculativeLayers[ly].getHandle())
+        {
+            return false;
+        }
+        const Timeline::NativeFence fence = layer.getAcquireFence();
+        if (Timeline::isValid(fence))
+        {
+            nsecs_t signalTime = 0;
+            if ((Timeline::querySignalTime(fence, &signalTime) != 1) || (signalTime > c.mSpeculativeTime))
             {
-                Composition& c = mCompositions[i];
-                ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::expireComposition: Checking composition %d/%p %s", i, &c, c.dump(mTimestamp).string() );
-                c.expireBuffer( handle );
+                return false;
             }
         }
-        mStaleBufferHandles.clear();
+    }
+    return true;
+}
+
+void CompositionManager::finishSpeculativeCompositions(bool bDiscard)
+{
+    if (!mbSpeculating)
+    {
+        return;
+    }
+    mbSpeculating = false;
+
+    waitCompositions();
+    for (uint32_t i = 0; i < mCompositions.size(); i++)
+    {
+        Composition& c = mCompositions[i];
+        if (!c.mbSpeculative)
+        {
+            continue;
+        }
+        c.mbSpeculative = false;
+        c.mSourceStack = Content::LayerStack(c.mSourceLayers.data(), c.mSourceLayers.size());
+        c.mSourceStack.updateLayerFlags();
+
+        if (!c.mbTargetValid)
+        {
+            continue;
+        }
+        if (bDiscard)
+        {
+            c.invalidate();
+        }
+        else if (!isSpeculationValid(c))
+        {
+            // Compose again at set into the same render target; it has not been presented.
+            ALOGD_IF( COMPOSITION_DEBUG, "CompositionManager::finishSpeculativeCompositions %p discarded", &c );
+            Log::add(c.mSourceStack, c.mRenderTarget, "Speculative Composition Discard: ");
+            c.invalidate();
+            c.mbTargetProvided = true;
+            ++mSpeculativeDiscards;
+        }
     }
 }
 
@@ -1048,6 +1431,9 @@ String8 CompositionManager::dump() const
 
     String8 output;
     output += mBufferQueue.dump();
+    output.appendFormat("Handle index: %zu entries, %zu handles in use\n", mHandleIndex.size(), mCurrentHandleUsage.size());
+    output.appendFormat("Concurrent compositions: %u %s\n", mConcurrentCompositions, mComposePool.dump().string());
+    output.appendFormat("Speculative compositions: %u discarded:%u\n", mSpeculativeCompositions, mSpeculativeDiscards);
     for (uint32_t i = 0; i < mCompositions.size(); i++)
     {
         output.appendFormat("Composition %d/%d ", i, mCompositions.size());
@@ -22,13 +22,17 @@
 #include "AbstractBufferManager.h"
 #include "BufferQueue.h"
 #include "HwcList.h"
+#include "Option.h"
 #include "SurfaceFlingerComposer.h"
+#include "WorkerPool.h"
 
 #include <ui/GraphicBuffer.h>
 #include "Singleton.h"
 
+#include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <bitset>
 
 namespace intel {
@@ -55,10 +59,7 @@ public:
     // One-time initialise during on first frame.
     void firstFrameInit( void );
 
-    void add(AbstractComposer* pComposer)
-    {
-        mpComposers.push_back(pComposer);
-    }
+    void add(AbstractComposer* pComposer);
 
     void onPrepareBegin(size_t numDisplays, hwc_display_contents_1_t** displays, nsecs_t timestamp);
     void onPrepareEnd();
@@ -87,6 +88,19 @@ public:
     // The src layers do not have to remain available.
     bool performComposition(const Content::LayerStack& src, const Layer& target);
 
+    // Compositions started between beginConcurrentCompose and endConcurrentCompose may be handed
+    // to worker threads if their composer supports it, so that compositions for different displays
+    // run concurrently on different composers. Each must then be completed with
+    // AbstractComposition::waitCompose before its target is used; waitCompositions completes any
+    // that remain and must be called before the end of the frame.
+    void beginConcurrentCompose();
+    void endConcurrentCompose();
+
+    // Name the physical display whose compositions are being started, so that the workers can
+    // stagger them by vsync phase (see VSyncPhaseScheduler).
+    void setComposeDisplay(uint32_t phyIndex);
+    void waitCompositions();
+
 
     // TODO: Evaluations
     // Evaluate the cost of a composition. This is a once off call, it will sum up the cost of all the requested
@@ -112,6 +126,27 @@ private:
     // Internal function to search for the best composition engine for a particular composition
     void chooseBestCompositionEngine(Composition& c, AbstractComposer::Cost type);
 
+    // Run a composition's composer now or, while concurrent composition is open, queue it for the workers.
+    void dispatchCompose(Composition& c);
+
+    // Call the composer for a composition, from either the workers or the primary thread.
+    void runCompose(Composition& c);
+
+    // Wait for a queued composition to complete, running it here if no worker has started it.
+    void waitCompose(Composition& c);
+
+    // Lock held while calling into a composer.
+    Mutex& getComposerLock(const AbstractComposer* pComposer);
+
+    // Speculative composition.
+    // At the end of prepare, compositions that will be needed for this frame are started on the
+    // workers, while SurfaceFlinger does its own composition. At set, each is kept only if all
+    // of its source acquire fences had signalled before it started; otherwise it is redone.
+    bool isSpeculationCandidate(const Composition& c) const;
+    void startSpeculativeCompositions();
+    bool isSpeculationValid(const Composition& c) const;
+    void finishSpeculativeCompositions(bool bDiscard);
+
     // Expire buffers - drain the mStaleBufferHandles list.
     void expireBuffers( void );
 
@@ -122,9 +157,32 @@ private:
     // Invalidate any compositions containing this buffer handle
     void                            invalidate(buffer_handle_t handle);
 
+    // Reindex the composition under the handles it currently references.
+    void                            updateHandleIndex(Composition& c);
+
+    // Clear display d's use of handle, invalidating its compositions once no display uses it.
+    void                            releaseHandleUsage(buffer_handle_t handle, uint32_t d);
+
 private:
     HwcList<Composition>            mCompositions;              // List of currently active compositions
     std::vector<AbstractComposer*>  mpComposers;
+    std::vector< std::unique_ptr<Mutex> > mpComposerLocks;      // Per composer locks, so that no composer is entered concurrently.
+
+    // Concurrent composition.
+    // The platform has one instance of each composer (one GL context, one VPP context),
+    // so this is only as wide as the number of distinct composers in use in a frame.
+    static const uint32_t           cComposeWorkers = 2;
+    Option                          mOptionConcurrentCompose;
+    Option                          mOptionSpeculativeCompose;
+    mutable WorkerPool              mComposePool;
+    std::vector<Composition*>       mPendingCompositions;       // Compositions queued for the workers this frame.
+    bool                            mbConcurrentCompose;        // Between begin/endConcurrentCompose.
+    uint32_t                        mComposeDisplay;            // Physical display whose compositions are being started.
+    uint32_t                        mComposeDepth;              // Depth of nested source compositions being composed.
+    bool                            mbSpeculating;              // Speculative compositions started and not yet finished.
+    uint32_t                        mConcurrentCompositions;    // Statistics: compositions queued for the workers.
+    uint32_t                        mSpeculativeCompositions;   // Statistics: compositions started at the end of prepare.
+    uint32_t                        mSpeculativeDiscards;       // Statistics: speculative compositions redone at set.
 
     SurfaceFlingerComposer          mSurfaceFlingerComposer;    // Composer that manages surfaceflinger compositions
     BufferQueue                     mBufferQueue;               // Currently allocated Composition buffers
@@ -135,6 +193,12 @@ private:
     std::vector<buffer_handle_t>    mCurrentHandles[cMaxSupportedPhysicalDisplays];// List of buffer handles that we know have been freed.
     std::map<buffer_handle_t, std::bitset<cMaxSupportedPhysicalDisplays>> mCurrentHandleUsage;
 
+    // Reverse index from source and render target handles to the compositions referencing them.
+    // This lets buffer frees and handle changes reach just the affected compositions.
+    std::unordered_multimap<buffer_handle_t, Composition*> mHandleIndex;
+    std::vector<buffer_handle_t>    mIndexScratch;              // Scratch space for updateHandleIndex.
+    std::vector<Composition*>       mInvalidateScratch;         // Scratch space for invalidate.
+
     pid_t                           mPrimaryTid;                // Primary thread.
     nsecs_t                         mTimestamp;                 // Time of the most recent composition
 };
@@ -19,6 +19,7 @@
 #include "Layer.h"
 #include "Log.h"
 #include "Timeline.h"
+#include <atomic>
 
 namespace intel {
 namespace ufo {
@@ -40,6 +41,37 @@ void Content::setGeometryChanged(bool geometry)
     }
 }
 
+uint64_t Content::getGeneration() const
+{
+    uint64_t generation = 0;
+    for (size_t d = 0; d < size(); d++)
+    {
+        generation = max(generation, getDisplay(d).getGeneration());
+    }
+    return generation;
+}
+
+uint64_t Content::allocateGeneration()
+{
+    static std::atomic<uint64_t> sGeneration(0);
+    return ++sGeneration;
+}
+
+String8 Content::dumpChanges(uint32_t changes)
+{
+    if (changes == 0)
+        return String8("None");
+    return String8::format("%s%s%s%s%s%s%s%s",
+        changes & CHANGE_LAYER_ADDED    ? "Added " : "",
+        changes & CHANGE_LAYER_MOVED    ? "Moved " : "",
+        changes & CHANGE_LAYER_BUFFER   ? "Buffer " : "",
+        changes & CHANGE_LAYER_RECTS    ? "Rects " : "",
+        changes & CHANGE_LAYER_STATE    ? "State " : "",
+        changes & CHANGE_LAYERS_REMOVED ? "Removed " : "",
+        changes & CHANGE_DISPLAY_MODE   ? "Mode " : "",
+        changes & CHANGE_UNSPECIFIED    ? "Unspecified " : "");
+}
+
 
 Content::Display::Display() :
     mFrameIndex(0),
@@ -51,6 +83,9 @@ Content::Display::Display() :
     mOutputScaledDst(),
     mDisplayType(eDTUnspecified),
     mDmIndex(INVALID_DISPLAY_ID),
+    mVideoCadenceFps(0),
+    mVideoPulldownMin(0),
+    mVideoPulldownMax(0),
     mbEnabled(false),
     mbBlanked(false),
     mbOutputScaled(false),
@@ -91,6 +126,9 @@ void Content::Display::updateDisplayState(const Content::Display &source)
     mOutputScaledDst    = source.mOutputScaledDst;
     mDisplayType        = source.mDisplayType;
     mDmIndex            = source.mDmIndex;
+    mVideoCadenceFps    = source.mVideoCadenceFps;
+    mVideoPulldownMin   = source.mVideoPulldownMin;
+    mVideoPulldownMax   = source.mVideoPulldownMax;
     mbEnabled           = source.mbEnabled;
     mbBlanked           = source.mbBlanked;
     mbOutputScaled      = source.mbOutputScaled;
@@ -99,6 +137,8 @@ void Content::Display::updateDisplayState(const Content::Display &source)
 }
 
 Content::LayerStack::LayerStack() :
+    mGeneration(0),
+    mChanges(CHANGE_UNSPECIFIED),
     mbGeometry(false),
     mbEncrypted(false),
     mbVideo(false),
@@ -107,6 +147,8 @@ Content::LayerStack::LayerStack() :
 }
 
 Content::LayerStack::LayerStack(const Layer* pLayers, uint32_t num) :
+    mGeneration(0),
+    mChanges(CHANGE_UNSPECIFIED),
     mbGeometry(false),
     mbEncrypted(false),
     mbVideo(false),
@@ -122,6 +164,19 @@ Content::LayerStack::~LayerStack()
 {
 }
 
+Layer& Content::LayerStack::editLayer(uint32_t ly, std::vector<Layer>& storage)
+{
+    ALOG_ASSERT(ly < mpLayers.size());
+    ALOG_ASSERT(ly < storage.size());
+    Layer& copy = storage[ly];
+    if (mpLayers[ly] != &copy)
+    {
+        copy = *(mpLayers[ly]);
+        mpLayers.editItemAt(ly) = &copy;
+    }
+    return copy;
+}
+
 uint32_t Content::LayerStack::getNumEnabledLayers() const
 {
     uint32_t numEnabled = 0;
@@ -152,6 +207,28 @@ void Content::LayerStack::updateLayerFlags()
     }
 }
 
+uint32_t Content::LayerStack::getChanges() const
+{
+    uint32_t changes = mChanges;
+    for ( uint32_t ly = 0; ly < mpLayers.size(); ly++ )
+    {
+        if ( mpLayers[ly] )
+        {
+            changes |= mpLayers[ly]->getChanges();
+        }
+    }
+    return changes;
+}
+
+uint32_t Content::LayerStack::getLayerChanges(uint32_t ly) const
+{
+    if ( mChanges & CHANGE_UNSPECIFIED )
+    {
+        return CHANGE_LAYER_MASK;
+    }
+    return getLayer(ly).getChanges();
+}
+
 void Content::LayerStack::updateLayerFlags(const Content::LayerStack& stack)
 {
     // Update the appropriate flags from the source layer. Check the layer flags directly
@@ -283,10 +360,11 @@ bool Content::LayerStack::matches( const LayerStack& other, bool* pbMatchesHandl
 
 String8 Content::LayerStack::dumpHeader() const
 {
-    return String8::format("%s%s%s",
+    return String8::format("%s%s%sChanges:%s",
                                isGeometryChanged() ? "Geometry " : "",
                                isVideo()           ? "Video " : "",
-                               isEncrypted()       ? "Encrypted " : "");
+                               isEncrypted()       ? "Encrypted " : "",
+                               dumpChanges(getChanges()).string());
 }
 
 
@@ -352,7 +430,7 @@ bool Content::Display::matches( const Display& other, bool* pbMatchesHandles ) c
 
 String8 Content::Display::dumpHeader() const
 {
-    return String8::format("Frame:%d %" PRIi64 "s %03" PRIi64 "ms Fd:%p/%d %dx%d %dHz %s %s %s%s%s",
+    return String8::format("Frame:%d %" PRIi64 "s %03" PRIi64 "ms Fd:%p/%d %dx%d %dHz %s %s %s%s%s%s",
                            mFrameIndex,
                            mFrameReceivedTime/1000000000, (mFrameReceivedTime%1000000000)/1000000,
                            getRetireFenceReturn(), getRetireFence(),
@@ -362,7 +440,9 @@ String8 Content::Display::dumpHeader() const
                                                 mOutputScaledDst.left, mOutputScaledDst.top,
                                                 mOutputScaledDst.right, mOutputScaledDst.bottom ).string() : "",
                            isEnabled()        ? "Enabled " : "",
-                           isBlanked()        ? "Blanked " : "");
+                           isBlanked()        ? "Blanked " : "",
+                           isVideoCadence()   ? String8::format( "Cadence:%u/%u:%u ",
+                                                mVideoCadenceFps, mVideoPulldownMin, mVideoPulldownMax ).string() : "");
 }
 
 
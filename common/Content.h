@@ -43,7 +43,30 @@ public:
     class LayerStack;
     class Display;
 
-
+    // Changes to a display since its previous frame.
+    // These are produced once by the InputAnalyzer so that downstream stages can take fast paths
+    // without each comparing against its own copy of the last frame. The layer changes are held
+    // by each layer (see Layer::getChanges) so they follow the layers through the filters; the
+    // display changes are held by the layer stack. Layers built by filters start with no changes
+    // (Layer::clear) or carry those of the layer they were copied from; filters that change their
+    // output for any other reason force a geometry change, which is reported as CHANGE_UNSPECIFIED.
+    enum EChange
+    {
+        CHANGE_LAYER_ADDED      = (1<<0),   // Layer was not present on the previous frame.
+        CHANGE_LAYER_MOVED      = (1<<1),   // Layer was present at a different position in the stack.
+        CHANGE_LAYER_BUFFER     = (1<<2),   // Layer is presenting a different buffer.
+        CHANGE_LAYER_RECTS      = (1<<3),   // Source crop, display frame or visible regions changed.
+        CHANGE_LAYER_STATE      = (1<<4),   // Blending, transform, plane alpha, hints, flags or buffer mode changed.
+        CHANGE_LAYERS_REMOVED   = (1<<5),   // One or more layers were removed from the stack.
+        CHANGE_DISPLAY_MODE     = (1<<6),   // Display size, refresh, format, type, video cadence or enable changed.
+        CHANGE_UNSPECIFIED      = (1<<7),   // Changed in a way not described above. Assume anything changed.
+
+        CHANGE_LAYER_MASK       = CHANGE_LAYER_ADDED | CHANGE_LAYER_MOVED | CHANGE_LAYER_BUFFER | CHANGE_LAYER_RECTS | CHANGE_LAYER_STATE,
+        CHANGE_ALL              = CHANGE_LAYER_MASK | CHANGE_LAYERS_REMOVED | CHANGE_DISPLAY_MODE | CHANGE_UNSPECIFIED
+    };
+
+    // Describe a set of changes.
+    static String8              dumpChanges(uint32_t changes);
 
     Content();
     ~Content();
@@ -59,6 +82,15 @@ public:
 
     void                        setGeometryChanged(bool geometry);
 
+    // Content generation.
+    // Every display carries a generation that is replaced (from a single monotonic counter)
+    // whenever anything about that display's content changes. The content generation is
+    // the highest of its display generations so any change on any display will advance it.
+    uint64_t                    getGeneration() const;
+
+    // Returns a new generation, greater than any previously returned generation.
+    static uint64_t             allocateGeneration();
+
     // Do these Contents match other Contents.
     // Returns true if match (ignoring handles).
     // If pbMatchesHandles is provided, then on return it will be set true iff all layer handles also match.
@@ -89,6 +121,13 @@ public:
     void                    setLayer(uint32_t ly, const Layer* pL)      { mpLayers.editItemAt(ly) = pL; }
     const Layer&            operator[](uint32_t ly) const               { return *(mpLayers[ly]); }
 
+    // Copy-on-write access to a single layer.
+    // Unless the stack already references storage[ly], the layer is copied into storage[ly] and
+    // the stack is pointed at the copy. All other layers remain shared with the source.
+    // The storage is owned by the caller, must hold at least size() layers and must not be
+    // resized while any stack references it.
+    Layer&                  editLayer(uint32_t ly, std::vector<Layer>& storage);
+
     uint32_t                size() const                                { return mpLayers.size(); }
     void                    resize(uint32_t size)                       { mpLayers.resize(size); }
     uint32_t                getNumEnabledLayers() const;
@@ -97,7 +136,21 @@ public:
     bool                    isEncrypted() const                         { return mbEncrypted; }
     bool                    isVideo() const                             { return mbVideo; }
     bool                    isFrontBufferRendered() const               { return mbFrontBufferRendered; }
-    void                    setGeometryChanged(bool geometry)           { mbGeometry = geometry; }
+    uint64_t                getGeneration() const                       { return mGeneration; }
+    void                    setGeneration(uint64_t generation)          { mGeneration = generation; }
+
+    // A geometry change without a more specific description is an unspecified change.
+    // Without a geometry change there can be no structural change so the stack changes are cleared.
+    void                    setGeometryChanged(bool geometry)           { mbGeometry = geometry; mChanges = geometry ? ( mChanges | CHANGE_UNSPECIFIED ) : 0; }
+
+    // Changes since the previous frame (see Content::EChange).
+    // This is the union of the changes of every layer with the changes to the stack itself.
+    uint32_t                getChanges() const;
+    // Changes to layer ly since the previous frame.
+    // Every layer is reported as changed if the stack has unspecified changes.
+    uint32_t                getLayerChanges(uint32_t ly) const;
+    // Set the changes to the stack itself (layer changes are set on the layers).
+    void                    setChanges(uint32_t changes)                { mChanges = changes & ~CHANGE_LAYER_MASK; }
     void                    updateLayerFlags();
     void                    updateLayerFlags(const LayerStack& layers);
 
@@ -126,6 +179,8 @@ public:
 
 private:
     Vector<const Layer*>    mpLayers;                   // List of the layers that are currently on this stack
+    uint64_t                mGeneration;                // Content generation (see Content::allocateGeneration)
+    uint32_t                mChanges;                   // Changes to the stack itself (see Content::EChange)
     bool                    mbGeometry:1;               // Geometry change with this stack
     bool                    mbEncrypted:1;              // At least one layer on this display is encrypted
     bool                    mbVideo:1;                  // At least one video plane is present
@@ -154,6 +209,18 @@ public:
     const Layer*            getOutputLayer() const                      { return mpOutputLayer; }
     int                     getRetireFence() const                      { return mpSourceRetireFence ? *mpSourceRetireFence : -1; }
 
+    // Video cadence hint, detected by the VideoModeDetectionFilter and set by the InputAnalyzer.
+    // The nominal rate (eg 24, 25, 30, 60) at which a fullscreen video layer is being updated
+    // or zero if no stable video playback is detected. The pulldown is the number of display
+    // refreshes each video frame is presented for, as the shortest and longest intervals
+    // (eg 2,3 for 24fps on a 60Hz display).
+    // A change in cadence raises a geometry change so that the plane allocator re-evaluates
+    // (see PlaneAllocator::VIDEO_CADENCE_SCORE).
+    uint32_t                getVideoCadenceFps() const                  { return mVideoCadenceFps; }
+    uint32_t                getVideoPulldownMin() const                 { return mVideoPulldownMin; }
+    uint32_t                getVideoPulldownMax() const                 { return mVideoPulldownMax; }
+    bool                    isVideoCadence() const                      { return mVideoCadenceFps != 0; }
+
     // Flag accessors
     bool                    isEnabled() const                           { return mbEnabled; }
     bool                    isBlanked() const                           { return mbBlanked; }
@@ -162,8 +229,11 @@ public:
     bool                    isEncrypted() const                         { return mLayerStack.isEncrypted(); }
     bool                    isFrontBufferRendered() const               { return mLayerStack.isFrontBufferRendered(); }
     bool                    isGeometryChanged() const                   { return mLayerStack.isGeometryChanged(); }
+    uint64_t                getGeneration() const                       { return mLayerStack.getGeneration(); }
+    uint32_t                getChanges() const                          { return mLayerStack.getChanges(); }
 
     void                    setGeometryChanged(bool geometry)           { mLayerStack.setGeometryChanged(geometry); }
+    void                    setGeneration(uint64_t generation)          { mLayerStack.setGeneration(generation); }
     void                    setEnabled(bool enabled)                    { mbEnabled = enabled; }
     void                    setBlanked(bool blanked)                    { mbBlanked = blanked; }
     void                    setFrameIndex(uint32_t index)               { mFrameIndex = index; }
@@ -177,6 +247,8 @@ public:
     void                    setRetireFenceReturn(int* pRetireFence)     { mpSourceRetireFence = pRetireFence; }
     void                    setOutputLayer(const Layer* pLayer)         { mpOutputLayer = pLayer; }
     void                    setOutputScaled(const hwc_rect_t& dst)      { mbOutputScaled = true; mOutputScaledDst = dst; }
+    void                    setVideoCadence(uint32_t fps, uint32_t pulldownMin, uint32_t pulldownMax)
+                                                                        { mVideoCadenceFps = fps; mVideoPulldownMin = pulldownMin; mVideoPulldownMax = pulldownMax; }
 
     // Update all display state from the source except the layer stack
     void                    updateDisplayState(const Content::Display &source);
@@ -219,6 +291,9 @@ private:
     hwc_rect_t              mOutputScaledDst;   // Output scaled destination position/size.
     EDisplayType            mDisplayType;       // Type of display
     uint32_t                mDmIndex;           // Display manager index.
+    uint32_t                mVideoCadenceFps;   // Detected video cadence (0 if none).
+    uint32_t                mVideoPulldownMin;  // Fewest refreshes per video frame.
+    uint32_t                mVideoPulldownMax;  // Most refreshes per video frame.
 
     // Various flags that control this display or indicate that the display is in some kind of state
     bool                    mbEnabled:1;        // display is currently enabled
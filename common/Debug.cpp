@@ -24,6 +24,13 @@
 #include <drm_fourcc.h>
 #include <utils/Mutex.h>
 
+#include <algorithm>
+#include <dlfcn.h>
+#include <functional>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <vector>
+
 namespace intel {
 namespace ufo {
 namespace hwc {
@@ -344,11 +351,55 @@ String8 Timing::dump() const
             mHTotal, mVTotal);
 }
 
-#if VPG_HAVE_DEBUG_MUTEX
+#if VPG_HAVE_HWC_MUTEX
+
+static int futexWait( std::atomic<int32_t>* pWord, int32_t value, nsecs_t timeout )
+{
+    struct timespec ts;
+    struct timespec* pTs = NULL;
+    if ( timeout >= 0 )
+    {
+        ts.tv_sec = timeout / 1000000000;
+        ts.tv_nsec = timeout % 1000000000;
+        pTs = &ts;
+    }
+    return syscall( SYS_futex, reinterpret_cast<int32_t*>( pWord ), FUTEX_WAIT_PRIVATE, value, pTs, NULL, 0 );
+}
+
+static void futexWake( std::atomic<int32_t>* pWord, int32_t count )
+{
+    syscall( SYS_futex, reinterpret_cast<int32_t*>( pWord ), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0 );
+}
+
+// The registry of all live mutexes. This must not use the debug Mutex itself and is never
+// destroyed so that static mutexes can be safely destructed in any order.
+static android::Mutex& getMutexRegistryLock( void )
+{
+    static android::Mutex* spLock = new android::Mutex;
+    return *spLock;
+}
+static Mutex* spMutexRegistry = NULL;
+
+static String8 dumpSite( const void* pSite )
+{
+    Dl_info info;
+    if ( pSite && dladdr( pSite, &info ) && info.dli_sname )
+    {
+        return String8::format( "%s+%#zx", info.dli_sname, (size_t)pSite - (size_t)info.dli_saddr );
+    }
+    return String8::format( "%p", pSite );
+}
 
 Mutex::Mutex( ) :
-    mbInit(1), mTid(0), mAcqTime(0), mWaiters(0)
+    mbInit(1), mState(0), mTid(0), mAcqTime(0), mWaiters(0),
+    mpAcqSite(NULL), mpContendedSite(NULL), mAcquisitions(0), mContended(0), mTotalWait(0), mMaxWait(0),
+    mpPrev(NULL), mpNext(NULL)
 {
+    android::Mutex::Autolock _l( getMutexRegistryLock() );
+    mpNext = spMutexRegistry;
+    if ( mpNext )
+        mpNext->mpPrev = this;
+    spMutexRegistry = this;
 }
 
 Mutex::~Mutex( )
@@ -356,37 +407,81 @@ Mutex::~Mutex( )
     mbInit = 0;
     ALOG_ASSERT( mTid == 0 );
     ALOG_ASSERT( !mWaiters );
+    android::Mutex::Autolock _l( getMutexRegistryLock() );
+    if ( mpPrev )
+        mpPrev->mpNext = mpNext;
+    else
+        spMutexRegistry = mpNext;
+    if ( mpNext )
+        mpNext->mpPrev = mpPrev;
+}
+
+void Mutex::acquire( const void* pSite )
+{
+    int32_t state = 0;
+    if ( !mState.compare_exchange_strong( state, 1, std::memory_order_acquire ) )
+    {
+        // Contended. Note who we are waiting on before sleeping (a racy read, for diagnostics only).
+        ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "W-Mutex-%p", this ).string(), 1 );
+        const nsecs_t timeStart = systemTime(SYSTEM_TIME_MONOTONIC);
+        const void* pHolderSite = mpAcqSite;
+        if ( state != 2 )
+        {
+            state = mState.exchange( 2, std::memory_order_acquire );
+        }
+        while ( state != 0 )
+        {
+#if VPG_HAVE_DEBUG_MUTEX
+            if ( ( futexWait( &mState, 2, mLongTime ) == -1 ) && ( errno == ETIMEDOUT ) )
+            {
+                ALOGE( "Thread %u blocked by thread %u waiting for mutex %p [holder acquired at %s]",
+                    gettid( ), mTid, this, dumpSite( mpAcqSite ).string() );
+            }
+#else
+            futexWait( &mState, 2, -1 );
+#endif
+            state = mState.exchange( 2, std::memory_order_acquire );
+        }
+        const nsecs_t wait = systemTime(SYSTEM_TIME_MONOTONIC) - timeStart;
+        ++mContended;
+        mTotalWait += wait;
+        if ( wait > mMaxWait )
+            mMaxWait = wait;
+        mpContendedSite = pHolderSite;
+        ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "W-Mutex-%p", this ).string(), 0 );
+    }
+    ++mAcquisitions;
+    mpAcqSite = pSite;
+#if VPG_HAVE_DEBUG_MUTEX
+    mTid = gettid( );
+    mAcqTime = systemTime(SYSTEM_TIME_MONOTONIC);
+#endif
+}
+
+void Mutex::release( void )
+{
+    mTid = 0;
+    if ( mState.fetch_sub( 1, std::memory_order_release ) != 1 )
+    {
+        // There may be waiters.
+        mState.store( 0, std::memory_order_release );
+        futexWake( &mState, 1 );
+    }
 }
 
 int Mutex::lock( )
 {
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Acquiring mutex %p thread %u", this, gettid() );
     ALOG_ASSERT( mbInit );
+#if VPG_HAVE_DEBUG_MUTEX
     if ( mTid == gettid() )
     {
         ALOGE( "Thread %u has already acquired mutex %p", gettid(), this );
         ALOG_ASSERT( 0 );
     }
-    ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "W-Mutex-%p", this ).string(), 1 );
-    nsecs_t timeStart = systemTime(SYSTEM_TIME_MONOTONIC);
-    uint64_t timeNow, timeEla;
-    for (;;)
-    {
-        timeNow = systemTime(SYSTEM_TIME_MONOTONIC);
-        if ( mMutex.tryLock( ) == 0 )
-            break;
-        usleep( mSpinWait );
-        timeEla = (uint64_t)int64_t( timeNow - timeStart );
-        if ( timeEla > mLongTime )
-        {
-            ALOGE( "Thread %u blocked by thread %u waiting for mutex %p", gettid( ), mTid, this );
-            timeStart = timeNow;
-        }
-    }
-    ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "W-Mutex-%p", this ).string(), 0 );
+#endif
+    acquire( __builtin_return_address( 0 ) );
     ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "A-Mutex-%p", this ).string(), 1 );
-    mTid = gettid( );
-    mAcqTime = timeNow;
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Acquired mutex %p thread %u", this, gettid() );
     return 0;
 }
@@ -395,6 +490,7 @@ int Mutex::unlock( )
 {
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Releasing mutex %p thread %u", this, gettid() );
     ALOG_ASSERT( mbInit );
+#if VPG_HAVE_DEBUG_MUTEX
     if ( mTid != gettid() )
     {
         ALOGE( "Thread %u has not acquired mutex %p [mTid %u]", gettid(), this,  mTid );
@@ -402,10 +498,11 @@ int Mutex::unlock( )
     }
     uint64_t timeNow = systemTime(SYSTEM_TIME_MONOTONIC);
     uint64_t timeEla = (uint64_t)int64_t( timeNow - mAcqTime );
-    ALOGE_IF( timeEla > mLongTime, "Thread %u held mutex %p for %" PRIu64"ms", mTid, this, timeEla / 1000000 );
-    mTid = 0;
+    ALOGE_IF( timeEla > mLongTime, "Thread %u held mutex %p for %" PRIu64"ms [acquired at %s]",
+        mTid, this, timeEla / 1000000, dumpSite( mpAcqSite ).string() );
+#endif
     ATRACE_INT_IF( MUTEX_CONDITION_DEBUG, String8::format( "A-Mutex-%p", this ).string(), 0 );
-    mMutex.unlock( );
+    release( );
     return 0;
 }
 
@@ -433,11 +530,57 @@ uint32_t Mutex::getWaiters( void )
     return mWaiters;
 }
 
-Mutex::Autolock::Autolock( Mutex& m ) : mMutex( m ) { mMutex.lock( ); }
-Mutex::Autolock::~Autolock( ) { mMutex.unlock( ); }
+String8 Mutex::dumpContention( uint32_t maxMutexes )
+{
+    struct Entry
+    {
+        const Mutex* pMutex;
+        uint64_t acquisitions;
+        uint64_t contended;
+        nsecs_t totalWait;
+        nsecs_t maxWait;
+        const void* pAcqSite;
+        const void* pContendedSite;
+    };
+    std::vector<Entry> entries;
+    uint32_t mutexes = 0;
+
+    {
+        // The statistics are read without taking each mutex, so they may be slightly stale.
+        android::Mutex::Autolock _l( getMutexRegistryLock() );
+        for ( const Mutex* pMutex = spMutexRegistry; pMutex; pMutex = pMutex->mpNext )
+        {
+            ++mutexes;
+            if ( pMutex->mContended )
+            {
+                entries.push_back( { pMutex, pMutex->mAcquisitions, pMutex->mContended, pMutex->mTotalWait,
+                                     pMutex->mMaxWait, pMutex->mpAcqSite, pMutex->mpContendedSite } );
+            }
+        }
+    }
+
+    // Order by total wait, longest first.
+    std::vector<std::pair<nsecs_t, uint32_t>> order;
+    for ( uint32_t i = 0; i < entries.size(); ++i )
+    {
+        order.push_back( std::make_pair( entries[i].totalWait, i ) );
+    }
+    std::sort( order.begin(), order.end(), std::greater<std::pair<nsecs_t, uint32_t>>() );
+
+    String8 output = String8::format( "Mutexes:%u contended:%zu\n", mutexes, entries.size() );
+    for ( uint32_t i = 0; ( i < order.size() ) && ( i < maxMutexes ); ++i )
+    {
+        const Entry& e = entries[order[i].second];
+        output.appendFormat( "  %p acquisitions:%" PRIu64 " contended:%" PRIu64 " wait total:%" PRIu64 "us max:%" PRIu64 "us"
+                             " last site:%s blocked by:%s\n",
+                             e.pMutex, e.acquisitions, e.contended, ns2us( e.totalWait ), ns2us( e.maxWait ),
+                             dumpSite( e.pAcqSite ).string(), dumpSite( e.pContendedSite ).string() );
+    }
+    return output;
+}
 
 Condition::Condition( ) :
-    mbInit(1), mWaiters(0)
+    mbInit(1), mWaiters(0), mSequence(0)
 {
 }
 
@@ -447,52 +590,61 @@ Condition::~Condition( )
     ALOG_ASSERT( !mWaiters );
 }
 
-int Condition::waitRelative( Mutex& mutex, nsecs_t timeout )
+int Condition::waitInternal( Mutex& mutex, nsecs_t timeout, const void* pSite )
 {
     ALOG_ASSERT( mbInit );
-    ALOG_ASSERT( mutex.mTid == gettid( ) );
-    mutex.mTid = 0;
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mutex );
     mutex.incWaiter( );
+    ++mWaiters;
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p releasing mutex %p waiters %u/%u",
         this, &mutex, mWaiters, mutex.getWaiters() );
-    int ret = mCondition.waitRelative( mutex.mMutex, timeout );
+
+    // Sample the sequence before releasing the mutex so that a signal between the release
+    // and the wait is not lost.
+    const int32_t sequence = mSequence.load( std::memory_order_relaxed );
+    mutex.release( );
+    int ret = NO_ERROR;
+    if ( ( futexWait( &mSequence, sequence, timeout ) == -1 ) && ( errno == ETIMEDOUT ) )
+    {
+        ret = TIMED_OUT;
+    }
+    mutex.acquire( pSite );
+
+    --mWaiters;
     mutex.decWaiter( );
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p acquired mutex %p waiters %u/%u",
         this, &mutex, mWaiters, mutex.getWaiters() );
-    mutex.mTid = gettid( );
-    mutex.mAcqTime = systemTime(SYSTEM_TIME_MONOTONIC);
     return ret;
 }
+
+int Condition::waitRelative( Mutex& mutex, nsecs_t timeout )
+{
+    // A negative timeout is passed through, which waitInternal treats as no timeout.
+    return waitInternal( mutex, timeout, __builtin_return_address( 0 ) );
+}
+
 int Condition::wait( Mutex& mutex )
 {
-    ALOG_ASSERT( mbInit );
-    ALOG_ASSERT( mutex.mTid == gettid( ) );
-    mutex.mTid = 0;
-    mutex.incWaiter( );
-    ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p releasing mutex %p waiters %u/%u",
-        this, &mutex, mWaiters, mutex.getWaiters() );
-    int ret = mCondition.wait( mutex.mMutex );
-    mutex.decWaiter( );
-    ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p acquired mutex %p waiters %u/%u",
-        this, &mutex, mWaiters, mutex.getWaiters() );
-    mutex.mTid = gettid( );
-    mutex.mAcqTime = systemTime(SYSTEM_TIME_MONOTONIC);
-    return ret;
+    return waitInternal( mutex, -1, __builtin_return_address( 0 ) );
 }
+
 void Condition::signal( )
 {
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p signalled [waiters:%u]", this, mWaiters );
     ALOG_ASSERT( mbInit );
-    mCondition.signal( );
+    mSequence.fetch_add( 1, std::memory_order_release );
+    futexWake( &mSequence, 1 );
 }
+
 void Condition::broadcast( )
 {
     ALOGD_IF( MUTEX_CONDITION_DEBUG, "Condition %p broadcast [waiters:%u]", this, mWaiters );
     ALOG_ASSERT( mbInit );
-    mCondition.broadcast( );
+    mSequence.fetch_add( 1, std::memory_order_release );
+    futexWake( &mSequence, INT32_MAX );
 }
 
-#endif // VPG_HAVE_DEBUG_MUTEX
+#endif // VPG_HAVE_HWC_MUTEX
 
 }; // namespace hwc
 }; // namespace ufo
@@ -152,46 +152,80 @@ extern void dumpDisplaysContents(const char *pIdentifier, size_t numDisplays, hw
 
 #define VPG_HAVE_DEBUG_MUTEX            (INTEL_HWC_INTERNAL_BUILD)
 
-#if VPG_HAVE_DEBUG_MUTEX
+// Mutex contention statistics only add work to the contended path so they are on by default.
+#ifndef VPG_HAVE_MUTEX_STATS
+#define VPG_HAVE_MUTEX_STATS            1
+#endif
+
+#define VPG_HAVE_HWC_MUTEX              (VPG_HAVE_DEBUG_MUTEX || VPG_HAVE_MUTEX_STATS)
+
+#if VPG_HAVE_HWC_MUTEX
 
 
 #include <utils/Mutex.h>
 #include <utils/Condition.h>
+#include <atomic>
 
 namespace intel {
 namespace ufo {
 namespace hwc {
 
 
-// Wrapper Mutex and Condition classes that add some debug and trap deadlocks.
+// Wrapper Mutex and Condition classes that keep contention statistics and, with
+// VPG_HAVE_DEBUG_MUTEX, add some debug and trap deadlocks.
+// These are built directly on futexes so that a blocked thread sleeps until the lock is
+// released rather than polling for it. The long wait diagnostic uses the futex timeout.
+// The contention statistics are reported by dumpContention().
 class Mutex
 {
     public:
         static const uint64_t mLongTime = 1000000000;  //< 1 second.
-        static const uint32_t mSpinWait = 1000;        //< 1 millisecond.
         Mutex( );
         ~Mutex( );
         int lock( );
         int unlock( );
+        // Only tracked with VPG_HAVE_DEBUG_MUTEX.
         bool isHeld( void );
         void incWaiter( void );
         void decWaiter( void );
         uint32_t getWaiters( void );
+
+        // Report the most contended mutexes.
+        static String8 dumpContention( uint32_t maxMutexes = 16 );
+
         class Autolock
         {
             public:
-                Autolock( Mutex& m );
-                ~Autolock( );
+                // Inline so the lock site recorded is the caller, not the Autolock.
+                inline Autolock( Mutex& m ) : mMutex( m ) { mMutex.lock( ); }
+                inline ~Autolock( ) { mMutex.unlock( ); }
             private:
                 Mutex& mMutex;
         };
     private:
         friend class Condition;
+
+        // Acquire/release the futex without the ownership checks.
+        void acquire( const void* pSite );
+        void release( void );
+
         bool mbInit:1;
-        android::Mutex mMutex;
+        std::atomic<int32_t> mState;            //< 0: unlocked, 1: locked, 2: locked with waiters.
         pid_t   mTid;
         nsecs_t mAcqTime;
         uint32_t mWaiters;
+
+        // Contention statistics. These are updated while the mutex is held.
+        const void* mpAcqSite;                  //< Where the current holder acquired the mutex.
+        const void* mpContendedSite;            //< Holder site seen by the most recent contended acquisition.
+        uint64_t mAcquisitions;
+        uint64_t mContended;
+        nsecs_t  mTotalWait;
+        nsecs_t  mMaxWait;
+
+        // Registry of all mutexes for dumpContention.
+        Mutex*  mpPrev;
+        Mutex*  mpNext;
 };
 
 class Condition
@@ -199,20 +233,27 @@ class Condition
     public:
         Condition( );
         ~Condition( );
+        // A negative timeout waits indefinitely.
         int waitRelative( Mutex& mutex, nsecs_t timeout );
         int wait( Mutex& mutex );
         void signal( );
         void broadcast( );
     private:
+        int waitInternal( Mutex& mutex, nsecs_t timeout, const void* pSite );
+
         bool mbInit:1;
         uint32_t mWaiters;
-        android::Condition mCondition;
+        std::atomic<int32_t> mSequence;         //< Incremented by each signal/broadcast.
 };
 
 }; // namespace hwc
 }; // namespace ufo
 }; // namespace intel
 
+#endif // VPG_HAVE_HWC_MUTEX
+
+#if VPG_HAVE_DEBUG_MUTEX
+
 #define INTEL_UFO_HWC_ASSERT_MUTEX_HELD( M ) ALOG_ASSERT( M.isHeld() );
 #define INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( M ) ALOG_ASSERT( !M.isHeld() );
 
@@ -23,7 +23,8 @@ namespace intel {
 namespace ufo {
 namespace hwc {
 
-DebugFilter::DebugFilter()
+DebugFilter::DebugFilter() :
+    mStateSerial(0)
 {
     // Add this filter to the front of the filter list
     FilterManager::getInstance().add(*this, FilterPosition::Debug);
@@ -103,8 +104,21 @@ const Content& DebugFilter::onApply(const Content& ref)
     return mReference;
 }
 
+bool DebugFilter::getDependencySignature( uint64_t& signature ) const
+{
+    // Frame dumps must see every frame.
+    for (uint32_t d = 0; d < mDebugDisplay.size(); d++)
+    {
+        if (mDebugDisplay[d].mDumpFrames != 0)
+            return false;
+    }
+    signature = mStateSerial;
+    return true;
+}
+
 void DebugFilter::enableDisplay(uint32_t d)
 {
+    ++mStateSerial;
     if (mDebugDisplay.size() <= d)
         mDebugDisplay.insertAt(mDebugDisplay.size(), d + 1 - mDebugDisplay.size());
 
@@ -117,6 +131,7 @@ void DebugFilter::enableDisplay(uint32_t d)
 
 void DebugFilter::disableDisplay(uint32_t d, bool bBlank)
 {
+    ++mStateSerial;
     if (mDebugDisplay.size() <= d)
         mDebugDisplay.insertAt(mDebugDisplay.size(), d + 1 - mDebugDisplay.size());
 
@@ -131,6 +146,7 @@ void DebugFilter::disableDisplay(uint32_t d, bool bBlank)
 
 void DebugFilter::maskLayer(uint32_t d, uint32_t layer, bool bHide)
 {
+    ++mStateSerial;
     if (mDebugDisplay.size() < d + 1)
         mDebugDisplay.insertAt(mDebugDisplay.size(), d + 1 - mDebugDisplay.size());
 
@@ -144,6 +160,7 @@ void DebugFilter::maskLayer(uint32_t d, uint32_t layer, bool bHide)
 
 void DebugFilter::dumpFrames(uint32_t d, int32_t frames)
 {
+    ++mStateSerial;
     if (mDebugDisplay.size() < d + 1)
         mDebugDisplay.insertAt(mDebugDisplay.size(), d + 1 - mDebugDisplay.size());
 
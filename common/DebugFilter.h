@@ -19,6 +19,7 @@
 
 #include "AbstractFilter.h"
 #include "Singleton.h"
+#include <atomic>
 
 namespace intel {
 namespace ufo {
@@ -35,6 +36,7 @@ public:
     // This returns the name of the filter.
     const char* getName() const { return "DebugFilter"; }
     const Content& onApply(const Content& ref);
+    bool getDependencySignature( uint64_t& signature ) const;
 
     String8 dump();
 
@@ -69,6 +71,10 @@ private:
 
     // Handle up to 32 layers
     Vector<DisplayDebug> mDebugDisplay;
+
+    // Incremented by each public API call that changes the debug state.
+    // The calls come from the option and service threads and it is read on the prepare thread.
+    std::atomic<uint32_t> mStateSerial;
 };
 
 }; // namespace hwc
@@ -16,6 +16,7 @@
 
 #include "Common.h"
 #include "DisplayQueue.h"
+#include "ThreadManager.h"
 #include "Timeline.h"
 
 namespace intel {
@@ -1371,6 +1372,12 @@ void DisplayQueue::Worker::start( const String8& threadName )
     }
 }
 
+status_t DisplayQueue::Worker::readyToRun( )
+{
+    ThreadManager::get().registerThread( ThreadManager::eThreadFlip );
+    return NO_ERROR;
+}
+
 bool DisplayQueue::Worker::threadLoop( )
 {
 
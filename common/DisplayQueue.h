@@ -432,6 +432,7 @@ protected:
         void start( const String8& threadName );
         void stop( void );
 
+        virtual status_t readyToRun( );
         virtual bool threadLoop( );
 
     private:
@@ -0,0 +1,294 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "FenceLatencyTracker.h"
+#include "Layer.h"
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+void FenceLatencyTracker::Stats::clear()
+{
+    for (uint32_t b = 0; b < cBuckets; ++b)
+    {
+        maBuckets[b] = 0;
+    }
+    mSamples = 0;
+    mLate = 0;
+    mMissed = 0;
+    mMaxLateness = 0;
+}
+
+void FenceLatencyTracker::Stats::add(nsecs_t lateness, bool bMissed)
+{
+    // Bucket 0 is ready at onSet, then bucket b is lateness below 2^(b-1) milliseconds.
+    uint32_t bucket = 0;
+    if (lateness > 0)
+    {
+        bucket = 1;
+        while ((bucket < cBuckets - 1) && (lateness >= (nsecs_t(1000000) << (bucket - 1))))
+        {
+            ++bucket;
+        }
+    }
+    ++maBuckets[bucket];
+    ++mSamples;
+    if (lateness > cLateNs)
+    {
+        ++mLate;
+    }
+    if (bMissed)
+    {
+        ++mMissed;
+    }
+    if (lateness > mMaxLateness)
+    {
+        mMaxLateness = lateness;
+    }
+}
+
+String8 FenceLatencyTracker::Stats::dump() const
+{
+    String8 output = String8::format("samples:%u late:%u missed:%u max:%.2fms [ready",
+                                     mSamples, mLate, mMissed, float(mMaxLateness) / 1000000.0f);
+    for (uint32_t b = 0; b < cBuckets; ++b)
+    {
+        if (b == 0)
+            output.appendFormat(":%u", maBuckets[b]);
+        else if (b < cBuckets - 1)
+            output.appendFormat(" <%ums:%u", 1u << (b - 1), maBuckets[b]);
+        else
+            output.appendFormat(" >=%ums:%u", 1u << (b - 2), maBuckets[b]);
+    }
+    output += "]";
+    return output;
+}
+
+FenceLatencyTracker::FenceLatencyTracker() :
+    mOptionEnable("fencelatency", 0),
+    mDroppedSamples(0)
+{
+    mPending.reserve(cMaxPending);
+}
+
+FenceLatencyTracker::~FenceLatencyTracker()
+{
+    for (Pending& pending : mPending)
+    {
+        Timeline::closeFence(&pending.mFence);
+    }
+}
+
+void FenceLatencyTracker::record(uint32_t d, uint32_t ly, nsecs_t lateness, bool bMissed)
+{
+    Display& display = maDisplays[d];
+    display.mStats.add(lateness, bMissed);
+
+    if (ly >= display.mProducers.size())
+    {
+        return;
+    }
+    Producer& producer = display.mProducers[ly];
+    producer.mStats.add(lateness, bMissed);
+    producer.mHistory = (producer.mHistory << 1) | ((lateness > cLateNs) ? 1 : 0);
+
+    const uint32_t lateSamples = __builtin_popcount(producer.mHistory);
+    if (!producer.mbLate && (lateSamples >= cLateOnCount))
+    {
+        ALOGD_IF(sbInternalBuild, "FenceLatencyTracker: D%u L%u %p is late (%u/%u)",
+                 d, ly, producer.mHandle, lateSamples, cHistorySamples);
+        producer.mbLate = true;
+    }
+    else if (producer.mbLate && (lateSamples <= cLateOffCount))
+    {
+        ALOGD_IF(sbInternalBuild, "FenceLatencyTracker: D%u L%u %p is on time (%u/%u)",
+                 d, ly, producer.mHandle, lateSamples, cHistorySamples);
+        producer.mbLate = false;
+    }
+}
+
+void FenceLatencyTracker::pollPending(nsecs_t now)
+{
+    uint32_t kept = 0;
+    for (uint32_t p = 0; p < mPending.size(); ++p)
+    {
+        Pending& pending = mPending[p];
+        nsecs_t signalTime = 0;
+        const int32_t status = Timeline::querySignalTime(pending.mFence, &signalTime);
+        const bool bExpired = (now - pending.mSetTime) > cMaxPendingNs;
+        if ((status == 0) && !bExpired)
+        {
+            mPending[kept++] = pending;
+            continue;
+        }
+
+        // Drop samples for layers that have been reset since.
+        const Display& display = maDisplays[pending.mDisplay];
+        if ((pending.mLayer < display.mProducers.size())
+         && (display.mProducers[pending.mLayer].mGeneration == pending.mGeneration))
+        {
+            if (status == 1)
+            {
+                record(pending.mDisplay, pending.mLayer, signalTime - pending.mSetTime, signalTime > pending.mDeadline);
+            }
+            else if (status == 0)
+            {
+                record(pending.mDisplay, pending.mLayer, now - pending.mSetTime, true);
+            }
+        }
+        Timeline::closeFence(&pending.mFence);
+    }
+    mPending.resize(kept);
+}
+
+void FenceLatencyTracker::onSet(const Content& input, size_t numDisplays, hwc_display_contents_1_t** ppDisplayContents)
+{
+    if (!mOptionEnable)
+    {
+        return;
+    }
+
+    ATRACE_NAME_IF(HWC_TRACE, "FenceLatencyTracker::onSet");
+    Mutex::Autolock _l(mLock);
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    pollPending(now);
+
+    numDisplays = min(min(numDisplays, size_t(cMaxSupportedSFDisplays)), size_t(input.size()));
+    for (uint32_t d = 0; d < numDisplays; ++d)
+    {
+        Display& display = maDisplays[d];
+        const hwc_display_contents_1_t* pDisp = ppDisplayContents[d];
+        const Content::Display& inputDisplay = input.getDisplay(d);
+        if ((pDisp == NULL) || (pDisp->numHwLayers < 1) || !inputDisplay.isEnabled())
+        {
+            display.mProducers.clear();
+            continue;
+        }
+
+        // A flip queued now lands on the next vsync at the latest.
+        const uint32_t refresh = inputDisplay.getRefresh() ? inputDisplay.getRefresh() : INTEL_HWC_DEFAULT_REFRESH_RATE;
+        const nsecs_t deadline = now + (nsecs_t(1000000000) / refresh);
+
+        // The last layer is the framebuffer target.
+        const Content::LayerStack& stack = inputDisplay.getLayerStack();
+        const uint32_t numLayers = min(uint32_t(pDisp->numHwLayers - 1), stack.size());
+        display.mProducers.resize(numLayers);
+
+        for (uint32_t ly = 0; ly < numLayers; ++ly)
+        {
+            const hwc_layer_1_t& hwcLayer = pDisp->hwLayers[ly];
+            Producer& producer = display.mProducers[ly];
+
+            // A new or moved layer may be a different producer.
+            if (stack.getLayerChanges(ly) & (Content::CHANGE_LAYER_ADDED | Content::CHANGE_LAYER_MOVED))
+            {
+                const uint32_t generation = producer.mGeneration + 1;
+                producer = Producer();
+                producer.mGeneration = generation;
+            }
+            producer.mHandle = hwcLayer.handle;
+
+            // Layers composed by SurfaceFlinger never reach us.
+            if ((hwcLayer.compositionType != HWC_OVERLAY) || (hwcLayer.handle == NULL))
+            {
+                continue;
+            }
+
+            nsecs_t signalTime = 0;
+            const int32_t status = Timeline::isValid(hwcLayer.acquireFenceFd)
+                                 ? Timeline::querySignalTime(hwcLayer.acquireFenceFd, &signalTime) : 1;
+            if (status == 1)
+            {
+                // No fence means the buffer was ready.
+                record(d, ly, signalTime ? (signalTime - now) : 0, false);
+            }
+            else if (status == 0)
+            {
+                if (mPending.size() >= cMaxPending)
+                {
+                    ++mDroppedSamples;
+                    continue;
+                }
+                Pending pending;
+                pending.mFence = Timeline::dupFence(&hwcLayer.acquireFenceFd);
+                if (!Timeline::isValid(pending.mFence))
+                {
+                    continue;
+                }
+                pending.mDisplay = d;
+                pending.mLayer = ly;
+                pending.mGeneration = producer.mGeneration;
+                pending.mSetTime = now;
+                pending.mDeadline = deadline;
+                mPending.push_back(pending);
+            }
+        }
+    }
+
+    for (uint32_t d = numDisplays; d < cMaxSupportedSFDisplays; ++d)
+    {
+        maDisplays[d].mProducers.clear();
+    }
+}
+
+bool FenceLatencyTracker::isLateProducer(uint32_t d, uint32_t ly)
+{
+    if (!mOptionEnable || (d >= cMaxSupportedSFDisplays))
+    {
+        return false;
+    }
+    Mutex::Autolock _l(mLock);
+    const Display& display = maDisplays[d];
+    return (ly < display.mProducers.size()) && display.mProducers[ly].mbLate;
+}
+
+String8 FenceLatencyTracker::dump()
+{
+    if (!mOptionEnable)
+    {
+        return String8();
+    }
+
+    Mutex::Autolock _l(mLock);
+    String8 output = String8::format("Acquire fence lateness after onSet, pending:%zu dropped:%u\n",
+                                     mPending.size(), mDroppedSamples);
+    for (uint32_t d = 0; d < cMaxSupportedSFDisplays; ++d)
+    {
+        const Display& display = maDisplays[d];
+        if (display.mStats.mSamples == 0)
+        {
+            continue;
+        }
+        output.appendFormat("  Display %u %s\n", d, display.mStats.dump().string());
+        for (uint32_t ly = 0; ly < display.mProducers.size(); ++ly)
+        {
+            const Producer& producer = display.mProducers[ly];
+            if (producer.mStats.mSamples == 0)
+            {
+                continue;
+            }
+            output.appendFormat("    L%-2u %p %s%s\n", ly, producer.mHandle,
+                                producer.mStats.dump().string(), producer.mbLate ? " LATE" : "");
+        }
+    }
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,134 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_FENCELATENCYTRACKER_H
+#define INTEL_UFO_HWC_FENCELATENCYTRACKER_H
+
+#include "Common.h"
+#include "Content.h"
+#include "Option.h"
+#include "Singleton.h"
+#include "Timeline.h"
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class measures when the acquire fence of each layer signals relative to the onSet that
+// presented it and to the flip deadline of that frame (the following vsync).
+// HWC1 does not provide layer names, so a producer is identified by its SurfaceFlinger display
+// and layer index; the statistics for a layer are reset whenever it is added or moved.
+// A producer that repeatedly delivers buffers after onSet is flagged as late. The InputAnalyzer
+// passes that on as a layer hint so that the plane allocator can keep it off the composition
+// path, where it would stall every other layer in the frame.
+// Sampling costs a fence info query per overlay layer per frame, so tracking is off by default
+// and is enabled with the option intel.hwc.fencelatency.
+class FenceLatencyTracker : public Singleton<FenceLatencyTracker>
+{
+public:
+    static FenceLatencyTracker& get() { return getInstance(); }
+
+    // Sample the acquire fences of the layers presented by SurfaceFlinger.
+    // Must be called at the start of onSet, before any acquire fences are consumed.
+    // The input content supplies the refresh rate and the layer changes for this frame.
+    void onSet(const Content& input, size_t numDisplays, hwc_display_contents_1_t** ppDisplayContents);
+
+    // Is the producer of layer ly on SurfaceFlinger display d currently flagged as late.
+    bool isLateProducer(uint32_t d, uint32_t ly);
+
+    String8 dump();
+
+private:
+    friend class Singleton<FenceLatencyTracker>;
+
+    FenceLatencyTracker();
+    ~FenceLatencyTracker();
+
+    // Lateness relative to onSet is histogrammed as ready, then power of two milliseconds up to 32ms.
+    static const uint32_t cBuckets = 8;
+
+    // A fence that signals more than this after onSet counts as late.
+    static const nsecs_t cLateNs = 1000000;
+
+    // Hysteresis over the most recent samples (one bit per sample) for flagging a producer.
+    static const uint32_t cHistorySamples = 16;
+    static const uint32_t cLateOnCount = 8;
+    static const uint32_t cLateOffCount = 2;
+
+    // Fences still unsignaled after this are recorded as missed without a signal time.
+    static const nsecs_t cMaxPendingNs = 1000000000;
+    static const uint32_t cMaxPending = 64;
+
+    struct Stats
+    {
+        Stats() { clear(); }
+        void clear();
+        void add(nsecs_t lateness, bool bMissed);
+        String8 dump() const;
+
+        uint32_t        maBuckets[cBuckets];
+        uint32_t        mSamples;
+        uint32_t        mLate;          // Samples that signaled more than cLateNs after onSet.
+        uint32_t        mMissed;        // Samples that signaled after the flip deadline.
+        nsecs_t         mMaxLateness;
+    };
+
+    struct Producer
+    {
+        Producer() : mHandle(NULL), mGeneration(0), mHistory(0), mbLate(false) {}
+
+        Stats           mStats;
+        buffer_handle_t mHandle;        // Most recent buffer, to identify the producer in the dump.
+        uint32_t        mGeneration;    // Advanced when the layer is reset, to discard pending samples.
+        uint16_t        mHistory;       // Late (1) or on time (0) for the most recent samples.
+        bool            mbLate;
+    };
+
+    struct Display
+    {
+        Stats                   mStats;
+        std::vector<Producer>   mProducers;
+    };
+
+    // A sample whose fence had not signaled at onSet.
+    struct Pending
+    {
+        Timeline::NativeFence mFence;  // Our duplicate of the acquire fence.
+        uint32_t        mDisplay;
+        uint32_t        mLayer;
+        uint32_t        mGeneration;
+        nsecs_t         mSetTime;
+        nsecs_t         mDeadline;
+    };
+
+    // Retire any pending samples whose fences have since signaled.
+    void pollPending(nsecs_t now);
+
+    void record(uint32_t d, uint32_t ly, nsecs_t lateness, bool bMissed);
+
+    Option                  mOptionEnable;
+    Mutex                   mLock;
+    Display                 maDisplays[cMaxSupportedSFDisplays];
+    std::vector<Pending>    mPending;
+    uint32_t                mDroppedSamples;    // Unsignaled samples not tracked because mPending was full.
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_FENCELATENCYTRACKER_H
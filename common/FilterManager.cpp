@@ -34,6 +34,7 @@ const Content& FilterManager::onApply(const Content& ref, FilterPosition first,
     ALOGD_IF(FILTER_DEBUG, "%s", ref.dump("FilterManager::onApply").string());
     // Apply all the filters to the input
     const Content* pRef = &ref;
+    uint64_t generation = ref.getGeneration();
     for (uint32_t f = 0; f < mFilters.size(); f++)
     {
         // Skip any filters outside the first to last range
@@ -43,7 +44,7 @@ const Content& FilterManager::onApply(const Content& ref, FilterPosition first,
             break;
 
         AbstractFilter* pFilter = mFilters[f].mpFilter;
-        const Content* pNewRef = &pFilter->onApply(*pRef);
+        const Content* pNewRef = applyFilter(mFilters.editItemAt(f), pRef, generation);
 
 #if INTEL_HWC_INTERNAL_BUILD
         validateGeometryChange( String8::format( "F%d %s%s",
@@ -56,9 +57,7 @@ const Content& FilterManager::onApply(const Content& ref, FilterPosition first,
         if (pNewRef != pRef)
         {
             // If the reference changed, then log the change
-            Log::add(*pNewRef, String8::format( "%s %s",
-                                                pFilter->getName(),
-                                                pFilter->outputsPhysicalDisplays() ? "P" : "SF" ).string() );
+            Log::add(*pNewRef, "%s %s", pFilter->getName(), pFilter->outputsPhysicalDisplays() ? "P" : "SF" );
             ALOGD_IF(FILTER_DEBUG, "Filter:%s", pNewRef->dump(pFilter->getName()).string());
             pRef = pNewRef;
         }
@@ -68,6 +67,195 @@ const Content& FilterManager::onApply(const Content& ref, FilterPosition first,
     return *pRef;
 }
 
+const Content* FilterManager::applyFilter( Entry& entry, const Content* pRef, uint64_t& generation )
+{
+    AbstractFilter* pFilter = entry.mpFilter;
+
+    uint64_t signature = 0;
+    const bool bCacheable = !pFilter->outputsPhysicalDisplays() && pFilter->getDependencySignature( signature );
+
+    if ( bCacheable
+      && entry.mbCached
+      && ( entry.mpLastInput == pRef )
+      && ( entry.mInputGeneration == generation )
+      && ( entry.mSignature == signature ) )
+    {
+        ++entry.mSkipped;
+        generation = entry.mOutputGeneration;
+        ALOGD_IF(FILTER_DEBUG, "Filter:%s unchanged input generation %" PRIu64 ", reusing output", pFilter->getName(), generation);
+
+        if ( entry.mbPassThrough )
+        {
+            return pRef;
+        }
+
+        // The cached output is only stale in per-frame display and layer state.
+        // An unchanged generation implies there is no geometry change.
+        for ( uint32_t d = 0; ( d < entry.mCachedOutput.size() ) && ( d < pRef->size() ); ++d )
+        {
+            const Content::Display& in = pRef->getDisplay(d);
+            Content::Display& out = entry.mCachedOutput.editDisplay(d);
+            out.setFrameIndex( in.getFrameIndex() );
+            out.setFrameReceivedTime( in.getFrameReceivedTime() );
+            out.setGeometryChanged( false );
+        }
+        refreshOutputLayers( entry, *pRef );
+        return &entry.mCachedOutput;
+    }
+
+    ++entry.mApplied;
+    const Content* pNewRef = &pFilter->onApply(*pRef);
+
+    // Outputs that differ from the input get a new generation so downstream filters re-apply.
+    const uint64_t inputGeneration = generation;
+    if ( pNewRef != pRef )
+    {
+        generation = Content::allocateGeneration();
+    }
+
+    entry.mbCached = bCacheable;
+    if ( bCacheable )
+    {
+        entry.mpLastInput = pRef;
+        entry.mInputGeneration = inputGeneration;
+        entry.mOutputGeneration = generation;
+        entry.mSignature = signature;
+        entry.mbPassThrough = ( pNewRef == pRef );
+        if ( entry.mbPassThrough )
+        {
+            entry.mCachedOutput.resize(0);
+        }
+        else
+        {
+            entry.mCachedOutput = *pNewRef;
+            cacheOutputLayers( entry, *pRef );
+        }
+    }
+    else if ( entry.mCachedOutput.size() )
+    {
+        entry.mCachedOutput.resize(0);
+    }
+
+    return pNewRef;
+}
+
+void FilterManager::cacheOutputLayers( Entry& entry, const Content& input )
+{
+    for ( uint32_t d = 0; d < cMaxSupportedSFDisplays; ++d )
+    {
+        std::vector<Layer>& storage = entry.maCachedLayers[d];
+        std::vector<int32_t>& sources = entry.maSourceLayer[d];
+        std::vector<uint32_t>& dropped = entry.maDroppedLayers[d];
+        dropped.clear();
+        if ( d >= entry.mCachedOutput.size() )
+        {
+            storage.clear();
+            sources.clear();
+            continue;
+        }
+
+        Content::LayerStack& out = entry.mCachedOutput.editDisplay(d).editLayerStack();
+        const Content::LayerStack* pIn = ( d < input.size() ) ? &input.getDisplay(d).getLayerStack() : NULL;
+        const uint32_t inLayers = pIn ? pIn->size() : 0;
+        storage.resize( out.size() );
+        sources.assign( out.size(), cSourceShared );
+
+        std::vector<bool> used( inLayers, false );
+        for ( uint32_t ly = 0; ly < out.size(); ++ly )
+        {
+            // Layers passed through from the input are refreshed upstream.
+            const Layer* pLayer = out.getLayerArray()[ly];
+            bool bShared = false;
+            for ( uint32_t i = 0; ( i < inLayers ) && !bShared; ++i )
+            {
+                if ( pIn->getLayerArray()[i] == pLayer )
+                {
+                    bShared = true;
+                    used[i] = true;
+                }
+            }
+            if ( bShared )
+            {
+                continue;
+            }
+
+            // Otherwise the source is the first input layer with the same buffer not already claimed.
+            int32_t source = cSourceNone;
+            for ( uint32_t i = 0; ( i < inLayers ) && pLayer->getHandle() && ( source == cSourceNone ); ++i )
+            {
+                if ( !used[i] && ( pIn->getLayer(i).getHandle() == pLayer->getHandle() ) )
+                {
+                    source = i;
+                    used[i] = true;
+                }
+            }
+            sources[ly] = source;
+            out.editLayer( ly, storage );
+        }
+
+        for ( uint32_t i = 0; i < inLayers; ++i )
+        {
+            if ( !used[i] )
+            {
+                dropped.push_back( i );
+            }
+        }
+    }
+}
+
+void FilterManager::refreshOutputLayers( Entry& entry, const Content& input )
+{
+    for ( uint32_t d = 0; ( d < entry.mCachedOutput.size() ) && ( d < input.size() ) && ( d < cMaxSupportedSFDisplays ); ++d )
+    {
+        const Content::LayerStack& in = input.getDisplay(d).getLayerStack();
+        std::vector<Layer>& storage = entry.maCachedLayers[d];
+        const std::vector<int32_t>& sources = entry.maSourceLayer[d];
+        for ( uint32_t ly = 0; ly < sources.size(); ++ly )
+        {
+            const int32_t source = sources[ly];
+            if ( source == cSourceShared )
+            {
+                continue;
+            }
+            Layer& layer = storage[ly];
+            if ( ( source >= 0 ) && ( uint32_t(source) < in.size() ) )
+            {
+                // Frame rate, fences and detected buffer state follow the input layer, but the
+                // flags derived from the filter's own geometry must be recalculated.
+                const Layer& src = in.getLayer( source );
+                layer.onUpdateFrameState( src );
+                layer.onUpdateFlags();
+                layer.setChanges( src.getChanges() );
+            }
+            else
+            {
+                // A layer the filter created is unchanged from the last frame.
+                layer.setChanges( 0 );
+            }
+        }
+
+        // The dropped layers will not be presented this frame either.
+        for ( uint32_t i : entry.maDroppedLayers[d] )
+        {
+            if ( i < in.size() )
+            {
+                const Layer& layer = in.getLayer( i );
+                layer.closeAcquireFence();
+                layer.returnReleaseFence( -1 );
+            }
+        }
+    }
+}
+
+void FilterManager::invalidateCaches()
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    for ( uint32_t f = 0; f < mFilters.size(); f++ )
+    {
+        mFilters.editItemAt(f).mbCached = false;
+    }
+}
+
 int FilterManager::compareFilterPositions( const FilterManager::Entry* lhs, const FilterManager::Entry* rhs )
 {
     return static_cast<uint32_t>(lhs->mPosition) - static_cast<uint32_t>(rhs->mPosition);
@@ -85,6 +273,7 @@ void FilterManager::add(AbstractFilter& filter, FilterPosition position)
                   position, filter.outputsPhysicalDisplays( ), FilterPosition::DisplayManager );
     mFilters.add(e);
     mFilters.sort( compareFilterPositions );
+    invalidateCaches();
 }
 
 void FilterManager::remove(AbstractFilter& filter)
@@ -98,6 +287,7 @@ void FilterManager::remove(AbstractFilter& filter)
         {
             ALOGD_IF(FILTER_DEBUG, "Filter:%d %s(%p) Removing", f, mFilters[f].mpFilter->getName(), &mFilters[f].mpFilter);
             mFilters.removeAt(f);
+            invalidateCaches();
             break;
         }
     }
@@ -133,6 +323,18 @@ String8 FilterManager::dump()
         }
     }
 
+    output.append("Filter memoization applied/skipped(skip rate):");
+    for (const Entry& f : mFilters)
+    {
+        if ( f.mSkipped || f.mbCached )
+        {
+            const uint64_t frames = f.mApplied + f.mSkipped;
+            output.appendFormat(" %s:%" PRIu64 "/%" PRIu64 "(%" PRIu64 "%%)", f.mpFilter->getName(), f.mApplied, f.mSkipped,
+                                frames ? ( f.mSkipped * 100 ) / frames : 0);
+        }
+    }
+    output.append("\n");
+
     return output;
 }
 
@@ -24,6 +24,7 @@
 #include "Singleton.h"
 #include <utils/SortedVector.h>
 #include <utils/Mutex.h>
+#include <vector>
 
 namespace intel {
 namespace ufo {
@@ -63,13 +64,55 @@ private:
     class Entry
     {
     public:
-        Entry() : mpFilter(NULL), mPosition(FilterPosition::Invalid) {}
-        Entry(AbstractFilter& filter, FilterPosition position) : mpFilter(&filter), mPosition(position) {}
+        Entry() : mpFilter(NULL), mPosition(FilterPosition::Invalid) { resetCache(); }
+        Entry(AbstractFilter& filter, FilterPosition position) : mpFilter(&filter), mPosition(position) { resetCache(); }
+        void resetCache() { mpLastInput = NULL; mInputGeneration = mOutputGeneration = mSignature = 0;
+                            mbCached = mbPassThrough = false; mApplied = mSkipped = 0; }
         AbstractFilter* mpFilter;
         FilterPosition  mPosition;
+
+        // Memoization state (see AbstractFilter::getDependencySignature).
+        const Content*  mpLastInput;        // Input content object on the last apply.
+        uint64_t        mInputGeneration;   // Input generation on the last apply.
+        uint64_t        mOutputGeneration;  // Generation assigned to the output of the last apply.
+        uint64_t        mSignature;         // Filter signature on the last apply.
+        bool            mbCached:1;         // The fields above are valid.
+        bool            mbPassThrough:1;    // The last apply returned its input unmodified.
+        Content         mCachedOutput;      // Copy of the last output (if not pass through).
+        uint64_t        mApplied;           // Number of frames the filter was applied.
+        uint64_t        mSkipped;           // Number of frames the cached output was reused.
+
+        // The cached output's own layers (those not shared with the input) are copied here so
+        // their per-frame state can be refreshed when the output is reused.
+        // maSourceLayer gives the input layer each output layer was built from (or a cSource value).
+        std::vector<Layer>      maCachedLayers[ cMaxSupportedSFDisplays ];
+        std::vector<int32_t>    maSourceLayer[ cMaxSupportedSFDisplays ];
+        // Input layers the filter left out of its output.
+        std::vector<uint32_t>   maDroppedLayers[ cMaxSupportedSFDisplays ];
     };
     Vector<Entry> mFilters;
 
+    // Source of a cached output layer that is shared with the input (so is always current).
+    static const int32_t cSourceShared = -1;
+    // Source of a cached output layer that the filter created itself.
+    static const int32_t cSourceNone = -2;
+
+    // Copy the filter's own output layers into the entry so that they outlive the frame,
+    // and record which input layer each was built from and which input layers were dropped.
+    void                    cacheOutputLayers( Entry& entry, const Content& input );
+
+    // Refresh per-frame layer state in a reused output from the current input, and complete the
+    // fences of the input layers that the output drops (as LayerStack::removeLayer would).
+    void                    refreshOutputLayers( Entry& entry, const Content& input );
+
+    // Drop all cached outputs. The cached layers are referenced by pointer so they must be
+    // dropped whenever mFilters may reallocate.
+    void                    invalidateCaches();
+
+    // Applies one filter or reuses its cached output if its input and signature are unchanged.
+    // The generation is updated to the generation of the returned content.
+    const Content*          applyFilter( Entry& entry, const Content* pRef, uint64_t& generation );
+
     // Sorting comparison function.
     static int compareFilterPositions( const FilterManager::Entry* lhs, const FilterManager::Entry* rhs );
 
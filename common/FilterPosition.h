@@ -35,11 +35,14 @@ enum class FilterPosition : uint32_t
     Debug                   =      50,
     ClonedVideoLayer        =     500,
     SurfaceFlinger          =     600,
+    OpaqueDetection         =    4000,
     VisibleRect             =    5000,
+    Occlusion               =    5200,
     Empty                   =    5500,
     SyncFilter              =    6000,
     Rotate180               =    6500,
     Transparency            =    7000,
+    SolidColor              =    7500,
     VideoModeDetection      =    8000,
     Protected               =   11000,
     DisplayManager          =   13000,
@@ -0,0 +1,225 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "FrameArena.h"
+#include <malloc.h>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+FrameArena::FrameArena() :
+    mOptionHeap("arenaheap", 0, false),
+    mCursor(0),
+    mNumBlocks(0),
+    mAllocations(0),
+    mBytes(0),
+    mHeapAllocations(0),
+    mFrameStartHeapBytes(0),
+    mLastAllocations(0),
+    mLastBytes(0),
+    mLastHeapAllocations(0),
+    mLastHeapDelta(0),
+    mFrames(0),
+    mHeapFrames(0),
+    mTotalHeapAllocations(0),
+    mHeapGrowthFrames(0),
+    mMaxHeapGrowth(0),
+    mPeakBytes(0)
+{
+    for (uint32_t b = 0; b < cMaxBlocks; ++b)
+    {
+        maBlocks[b] = NULL;
+    }
+
+    // The first block is allocated up front so that the cursor never has to be rewound to
+    // the start of a block that other threads may already be allocating from.
+    maBlocks[0] = new(std::nothrow) uint8_t[cBlockSize];
+    if (maBlocks[0] != NULL)
+    {
+        mNumBlocks = 1;
+    }
+    mFrameStartHeapBytes = getHeapBytes();
+}
+
+FrameArena::~FrameArena()
+{
+    for (void* p : mLargeAllocations)
+    {
+        ::operator delete(p);
+    }
+    for (uint32_t b = 0; b < mNumBlocks; ++b)
+    {
+        delete [] maBlocks[b].load();
+    }
+}
+
+size_t FrameArena::getHeapBytes()
+{
+    if (!mOptionHeap)
+    {
+        return 0;
+    }
+    // Neither bionic nor glibc count individual mallocs for us, so the process wide bytes
+    // in use is the best measure available here. Note mallinfo reports this as an int.
+    struct mallinfo info = mallinfo();
+    return (uint32_t)info.uordblks;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align)
+{
+    ALOG_ASSERT(align && ((align & (align - 1)) == 0));
+    ALOG_ASSERT(align <= alignof(max_align_t));
+
+    if (bytes > cMaxArenaAllocation)
+    {
+        return allocateLarge(bytes);
+    }
+
+    // Claim enough space to align the allocation within the block.
+    const size_t request = bytes + align - 1;
+    for (;;)
+    {
+        const uint64_t cursor = mCursor.fetch_add(request, std::memory_order_relaxed);
+        const uint32_t block = getCursorBlock(cursor);
+        const size_t offset = getCursorOffset(cursor);
+        uint8_t* pBlock = maBlocks[block].load(std::memory_order_acquire);
+        if (pBlock && (offset + request <= cBlockSize))
+        {
+            mAllocations.fetch_add(1, std::memory_order_relaxed);
+            mBytes.fetch_add(request, std::memory_order_relaxed);
+            return (void*)(((uintptr_t)(pBlock + offset) + align - 1) & ~(uintptr_t)(align - 1));
+        }
+        if (!nextBlock(cursor))
+        {
+            return allocateLarge(bytes);
+        }
+    }
+}
+
+bool FrameArena::nextBlock(uint64_t cursor)
+{
+    Mutex::Autolock _l(mLock);
+
+    // Another thread may already have moved the cursor on.
+    const uint32_t block = getCursorBlock(cursor);
+    if (getCursorBlock(mCursor.load(std::memory_order_relaxed)) != block)
+    {
+        return true;
+    }
+
+    // Without a current block (it failed to allocate) there is nowhere to move on from.
+    if (maBlocks[block].load(std::memory_order_relaxed) == NULL)
+    {
+        return false;
+    }
+    const uint32_t next = block + 1;
+    if (next >= cMaxBlocks)
+    {
+        return false;
+    }
+    if (maBlocks[next].load(std::memory_order_relaxed) == NULL)
+    {
+        uint8_t* pBlock = new(std::nothrow) uint8_t[cBlockSize];
+        if (pBlock == NULL)
+        {
+            ALOGE("FrameArena: Failed to allocate block");
+            return false;
+        }
+        maBlocks[next].store(pBlock, std::memory_order_release);
+        ++mNumBlocks;
+        ++mHeapAllocations;
+    }
+    mCursor.store(makeCursor(next, 0), std::memory_order_relaxed);
+    return true;
+}
+
+void* FrameArena::allocateLarge(size_t bytes)
+{
+    void* p = ::operator new(bytes, std::nothrow);
+    if (p == NULL)
+    {
+        ALOGE("FrameArena: Failed to allocate %zu bytes", bytes);
+        return NULL;
+    }
+    Mutex::Autolock _l(mLock);
+    mLargeAllocations.push_back(p);
+    mBytes.fetch_add(bytes, std::memory_order_relaxed);
+    mAllocations.fetch_add(1, std::memory_order_relaxed);
+    ++mHeapAllocations;
+    return p;
+}
+
+void FrameArena::reset()
+{
+    Mutex::Autolock _l(mLock);
+
+    for (void* p : mLargeAllocations)
+    {
+        ::operator delete(p);
+    }
+    mLargeAllocations.clear();
+    mCursor.store(makeCursor(0, 0), std::memory_order_relaxed);
+
+    const size_t heapBytes = getHeapBytes();
+    const size_t bytes = mBytes.load(std::memory_order_relaxed);
+
+    mLastAllocations = mAllocations.load(std::memory_order_relaxed);
+    mLastBytes = bytes;
+    mLastHeapAllocations = mHeapAllocations;
+    // Only compare two real samples (the option may have just been switched).
+    mLastHeapDelta = (heapBytes && mFrameStartHeapBytes) ? (ssize_t)heapBytes - (ssize_t)mFrameStartHeapBytes : 0;
+    ++mFrames;
+    if (mHeapAllocations)
+    {
+        ++mHeapFrames;
+        mTotalHeapAllocations += mHeapAllocations;
+    }
+    if (mLastHeapDelta > 0)
+    {
+        ++mHeapGrowthFrames;
+        mMaxHeapGrowth = max(mMaxHeapGrowth, (size_t)mLastHeapDelta);
+    }
+    if (bytes > mPeakBytes)
+    {
+        mPeakBytes = bytes;
+    }
+    mAllocations.store(0, std::memory_order_relaxed);
+    mBytes.store(0, std::memory_order_relaxed);
+    mHeapAllocations = 0;
+    mFrameStartHeapBytes = heapBytes;
+}
+
+String8 FrameArena::dump()
+{
+    Mutex::Autolock _l(mLock);
+    String8 output = String8::format("FrameArena blocks:%u (%zuKB) last frame: allocs:%u bytes:%zu heap:%u"
+                                     " frames:%u heap frames:%u heap allocs:%" PRIu64 " peak:%zu",
+                                     mNumBlocks, (mNumBlocks * cBlockSize) / 1024,
+                                     mLastAllocations, mLastBytes, mLastHeapAllocations,
+                                     mFrames, mHeapFrames, mTotalHeapAllocations, mPeakBytes);
+    if (mOptionHeap)
+    {
+        output.appendFormat(" process heap in use last frame:%+zdB grew in frames:%u max growth:%zuB",
+                            mLastHeapDelta, mHeapGrowthFrames, mMaxHeapGrowth);
+    }
+    output.append("\n");
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
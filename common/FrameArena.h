@@ -0,0 +1,138 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_FRAMEARENA_H
+#define INTEL_UFO_HWC_FRAMEARENA_H
+
+#include "Common.h"
+#include "Option.h"
+#include "Singleton.h"
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class is a bump allocator for scratch memory that only needs to live for the
+// duration of a single frame (prepare through set). Allocations are carved from a set of
+// blocks that are retained across frames, so once the arena has grown to the working set
+// of a frame, steady state frames make no heap allocations at all.
+// The common path is a single atomic add on a shared cursor so worker threads can allocate
+// concurrently without a lock; the lock is only taken to move on to a new block or for
+// oversized requests.
+// Memory is released in one go by reset() at the end of Hwc::onSet; destructors are never
+// run, so only trivially destructible types may be allocated. reset() must not race with
+// allocations.
+// With the option intel.hwc.arenaheap the arena also samples the process heap in use at each
+// reset and reports how much it changed over the frame. This is the net change in bytes in use
+// by the whole process (from mallinfo, which walks the heap), not a count of allocations, so
+// it is off by default.
+class FrameArena : public Singleton<FrameArena>
+{
+public:
+    static FrameArena& get() { return getInstance(); }
+
+    // Allocate bytes aligned to align (which must be a power of two).
+    // Returns NULL if the heap is exhausted.
+    void* allocate(size_t bytes, size_t align = alignof(max_align_t));
+
+    // Allocate and default construct an array of count objects.
+    template<class T> T* allocateArray(uint32_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena objects are never destroyed");
+        T* pItems = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        if (pItems)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                new(&pItems[i]) T();
+            }
+        }
+        return pItems;
+    }
+
+    // Release all allocations made this frame and update the frame statistics.
+    // Any memory allocated from the arena must not be used after this.
+    void reset();
+
+    String8 dump();
+
+private:
+    friend class Singleton<FrameArena>;
+
+    FrameArena();
+    ~FrameArena();
+
+    // Size of each block. Requests larger than a quarter of this go straight to the heap.
+    static const size_t cBlockSize = 64 * 1024;
+    static const size_t cMaxArenaAllocation = cBlockSize / 4;
+    // Maximum number of retained blocks. Beyond this requests go straight to the heap.
+    static const uint32_t cMaxBlocks = 32;
+
+    // The cursor packs the current block index (top 32 bits) with the offset of the next
+    // free byte in that block (bottom 32 bits) so both are claimed by one atomic add.
+    static uint64_t makeCursor(uint32_t block, uint32_t offset) { return ((uint64_t)block << 32) | offset; }
+    static uint32_t getCursorBlock(uint64_t cursor)             { return (uint32_t)(cursor >> 32); }
+    static uint32_t getCursorOffset(uint64_t cursor)            { return (uint32_t)cursor; }
+
+    // Make sure a block with space follows the cursor value that failed.
+    // The cursor only ever moves on to a later block, never back to the start of the same one,
+    // so space already claimed from a block is never handed out twice.
+    // Returns false if the arena is out of blocks.
+    bool nextBlock(uint64_t cursor);
+
+    void* allocateLarge(size_t bytes);
+
+    // Process heap bytes in use (zero unless the arenaheap option is enabled).
+    size_t getHeapBytes();
+
+    Option                  mOptionHeap;        // Sample the process heap at each reset.
+    Mutex                   mLock;              // Taken for block changes, large allocations and reset.
+
+    std::atomic<uint64_t>   mCursor;
+    std::atomic<uint8_t*>   maBlocks[ cMaxBlocks ];     // Retained blocks, in order of use.
+    uint32_t                mNumBlocks;
+    std::vector<void*>      mLargeAllocations;  // Oversized allocations released on reset.
+
+    // Statistics for the frame in progress.
+    std::atomic<uint32_t>   mAllocations;       // Allocations served from the arena.
+    std::atomic<size_t>     mBytes;             // Bytes allocated from the arena (including alignment).
+    uint32_t                mHeapAllocations;   // Heap allocations (new blocks and oversized requests).
+    size_t                  mFrameStartHeapBytes;   // Process heap bytes in use at the start of the frame (if sampled).
+
+    // Statistics for the last completed frame.
+    uint32_t                mLastAllocations;
+    size_t                  mLastBytes;
+    uint32_t                mLastHeapAllocations;
+    ssize_t                 mLastHeapDelta;     // Change in process heap bytes in use (if sampled).
+
+    // Running statistics.
+    uint32_t                mFrames;            // Completed frames.
+    uint32_t                mHeapFrames;        // Frames where the arena made any heap allocation.
+    uint64_t                mTotalHeapAllocations;
+    uint32_t                mHeapGrowthFrames;  // Frames where the process heap grew.
+    size_t                  mMaxHeapGrowth;     // Largest process heap growth in a frame.
+    size_t                  mPeakBytes;         // Largest single frame usage.
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_FRAMEARENA_H
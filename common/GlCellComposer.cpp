@@ -63,10 +63,12 @@ static bool getEGLError(const char* operation, const char* desc = NULL)
     return getGLErrorGen(operation, desc, eglGetError, EGL_SUCCESS);
 }
 
-void GLContextSaver::save()
+void GLContextSaver::save(EGLDisplay display)
 {
     ATRACE_CALL_IF(HWC_TRACE);
 
+    mDisplay = display;
+
     mPrevDisplay = eglGetCurrentDisplay();
     getEGLError("eglGetCurrentDisplay");
 
@@ -86,12 +88,19 @@ void GLContextSaver::restore()
 {
     ATRACE_CALL_IF(HWC_TRACE);
 
-    if (mbSaved && mPrevContext != EGL_NO_CONTEXT)
+    if (!mbSaved)
+        return;
+
+    if (mPrevContext != EGL_NO_CONTEXT)
     {
         eglMakeCurrent(mPrevDisplay, mPrevDrawSurface, mPrevReadSurface, mPrevContext);
-        getEGLError("eglMakeCurrent");
-        mbSaved = false;
     }
+    else
+    {
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    getEGLError("eglMakeCurrent");
+    mbSaved = false;
 }
 
 void GLContextRestorer::operator()(GLContextSaver* pSaver)
@@ -793,7 +802,7 @@ GLContext::SavedContext GLContext::makeCurrent()
          mSurface != EGL_NO_SURFACE &&
          mContext != EGL_NO_CONTEXT)
     {
-        mSavedContext.save();
+        mSavedContext.save(mDisplay);
 
         eglMakeCurrent(mDisplay, mSurface, mSurface, mContext);
         if (getEGLError("eglMakeCurrent"))
@@ -1427,6 +1436,43 @@ status_t GlCellComposer::drawLayerSetInternal(uint32_t numIndices, const uint32_
     return OK;
 }
 
+bool GlCellComposer::drawSolidColor(const Layer& layer, const Region& region)
+{
+    // The clear writes the color as is, which matches a single layer drawn without blending
+    // unless the shader would have modulated it.
+    if (!layer.isSolidColor() || mDestTextureExternal || layer.isPlaneAlpha()
+        || (layer.getBlending() == EBlendMode::COVERAGE) || shouldBlankLayer(layer))
+    {
+        return false;
+    }
+
+    // The color is in RGBA_8888 byte order.
+    uint32_t color = layer.getSolidColor();
+    if (layer.getBlending() == EBlendMode::NONE)
+    {
+        color |= 0xFF000000;
+    }
+    glClearColor(( color        & 0xFF) / 255.0f,
+                 ((color >>  8) & 0xFF) / 255.0f,
+                 ((color >> 16) & 0xFF) / 255.0f,
+                 ((color >> 24) & 0xFF) / 255.0f);
+
+    size_t numRects;
+    const Rect* pRects = region.getArray(&numRects);
+
+    glEnable(GL_SCISSOR_TEST);
+    for (size_t r = 0; r < numRects; ++r)
+    {
+        glScissor(pRects[r].left, pRects[r].top, pRects[r].getWidth(), pRects[r].getHeight());
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    getGLError("glClear");
+
+    ALOGD_IF(COMPOSITION_DEBUG, "GlCellComposer: Cleared %zd rects to %08x", numRects, color);
+    return true;
+}
+
 status_t GlCellComposer::drawLayerSet(uint32_t numIndices, const uint32_t* pIndices, const Region& region)
 {
     ATRACE_CALL_IF(HWC_TRACE);
@@ -1440,6 +1486,12 @@ status_t GlCellComposer::drawLayerSet(uint32_t numIndices, const uint32_t* pIndi
         return UNKNOWN_ERROR;
     }
 
+    // A solid color layer on its own is just a fill.
+    if ((numIndices == 1) && drawSolidColor(mpLayers->getLayer(pIndices[0]), region))
+    {
+        return OK;
+    }
+
     const uint32_t maxTextures = CProgramStore::maxNumLayers;
 
     uint32_t startIndex = 0;
@@ -41,10 +41,14 @@ namespace hwc {
 class GLContextSaver
 {
 public:
-    void save();
+    // Save the calling thread's current context before display's context is made current.
+    void save(EGLDisplay display);
+    // Restore the saved context, or release ours if there was none so that the
+    // context can be made current on another thread next time.
     void restore();
 private:
     bool       mbSaved           = false;
+    EGLDisplay mDisplay          = EGL_NO_DISPLAY;
     EGLDisplay mPrevDisplay      = EGL_NO_DISPLAY;
     EGLSurface mPrevDrawSurface  = EGL_NO_SURFACE;
     EGLSurface mPrevReadSurface  = EGL_NO_SURFACE;
@@ -130,6 +134,10 @@ private:
 
     bool shouldBlankLayer(const Layer& layer);
 
+    // Draw a lone solid color layer (see Layer::isSolidColor) by clearing the region.
+    // Returns false if the layer can not be drawn this way.
+    bool drawSolidColor(const Layer& layer, const Region& region);
+
     /** \brief OpenGL shader
 
     Provides the common operations for OpenGL shaders.
@@ -30,6 +30,17 @@ namespace intel {
 namespace ufo {
 namespace hwc {
 
+// Bytes per pixel of buffers written by the GPU when composing scaled layers.
+static const float cComposedBytesPerPixel = 4.0f;
+// Fixed power of an active scaler expressed as equivalent bandwidth in MB/s.
+static const float cScalerPower = 100.0f;
+// Power of a scaler per megapixel/s of output, as equivalent bandwidth in MB/s.
+static const float cScalerPixelPower = 1.0f;
+// Power of keeping the GPU busy at the display refresh rate, as equivalent bandwidth in MB/s.
+static const float cGpuPower = 1000.0f;
+// The previous strategy is kept unless another is at least this fraction cheaper.
+static const float cStrategyHysteresis = 0.1f;
+
 GlobalScalingFilter::GlobalScalingFilter(PhysicalDisplayManager& pdm) :
     mPhysicalDisplayManager(pdm),
     mOptionGlobalScaling    ("globalscaling", GLOBAL_SCALING_OPTION_ENABLE
@@ -38,7 +49,8 @@ GlobalScalingFilter::GlobalScalingFilter(PhysicalDisplayManager& pdm) :
     mOptionGlobalScalingMin ("globalscalemin", 66),     // 1080p downscale to 720p
     mOptionGlobalScalingMax ("globalscalemax", 150),    // 720p upscale to 1080p
     mOptionGlobalScalingEdge("globalscaleedje", 1),
-    mOptionGlobalScalingVideoOnly("gsvideoonly", 1) // only enabling global scaling HW when we have full height or width single plane video
+    mOptionGlobalScalingVideoOnly("gsvideoonly", 1), // only enabling global scaling HW when we have full height or width single plane video
+    mOptionGlobalScalingCost("globalscalecost", 1)
 {
 }
 
@@ -156,10 +168,61 @@ const Content& GlobalScalingFilter::onApply(const Content& ref)
 String8 GlobalScalingFilter::dump()
 {
     String8 output;
-    // TODO: add more dump info
+    for (uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; d++)
+    {
+        const DisplayInfo& displayInfo = mDisplayInfo[d];
+        if (displayInfo.mReason == eReason_None)
+        {
+            continue;
+        }
+        output.appendFormat("D%u %s(%s)", d, getStrategyName(displayInfo.mStrategy), getReasonName(displayInfo.mReason));
+        if ((displayInfo.mReason == eReason_Cheapest) || (displayInfo.mReason == eReason_Hysteresis))
+        {
+            for (uint32_t s = eStrategy_PanelFitter; s < eStrategy_Count; s++)
+            {
+                const ScalingCost& cost = displayInfo.mCost[s];
+                if (cost.mbFeasible)
+                {
+                    output.appendFormat(" %s:%.0fMB/s,P%.0f", getStrategyName(EScalingStrategy(s)), cost.mBandwidth, cost.mPower);
+                }
+                else
+                {
+                    output.appendFormat(" %s:N/A", getStrategyName(EScalingStrategy(s)));
+                }
+            }
+        }
+        output.append(" ");
+    }
     return output;
 }
 
+const char* GlobalScalingFilter::getStrategyName(EScalingStrategy strategy)
+{
+    switch (strategy)
+    {
+        case eStrategy_PassThrough:     return "PassThrough";
+        case eStrategy_PanelFitter:     return "PanelFitter";
+        case eStrategy_PlaneScaler:     return "PlaneScaler";
+        case eStrategy_Count:           break;
+    }
+    return "?";
+}
+
+const char* GlobalScalingFilter::getReasonName(EScalingReason reason)
+{
+    switch (reason)
+    {
+        case eReason_None:              return "None";
+        case eReason_NoGlobalScaling:   return "NoGlobalScaling";
+        case eReason_Unsupported:       return "Unsupported";
+        case eReason_AcquireFailed:     return "AcquireFailed";
+        case eReason_CostDisabled:      return "CostDisabled";
+        case eReason_Cheapest:          return "Cheapest";
+        case eReason_Hysteresis:        return "Hysteresis";
+    }
+    return "?";
+}
+
 int GlobalScalingFilter::setActualOutputResolution(uint32_t phyIndex, uint32_t outputWidth, uint32_t outputHeight)
 {
 
@@ -495,19 +558,18 @@ bool GlobalScalingFilter::applyAllScalings(DisplayInfo& displayInfo, AbstractPhy
     // dst.y = finalFrameY + dst.y * totalScalingFactorH;
     for (uint32_t i = 0; i < layerCount; i++)
     {
-        // make a copy from content's layerStack
-        displayInfo.mLayers[i] = layerStack.getLayer(i);
-        displayInfo.mLayers[i].onUpdateFrameState(layerStack.getLayer(i));
+        // copy-on-write from content's layerStack
+        Layer& layer = layerStack.editLayer(i, displayInfo.mLayers);
 
         // apply the total scaling to the dst of the layer
-        hwc_rect_t& dst = displayInfo.mLayers[i].editDst();
+        hwc_rect_t& dst = layer.editDst();
         dst.left   = finalFrameX + dst.left   * totalScalingFactorW + 0.5f;
         dst.top    = finalFrameY + dst.top    * totalScalingFactorH + 0.5f;
         dst.right  = finalFrameX + dst.right  * totalScalingFactorW + 0.5f;
         dst.bottom = finalFrameY + dst.bottom * totalScalingFactorH + 0.5f;
 
         // apply the total scaling to the visibleRegions of the layer
-        Vector<hwc_rect_t>& visRegions = displayInfo.mLayers[i].editVisibleRegions();
+        Layer::VisibleRegions& visRegions = layer.editVisibleRegions();
         for (uint32_t r = 0; r < visRegions.size(); r++)
         {
             hwc_rect_t& visRect = visRegions.editItemAt(r);
@@ -527,8 +589,8 @@ bool GlobalScalingFilter::applyAllScalings(DisplayInfo& displayInfo, AbstractPhy
         //   The VPP handles -ve destination co-ordinates correctly, even where a
         //   transform is being applied. However, DRM does not, so it is best to
         //   always clip here.
-        clipLayerToDisplay(&displayInfo.mLayers[i], outputW, outputH);
-        const hwc_frect_t& src = displayInfo.mLayers[i].getSrc();
+        clipLayerToDisplay(&layer, outputW, outputH);
+        const hwc_frect_t& src = layer.getSrc();
         ALOGD_IF( GLOBAL_SCALING_DEBUG,
             "final transform:phyIndex:%d, layer:%d, after clip: src:(%f, %f, %f, %f), dst:(%d, %d, %d, %d).\n",
             phyIndex, i,
@@ -536,9 +598,7 @@ bool GlobalScalingFilter::applyAllScalings(DisplayInfo& displayInfo, AbstractPhy
             dst.left, dst.top, dst.right, dst.bottom);
 
         // update layer flags
-        displayInfo.mLayers[i].onUpdateFlags();
-        // replace with our modified layer
-        layerStack.setLayer(i, &displayInfo.mLayers[i]);
+        layer.onUpdateFlags();
     }
     layerStack.updateLayerFlags();
 
@@ -628,6 +688,8 @@ bool GlobalScalingFilter::enableGlobalScalingHW(DisplayInfo& displayInfo, Abstra
                                    finalFrameX, finalFrameY, finalFrameW, finalFrameH) )
     {
         // no global scaling,do nothing
+        displayInfo.mStrategy = eStrategy_PassThrough;
+        displayInfo.mReason = eReason_NoGlobalScaling;
         return false;
     }
     ALOG_ASSERT( globalScalingFactorX != 0.0f );
@@ -641,13 +703,36 @@ bool GlobalScalingFilter::enableGlobalScalingHW(DisplayInfo& displayInfo, Abstra
                                         globalScalingFactorX, globalScalingFactorY) )
     {
         // not supportted by HW, bail out
+        displayInfo.mStrategy = eStrategy_PassThrough;
+        displayInfo.mReason = eReason_Unsupported;
         return false;
     }
 
+    // The panel fitter is feasible and within the quality bounds.
+    // Only use it if it is also the cheapest way to present this content.
+    if ( mOptionGlobalScalingCost )
+    {
+        estimateScalingCosts( phys.getDisplayCaps(), display, displayInfo.mCost );
+        selectScalingStrategy( displayInfo );
+        if ( displayInfo.mStrategy != eStrategy_PanelFitter )
+        {
+            ALOGD_IF( GLOBAL_SCALING_DEBUG, "D%d panel fitter not used, %s is cheaper.",
+                      phys.getDisplayManagerIndex(), getStrategyName( displayInfo.mStrategy ) );
+            return false;
+        }
+    }
+    else
+    {
+        displayInfo.mStrategy = eStrategy_PanelFitter;
+        displayInfo.mReason = eReason_CostDisabled;
+    }
+
     // acquire Global Scaling HW
     if ( !acquireGlobalScalingHW( phys, display, inputW, inputH, finalFrameX, finalFrameY, finalFrameW, finalFrameH ) )
     {
         ALOGD_IF( GLOBAL_SCALING_DEBUG, "Failed to acquire global scaling HW on display:%d.\n", phys.getDisplayManagerIndex() );
+        displayInfo.mStrategy = eStrategy_PassThrough;
+        displayInfo.mReason = eReason_AcquireFailed;
         return false;
     }
 
@@ -662,6 +747,116 @@ bool GlobalScalingFilter::enableGlobalScalingHW(DisplayInfo& displayInfo, Abstra
     return true;
 }
 
+void GlobalScalingFilter::estimateScalingCosts( const DisplayCaps& caps, const Content::Display& display, ScalingCost cost[eStrategy_Count] )
+{
+    // All costs are per second so that layers updating slower than the display refresh
+    // (e.g. static layers) only pay for GPU composition when their content changes.
+    const Content::LayerStack& layerStack = display.getLayerStack();
+    const float refresh = display.getRefresh() ? display.getRefresh() : INTEL_HWC_DEFAULT_REFRESH_RATE;
+
+    uint32_t scalingPlanes = 0;
+    for ( uint32_t p = 0; p < caps.getNumPlanes(); p++ )
+    {
+        if ( caps.isScalingSupported( p ) )
+        {
+            ++scalingPlanes;
+        }
+    }
+
+    ScalingCost& panelFitter = cost[eStrategy_PanelFitter];
+    ScalingCost& planeScaler = cost[eStrategy_PlaneScaler];
+    panelFitter = ScalingCost();
+    planeScaler = ScalingCost();
+    panelFitter.mbFeasible = true;
+    planeScaler.mbFeasible = ( scalingPlanes > 0 );
+
+    // The panel fitter always outputs the full display, borders included.
+    const float panelFitterPixels = float( display.getWidth() ) * display.getHeight();
+    float planeScalerPixels = 0.0f;     // Pixels output by the plane scalers.
+    uint32_t planeScalers = 0;          // Plane scalers used by the plane scaler strategy.
+    float composedFps = 0.0f;           // Highest update rate of layers that overflow the plane scalers.
+
+    for ( uint32_t ly = 0; ly < layerStack.size(); ly++ )
+    {
+        const Layer& layer = layerStack.getLayer( ly );
+        const float fetch = layer.getSrcWidth() * layer.getSrcHeight() * bitsPerPixelForFormat( layer.getBufferFormat() ) / 8;
+        const float dstPixels = float( layer.getDstWidth() ) * layer.getDstHeight();
+        // A layer without a measured rate (eg it has not updated often enough yet) is assumed
+        // to update every refresh rather than being treated as free to compose.
+        const float fps = layer.getFps() ? min( float( layer.getFps() ), refresh ) : refresh;
+
+        // The panel fitter fetches every source every refresh.
+        panelFitter.mBandwidth += refresh * fetch;
+
+        bool bPlaneScaled = false;
+        if ( planeScalers < scalingPlanes )
+        {
+            for ( uint32_t p = 0; ( p < caps.getNumPlanes() ) && !bPlaneScaled; p++ )
+            {
+                bPlaneScaled = caps.isScalingSupported( p ) && caps.getPlaneCaps( p ).isScaleFactorSupported( layer );
+            }
+        }
+        if ( bPlaneScaled )
+        {
+            planeScaler.mBandwidth += refresh * fetch;
+            planeScalerPixels += dstPixels;
+            ++planeScalers;
+        }
+        else
+        {
+            // Layers the plane scalers can not take are scaled by composition: the GPU reads the
+            // source and writes a scaled copy each time the layer updates, then the display scans
+            // out the scaled copy every refresh.
+            const float scaled = dstPixels * cComposedBytesPerPixel;
+            planeScaler.mBandwidth += fps * ( fetch + scaled ) + refresh * scaled;
+            composedFps = max( composedFps, fps );
+        }
+    }
+
+    const float cBytesToMB = 1.0f / ( 1024 * 1024 );
+    const float cPixelsToMPixels = 1.0f / ( 1000 * 1000 );
+    panelFitter.mBandwidth *= cBytesToMB;
+    planeScaler.mBandwidth *= cBytesToMB;
+
+    panelFitter.mPower = panelFitter.mBandwidth
+                       + cScalerPower + cScalerPixelPower * refresh * panelFitterPixels * cPixelsToMPixels;
+    planeScaler.mPower = planeScaler.mBandwidth
+                       + planeScalers * cScalerPower + cScalerPixelPower * refresh * planeScalerPixels * cPixelsToMPixels
+                       + cGpuPower * composedFps / refresh;
+
+    ALOGD_IF( GLOBAL_SCALING_DEBUG, "Scaling costs PF %.0fMB/s P%.0f, PS %d %.0fMB/s P%.0f (%u scalers)",
+              panelFitter.mBandwidth, panelFitter.mPower,
+              planeScaler.mbFeasible, planeScaler.mBandwidth, planeScaler.mPower, planeScalers );
+}
+
+void GlobalScalingFilter::selectScalingStrategy( DisplayInfo& displayInfo )
+{
+    // Cheapest feasible strategy, earlier strategies win ties.
+    uint32_t best = eStrategy_Count;
+    for ( uint32_t s = eStrategy_PanelFitter; s < eStrategy_Count; s++ )
+    {
+        if ( displayInfo.mCost[s].mbFeasible
+          && ( ( best == eStrategy_Count ) || ( displayInfo.mCost[s].mPower < displayInfo.mCost[best].mPower ) ) )
+        {
+            best = s;
+        }
+    }
+    ALOG_ASSERT( best != eStrategy_Count );
+
+    // Avoid flipping (and the geometry changes that go with it) when costs are close.
+    const EScalingStrategy previous = displayInfo.mStrategy;
+    if ( ( previous != eStrategy_PassThrough ) && ( previous != best )
+      && displayInfo.mCost[previous].mbFeasible
+      && ( displayInfo.mCost[previous].mPower <= displayInfo.mCost[best].mPower * ( 1.0f + cStrategyHysteresis ) ) )
+    {
+        displayInfo.mReason = eReason_Hysteresis;
+        return;
+    }
+
+    displayInfo.mStrategy = EScalingStrategy( best );
+    displayInfo.mReason = eReason_Cheapest;
+}
+
 bool GlobalScalingFilter::nearAspectPreserving( float globalScalingFactorX, float globalScalingFactorY )
 {
     // Tolerance to match AR as absolute percentage difference.
@@ -1154,20 +1349,19 @@ void GlobalScalingFilter::transformContentsToVirtualResolution(DisplayInfo& disp
     // dst.y = dst.y / ScalingFactorY;
     for ( uint32_t i = 0; i < layerCount; i++ )
     {
-        // make a copy from content's layerStack
-        displayInfo.mLayers[i] = layerStack.getLayer(i);
-        displayInfo.mLayers[i].onUpdateFrameState(layerStack.getLayer(i));
+        // copy-on-write from content's layerStack
+        Layer& layer = layerStack.editLayer(i, displayInfo.mLayers);
 
         // transform layer's dst to the source space (virtual resolution)
-        hwc_rect_t& dst = displayInfo.mLayers[i].editDst();
-        const hwc_frect_t& src = displayInfo.mLayers[i].getSrc();
+        hwc_rect_t& dst = layer.editDst();
+        const hwc_frect_t& src = layer.getSrc();
         dst.left   = dst.left   / scalingFactorX + 0.5f;
         dst.top    = dst.top    / scalingFactorY + 0.5f;
         dst.right  = dst.right  / scalingFactorX + 0.5f;
         dst.bottom = dst.bottom / scalingFactorY + 0.5f;
 
         // transform layer's visibleRegions to the source space (virtual resolution)
-        Vector<hwc_rect_t>& visRegions = displayInfo.mLayers[i].editVisibleRegions();
+        Layer::VisibleRegions& visRegions = layer.editVisibleRegions();
         for (uint32_t r = 0; r < visRegions.size(); r++)
         {
             hwc_rect_t& visRect = visRegions.editItemAt(r);
@@ -1184,9 +1378,7 @@ void GlobalScalingFilter::transformContentsToVirtualResolution(DisplayInfo& disp
             dst.left, dst.top, dst.right, dst.bottom );
 
         // update layer flags
-        displayInfo.mLayers[i].onUpdateFlags();
-        // replace with our modified layer
-        layerStack.setLayer( i, &displayInfo.mLayers[i] );
+        layer.onUpdateFlags();
     }
     layerStack.updateLayerFlags();
 
@@ -66,13 +66,51 @@ public:
     bool getUserScalingMode(uint32_t phyIndex, EHwcsScalingMode& scalingMode);
 
 private:
+    // Ways that a globally scaled frame can be presented.
+    // The filter only owns the panel fitter. Plane scaling is what the plane allocation does
+    // with the frame when it is passed through: each layer takes a plane scaler where one
+    // supports its scale factor and the rest are scaled by composition.
+    // There is no separate GPU pre-scale strategy: the filter has no way to make the plane
+    // allocation compose the whole frame, so it could only be costed, never carried out.
+    // Pre-scaling a static layer is what the composed part of the plane scaler strategy
+    // already costs, paying for the GPU only at the rate the layer updates.
+    enum EScalingStrategy
+    {
+        eStrategy_PassThrough = 0,  // No global scaling (or panel fitter unusable).
+        eStrategy_PanelFitter,      // Pipe scaler (panel fitter) scales the whole frame.
+        eStrategy_PlaneScaler,      // Frame passed through to plane scalers and composition.
+        eStrategy_Count
+    };
+
+    // Why the last strategy was picked.
+    enum EScalingReason
+    {
+        eReason_None = 0,           // Not evaluated yet.
+        eReason_NoGlobalScaling,    // Content has no common scaling factor.
+        eReason_Unsupported,        // Panel fitter rejected by options, quality bounds or display caps.
+        eReason_AcquireFailed,      // Panel fitter could not be acquired.
+        eReason_CostDisabled,       // Cost model disabled, panel fitter used whenever supported.
+        eReason_Cheapest,           // Lowest estimated cost.
+        eReason_Hysteresis          // Kept previous strategy as it was within the hysteresis margin.
+    };
+
+    // Estimated cost of presenting the frame with one strategy.
+    struct ScalingCost
+    {
+        ScalingCost() : mbFeasible(false), mBandwidth(0.0f), mPower(0.0f) { }
+        bool            mbFeasible;                         // Strategy can be used on this display.
+        float           mBandwidth;                         // Memory bandwidth in MB/s.
+        float           mPower;                             // Relative power, bandwidth plus fixed engine costs in MB/s equivalents.
+    };
+
     // Helper struct to contain per display settings
     struct DisplayInfo
     {
         DisplayInfo() : mbSetActualOutputResolution(false), mActualOutputWidth(0), mActualOutputHeight(0),
             mbHaveUserOverscan(false), mUserOverscanX(0), mUserOverscanY(0),
             mbHaveUserScalingMode(false), mUserScalingMode(HWCS_SCALE_FIT),
-            mbSettingsChanged(false), mbGlobalScalingHwEnabled(false) { }
+            mbSettingsChanged(false), mStrategy(eStrategy_PassThrough), mReason(eReason_None),
+            mbGlobalScalingHwEnabled(false) { }
 
         bool            mbSetActualOutputResolution;        // Set actual output resolution this display?
         uint32_t        mActualOutputWidth;                 // actual output size of the display, for proxy display
@@ -84,6 +122,9 @@ private:
         EHwcsScalingMode    mUserScalingMode; // User-specified scaling mode.
         bool            mbSettingsChanged;                  // true when one of the settings changed
         std::vector<Layer>  mLayers;                        // layer list for this display
+        EScalingStrategy    mStrategy;                      // Strategy picked last frame
+        EScalingReason      mReason;                        // Rationale for mStrategy
+        ScalingCost         mCost[eStrategy_Count];         // Estimated costs, valid for eReason_Cheapest/Hysteresis
         bool            mbGlobalScalingEnabled:1;           // GlobalScaling is enabled for this display
         bool            mbGlobalScalingHwEnabled:1;         // GlobalScalingHW is enabled for this display
     };
@@ -100,6 +141,12 @@ private:
 
     // enable HW to achieve the global scaling
     bool enableGlobalScalingHW(DisplayInfo& displayInfo, AbstractPhysicalDisplay& phys, Content::Display& display);
+    // estimate the cost of each strategy for presenting the display content.
+    void estimateScalingCosts(const DisplayCaps& caps, const Content::Display& display, ScalingCost cost[eStrategy_Count]);
+    // pick the cheapest feasible strategy, favouring the previous strategy within a margin.
+    void selectScalingStrategy(DisplayInfo& displayInfo);
+    static const char* getStrategyName(EScalingStrategy strategy);
+    static const char* getReasonName(EScalingReason reason);
     // check if scaling in X/Y is near aspect preserving.
     bool nearAspectPreserving( float globalScalingFactorX, float globalScalingFactorY );
     // check if there is global scaling and return the scaling factors, input size and final frame if there is
@@ -141,6 +188,7 @@ private:
     Option mOptionGlobalScalingMax;    //< Global scaling up-scale limit as a percentage (or zero if no limit).
     Option mOptionGlobalScalingEdge;   //< Global scaling clamp layer horizontally or vertically to display edges.
     Option mOptionGlobalScalingVideoOnly;   //< only enabling global scaling HW when we have full height or width single plane video
+    Option mOptionGlobalScalingCost;   //< Only use the panel fitter when it is the cheapest strategy.
 };
 
 }; // namespace hwc
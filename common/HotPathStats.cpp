@@ -0,0 +1,143 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "HotPathStats.h"
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+std::atomic<bool> HotPathStats::sbEnabled(false);
+
+HotPathStats::HotPathStats() :
+    mOptionEnable("hotpathstats", 0, false)
+{
+    reset();
+    sbEnabled = (mOptionEnable != 0);
+}
+
+void HotPathStats::reset()
+{
+    for (uint32_t p = 0; p < PATH_COUNT; ++p)
+    {
+        PathStats& stats = maPaths[p];
+        stats.mCount = 0;
+        stats.mTotalNs = 0;
+        stats.mMaxNs = 0;
+        for (uint32_t b = 0; b < cBuckets; ++b)
+        {
+            stats.maBuckets[b] = 0;
+        }
+    }
+}
+
+void HotPathStats::add(EPath path, nsecs_t duration)
+{
+    ALOG_ASSERT(path < PATH_COUNT);
+    PathStats& stats = maPaths[path];
+    const uint64_t ns = (duration > 0) ? uint64_t(duration) : 0;
+
+    stats.mCount.fetch_add(1, std::memory_order_relaxed);
+    stats.mTotalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t max = stats.mMaxNs.load(std::memory_order_relaxed);
+    while ((ns > max) && !stats.mMaxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+
+    uint32_t bucket = 0;
+    while ((bucket < cBuckets - 1) && (ns >> (bucket + 1)))
+    {
+        ++bucket;
+    }
+    stats.maBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HotPathStats::onEndOfFrame()
+{
+    const bool bEnable = (mOptionEnable != 0);
+    if (bEnable != isEnabled())
+    {
+        // Start a fresh set of statistics each time they are enabled.
+        if (bEnable)
+        {
+            reset();
+        }
+        sbEnabled = bEnable;
+    }
+}
+
+uint64_t HotPathStats::estimatePercentile(const PathStats& stats, uint64_t count, uint32_t pct)
+{
+    const uint64_t target = (count * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < cBuckets; ++b)
+    {
+        seen += stats.maBuckets[b].load(std::memory_order_relaxed);
+        if (seen >= target)
+        {
+            // Report the upper bound of the bucket.
+            return (2ull << b) - 1;
+        }
+    }
+    return stats.mMaxNs.load(std::memory_order_relaxed);
+}
+
+const char* HotPathStats::getPathName(EPath path)
+{
+    switch (path)
+    {
+        case PLANE_ALLOCATION:      return "PlaneAllocation";
+        case PARTITIONING:          return "Partitioning";
+        case COMPOSITION_REQUEST:   return "CompositionRequest";
+        case COMPOSITION_LOOKUP:    return "CompositionLookup";
+        case BUFFER_DEQUEUE:        return "BufferDequeue";
+        case FENCE_MERGE:           return "FenceMerge";
+        case LOG_WRITE:             return "LogWrite";
+        case PATH_COUNT:            break;
+    }
+    return "Unknown";
+}
+
+String8 HotPathStats::dump()
+{
+    if (!isEnabled())
+    {
+        return String8();
+    }
+
+    String8 output("Hot paths (ns/op):\n");
+    for (uint32_t p = 0; p < PATH_COUNT; ++p)
+    {
+        const PathStats& stats = maPaths[p];
+        const uint64_t count = stats.mCount.load(std::memory_order_relaxed);
+        if (count == 0)
+        {
+            continue;
+        }
+        output.appendFormat("  %-20s ops:%" PRIu64 " avg:%" PRIu64 " p50:<%" PRIu64 " p99:<%" PRIu64 " max:%" PRIu64 "\n",
+                            getPathName(EPath(p)), count,
+                            stats.mTotalNs.load(std::memory_order_relaxed) / count,
+                            estimatePercentile(stats, count, 50),
+                            estimatePercentile(stats, count, 99),
+                            stats.mMaxNs.load(std::memory_order_relaxed));
+    }
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
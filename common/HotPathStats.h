@@ -0,0 +1,113 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_HOTPATHSTATS_H
+#define INTEL_UFO_HWC_HOTPATHSTATS_H
+
+#include "Common.h"
+#include "Option.h"
+#include "Singleton.h"
+#include <atomic>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class accumulates timing statistics for the composition hot paths so that performance
+// changes can be measured on a running system. It is enabled with the hotpathstats option and
+// reported through dumpsys. When disabled, each timed scope costs a single flag test.
+// Paths may be timed from any thread.
+// The timings come from whatever the running system is presenting, so they are not comparable
+// between runs the way a benchmark with controlled inputs would be, and they do not count
+// allocations.
+class HotPathStats : public Singleton<HotPathStats>
+{
+public:
+    enum EPath
+    {
+        PLANE_ALLOCATION = 0,       // PlaneAllocator::findOptimalSolution
+        PARTITIONING,               // PartitionedComposer partition generation
+        COMPOSITION_REQUEST,        // CompositionManager::requestComposition
+        COMPOSITION_LOOKUP,         // CompositionManager::lock/unlockComposition (HwcList walk)
+        BUFFER_DEQUEUE,             // BufferQueue::dequeue
+        FENCE_MERGE,                // Timeline::mergeFence
+        LOG_WRITE,                  // BasicLog entry reserve through commit
+        PATH_COUNT
+    };
+
+    static HotPathStats& get() { return getInstance(); }
+
+    // This is static so that it can be tested without constructing the instance (the Log uses it).
+    static bool isEnabled() { return sbEnabled.load(std::memory_order_relaxed); }
+
+    // Add one timed operation on path.
+    void add(EPath path, nsecs_t duration);
+
+    // Pick up any change to the option. Called once per frame.
+    void onEndOfFrame();
+
+    String8 dump();
+
+    // Times the enclosing scope if the stats are enabled.
+    class Scope
+    {
+    public:
+        Scope(EPath path) : mPath(path), mStart(isEnabled() ? systemTime(SYSTEM_TIME_MONOTONIC) : 0) {}
+        ~Scope()
+        {
+            if (mStart)
+                HotPathStats::get().add(mPath, systemTime(SYSTEM_TIME_MONOTONIC) - mStart);
+        }
+    private:
+        EPath   mPath;
+        nsecs_t mStart;
+    };
+
+private:
+    friend class Singleton<HotPathStats>;
+
+    HotPathStats();
+
+    void reset();
+
+    static const char* getPathName(EPath path);
+
+    // Durations are histogrammed in power of two nanosecond buckets.
+    static const uint32_t cBuckets = 32;
+
+    struct PathStats
+    {
+        std::atomic<uint64_t>   mCount;
+        std::atomic<uint64_t>   mTotalNs;
+        std::atomic<uint64_t>   mMaxNs;
+        std::atomic<uint32_t>   maBuckets[cBuckets];
+    };
+
+    // Estimate the duration below which pct percent of operations completed.
+    static uint64_t estimatePercentile(const PathStats& stats, uint64_t count, uint32_t pct);
+
+    Option                  mOptionEnable;
+    static std::atomic<bool> sbEnabled;
+    PathStats               maPaths[PATH_COUNT];
+};
+
+#define HOTPATH_SCOPE(path)     HotPathStats::Scope ___hotpath(HotPathStats::path)
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_HOTPATHSTATS_H
@@ -22,6 +22,10 @@
 #include "VirtualDisplay.h"
 #include "AbstractPlatform.h"
 #include "AbstractBufferManager.h"
+#include "FrameArena.h"
+#include "HotPathStats.h"
+#include "FenceLatencyTracker.h"
+#include "ThreadManager.h"
 #include "OptionManager.h"
 
 namespace intel {
@@ -94,6 +98,9 @@ Hwc::Hwc(const hw_module_t* module) :
     // Make sure the option manager is initialised (for forceGeometryChange updates)
     OptionManager::getInstance().initialize(*this);
 
+    // Apply the thread policy to any threads already started, and to all started from here on.
+    ThreadManager::get().initialize();
+
 #if INTEL_HWC_LOGVIEWER_BUILD
     // Enable logview to logcat.
     Option optionLogviewer( "logviewer", 0, false );
@@ -353,6 +360,9 @@ status_t Hwc::onSet(
         dumpDisplaysContents( "onSet Entry", numDisplays, displays, hwcFrameIndex );
     }
 
+    // Sample the acquire fences before anything consumes them.
+    FenceLatencyTracker::get().onSet(mInputAnalyzer.getContent(), numDisplays, displays);
+
     // Trigger the composition manager to initiate any compositions that it may need for this frame
     mCompositionManager.onSetBegin(numDisplays, displays);
 
@@ -389,6 +399,10 @@ status_t Hwc::onSet(
     // Frame is complete.
     onEndOfFrame();
 
+    // Release all per-frame scratch memory.
+    FrameArena::get().reset();
+    HotPathStats::get().onEndOfFrame();
+
     // NOTE:
     // Logs for the final display state must be written just prior to onSet exit.
     Log::add(displays, numDisplays, hwcFrameIndex, "onSet Exit");
@@ -1116,11 +1130,16 @@ void Hwc::onDump(char *pBuffer, uint32_t* pBufferLength)
             DUMPSYS_WANT_INPUTANALYZER                   = (1<<1),
             DUMPSYS_WANT_FILTERMANAGER                   = (1<<2),
             DUMPSYS_WANT_DISPLAYMANAGER                  = (1<<3),
-            DUMPSYS_WANT_COMPOSITIONMANAGER              = (1<<4)
+            DUMPSYS_WANT_COMPOSITIONMANAGER              = (1<<4),
+            DUMPSYS_WANT_FRAMEARENA                      = (1<<5),
+            DUMPSYS_WANT_HOTPATHSTATS                    = (1<<6),
+            DUMPSYS_WANT_LOCKS                           = (1<<7),
+            DUMPSYS_WANT_FENCELATENCY                    = (1<<8),
+            DUMPSYS_WANT_THREADS                         = (1<<9)
         };
 
         // Note, this option is queried on every dumpsys, so must be set via a setprop
-        Option dumpSys("dumpsys", DUMPSYS_WANT_INPUTANALYZER | DUMPSYS_WANT_FILTERMANAGER | DUMPSYS_WANT_DISPLAYMANAGER);
+        Option dumpSys("dumpsys", DUMPSYS_WANT_INPUTANALYZER | DUMPSYS_WANT_FILTERMANAGER | DUMPSYS_WANT_DISPLAYMANAGER | DUMPSYS_WANT_FRAMEARENA | DUMPSYS_WANT_HOTPATHSTATS | DUMPSYS_WANT_LOCKS | DUMPSYS_WANT_FENCELATENCY | DUMPSYS_WANT_THREADS);
 
         String8 tmp;
         const bool bWantLog = Log::wantLog();
@@ -1212,6 +1231,75 @@ void Hwc::onDump(char *pBuffer, uint32_t* pBufferLength)
             }
         }
 
+        bWantDumpSys = ( dumpSys & DUMPSYS_WANT_FRAMEARENA );
+        if ( bWantLog || bWantDumpSys )
+        {
+            tmp = String8( "MEMORY:\n" ) + FrameArena::get().dump();
+            Log::alogd( false, tmp.string() );
+            if ( bWantDumpSys )
+            {
+                mPendingDump += tmp + "\n";
+            }
+        }
+
+        bWantDumpSys = ( dumpSys & DUMPSYS_WANT_HOTPATHSTATS );
+        if ( bWantLog || bWantDumpSys )
+        {
+            tmp = HotPathStats::get().dump();
+            if ( tmp.length() > 0 )
+            {
+                tmp = String8( "PROFILE:\n" ) + tmp;
+                Log::alogd( false, tmp.string() );
+                if ( bWantDumpSys )
+                {
+                    mPendingDump += tmp + "\n";
+                }
+            }
+        }
+
+        bWantDumpSys = ( dumpSys & DUMPSYS_WANT_FENCELATENCY );
+        if ( bWantLog || bWantDumpSys )
+        {
+            tmp = FenceLatencyTracker::get().dump();
+            if ( tmp.length() > 0 )
+            {
+                tmp = String8( "FENCES:\n" ) + tmp;
+                Log::alogd( false, tmp.string() );
+                if ( bWantDumpSys )
+                {
+                    mPendingDump += tmp + "\n";
+                }
+            }
+        }
+
+        bWantDumpSys = ( dumpSys & DUMPSYS_WANT_THREADS );
+        if ( bWantLog || bWantDumpSys )
+        {
+            tmp = ThreadManager::get().dump();
+            if ( tmp.length() > 0 )
+            {
+                tmp = String8( "THREADS:\n" ) + tmp;
+                Log::alogd( false, tmp.string() );
+                if ( bWantDumpSys )
+                {
+                    mPendingDump += tmp + "\n";
+                }
+            }
+        }
+
+#if VPG_HAVE_HWC_MUTEX
+        bWantDumpSys = ( dumpSys & DUMPSYS_WANT_LOCKS );
+        if ( bWantLog || bWantDumpSys )
+        {
+            tmp = String8( "LOCKS:\n" ) + Mutex::dumpContention();
+            Log::alogd( false, tmp.string() );
+            if ( bWantDumpSys )
+            {
+                mPendingDump += tmp + "\n";
+            }
+        }
+#endif
+
         if ( bWantLog )
         {
             Log::alogd( false, "-----END-----------------------------------------------------------------------------------" );
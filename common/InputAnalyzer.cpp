@@ -20,6 +20,9 @@
 #include "InputAnalyzer.h"
 #include "Log.h"
 #include "DisplayCaps.h"
+#include "FrameArena.h"
+#include "FenceLatencyTracker.h"
+#include "VideoModeDetectionFilter.h"
 
 namespace intel {
 namespace ufo {
@@ -27,7 +30,9 @@ namespace hwc {
 
 InputAnalyzer::Display::Display() :
     mpSrcDisplayContents(NULL),
-    mbForceGeometry(false)
+    mbForceGeometry(false),
+    mRebuiltLayers(0),
+    mSkippedLayers(0)
 {
 }
 
@@ -35,7 +40,55 @@ InputAnalyzer::Display::~Display()
 {
 }
 
-void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContents, Content::Display& ref,
+uint32_t InputAnalyzer::Display::LayerShadow::getChanges(const hwc_layer_1_t& layer) const
+{
+    if (!mbValid)
+    {
+        return Content::CHANGE_LAYER_ADDED;
+    }
+    uint32_t changes = 0;
+    if (mHandle != layer.handle)
+    {
+        changes |= Content::CHANGE_LAYER_BUFFER;
+    }
+    if (mHints != layer.hints ||
+        mFlags != layer.flags ||
+        mBlending != layer.blending ||
+        mTransform != layer.transform ||
+        mPlaneAlpha != layer.planeAlpha)
+    {
+        changes |= Content::CHANGE_LAYER_STATE;
+    }
+    if (memcmp(&mSourceCrop, &layer.sourceCropf, sizeof(mSourceCrop)) ||
+        memcmp(&mDisplayFrame, &layer.displayFrame, sizeof(mDisplayFrame)) ||
+        mVisibleRegions.size() != layer.visibleRegionScreen.numRects ||
+        (!mVisibleRegions.isEmpty() &&
+         memcmp(mVisibleRegions.array(), layer.visibleRegionScreen.rects, mVisibleRegions.size() * sizeof(hwc_rect_t))))
+    {
+        changes |= Content::CHANGE_LAYER_RECTS;
+    }
+    return changes;
+}
+
+void InputAnalyzer::Display::LayerShadow::set(const hwc_layer_1_t& layer)
+{
+    mHandle = layer.handle;
+    mHints = layer.hints;
+    mFlags = layer.flags;
+    mBlending = layer.blending;
+    mTransform = layer.transform;
+    mPlaneAlpha = layer.planeAlpha;
+    mSourceCrop = layer.sourceCropf;
+    mDisplayFrame = layer.displayFrame;
+    mVisibleRegions.clear();
+    if (layer.visibleRegionScreen.numRects > 0)
+    {
+        mVisibleRegions.insertArrayAt(layer.visibleRegionScreen.rects, 0, layer.visibleRegionScreen.numRects);
+    }
+    mbValid = true;
+}
+
+void InputAnalyzer::Display::onPrepare(uint32_t d, hwc_display_contents_1_t* pDisplayContents, Content::Display& ref,
                                        uint32_t hwcFrameIndex, nsecs_t now, LogicalDisplay* pHwDisplay)
 {
     const uint32_t dmIndex = pHwDisplay ? pHwDisplay->getDisplayManagerIndex() : (uint32_t)INVALID_DISPLAY_ID;
@@ -57,17 +110,28 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         {
             // This is an indication to disable the display.
             mLayers.clear();
+            mShadows.clear();
             mpSrcDisplayContents = NULL;
             ref.disable();
             ref.setGeometryChanged(true);
+            ref.editLayerStack().setChanges(Content::CHANGE_LAYERS_REMOVED | Content::CHANGE_DISPLAY_MODE);
+            ref.setGeneration(Content::allocateGeneration());
         }
         return;
     }
 
+    // Any change of content must advance the generation.
+    // Fence return locations live in the display contents so a reallocation is also a change.
+    bool bContentChanged = ( pDisplayContents != mpSrcDisplayContents );
+
+    // Changes to the stack itself (see Content::EChange), the layer changes are set on each layer.
+    uint32_t stackChanges = 0;
+
     if ( ref.getDisplayManagerIndex() != dmIndex )
     {
         ALOGD_IF( CONTENT_DEBUG, "InputAnalyzer::Display::onPrepare dmIndex change %u->%u", ref.getDisplayManagerIndex(), dmIndex );
         pDisplayContents->flags |= HWC_GEOMETRY_CHANGED;
+        stackChanges |= Content::CHANGE_DISPLAY_MODE;
         ref.setDisplayManagerIndex( dmIndex );
     }
 
@@ -98,6 +162,7 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         {
             ALOGD_IF( CONTENT_DEBUG, "InputAnalyzer::Display::onPrepare refresh change %u->%u", ref.getRefresh(), refresh );
             pDisplayContents->flags |= HWC_GEOMETRY_CHANGED;
+            stackChanges |= Content::CHANGE_DISPLAY_MODE;
             ref.setRefresh( refresh );
         }
         const EDisplayType displayType = pHwDisplay->getDisplayType();
@@ -105,6 +170,7 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         {
             ALOGD_IF( CONTENT_DEBUG, "InputAnalyzer::Display::onPrepare display type change %d->%d", ref.getDisplayType(), displayType );
             pDisplayContents->flags |= HWC_GEOMETRY_CHANGED;
+            stackChanges |= Content::CHANGE_DISPLAY_MODE;
             ref.setDisplayType( displayType );
         }
         displayFormat = pHwDisplay->getDefaultOutputFormat();
@@ -122,6 +188,10 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         ALOGD_IF(CONTENT_DEBUG, "InputAnalyzer::Display::onPrepare Geometry Changed Display type: %d", ref.getDisplayType());
 
         // Reset force flag and indicate that a geometry change is in progress
+        if (!ref.isEnabled())
+        {
+            stackChanges |= Content::CHANGE_DISPLAY_MODE;
+        }
         ref.setEnabled(true);
         ref.setGeometryChanged(true);
 
@@ -144,12 +214,82 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
             layerstack.resize(mLayers.size());
         }
 
+        // Compare against the shadows of the previous frame.
+        // New entries are default constructed (invalid) so those layers are always rebuilt.
+        mPrevShadows.swap(mShadows);
+        mShadows.resize(mLayers.size());
+        const uint32_t prevLayers = mPrevShadows.size();
+
+        // Previous layers that are still present, to find the layers that were removed.
+        uint8_t* pbPrevPresent = prevLayers ? FrameArena::get().allocateArray<uint8_t>(prevLayers) : NULL;
+        if (prevLayers && !pbPrevPresent)
+        {
+            // Without the tracking we can only assume that the stack changed.
+            stackChanges |= Content::CHANGE_UNSPECIFIED;
+        }
+
+        // SurfaceFlinger raises geometry changes for the whole stack even if only a few
+        // layers changed. Only rebuild the layers whose source state differs from what
+        // they were built from; the rest just need the per-frame update.
         for ( uint32_t ly = 0; ly < mLayers.size(); ly++ )
         {
             bool bForceOpaque = (ly == 0);
             Layer& layer = mLayers[ly];
+            hwc_layer_1_t& hwcLayer = pDisplayContents->hwLayers[ly];
             layerstack.setLayer(ly, &layer);
-            layer.onUpdateAll(pDisplayContents->hwLayers[ly], now, bForceOpaque);
+
+            uint32_t prev = ly;
+            uint32_t changes = ( ly < prevLayers ) ? mPrevShadows[ly].getChanges( hwcLayer ) : Content::CHANGE_LAYER_ADDED;
+            if ( ( changes & ( Content::CHANGE_LAYER_ADDED | Content::CHANGE_LAYER_BUFFER ) ) && hwcLayer.handle )
+            {
+                // Look for the buffer elsewhere in the previous stack in case the layer has moved.
+                for ( uint32_t p = 0; p < prevLayers; p++ )
+                {
+                    if ( ( p != ly ) && ( mPrevShadows[p].getHandle() == hwcLayer.handle )
+                      && !( pbPrevPresent && pbPrevPresent[p] ) )
+                    {
+                        changes = Content::CHANGE_LAYER_MOVED | mPrevShadows[p].getChanges( hwcLayer );
+                        prev = p;
+                        break;
+                    }
+                }
+            }
+            if ( pbPrevPresent && ( prev < prevLayers ) && !( changes & Content::CHANGE_LAYER_ADDED ) )
+            {
+                pbPrevPresent[prev] = true;
+            }
+
+            if ( changes == 0 )
+            {
+                layer.onUpdateFrameState(hwcLayer, now);
+                // The handle is unchanged but its buffer details (format, compression,
+                // media details) may not be, so look them up again as a rebuild would.
+                // The flags update re-derives the dataspace from them.
+                layer.onUpdateBufferState();
+                layer.onUpdateFlags();
+                mShadows[ly] = mPrevShadows[ly];
+                ++mSkippedLayers;
+            }
+            else
+            {
+                layer.onUpdateAll(hwcLayer, now, bForceOpaque);
+                mShadows[ly].set( hwcLayer );
+                ++mRebuiltLayers;
+            }
+            layer.setChanges(changes);
+
+            // A new or moved layer starts with no history for its producer.
+            layer.setLateProducer( !( changes & ( Content::CHANGE_LAYER_ADDED | Content::CHANGE_LAYER_MOVED ) )
+                                && FenceLatencyTracker::get().isLateProducer( d, ly ) );
+        }
+
+        for ( uint32_t p = 0; pbPrevPresent && ( p < prevLayers ); p++ )
+        {
+            if ( !pbPrevPresent[p] )
+            {
+                stackChanges |= Content::CHANGE_LAYERS_REMOVED;
+                break;
+            }
         }
 
         // use outbuf for virtual display only
@@ -182,12 +322,21 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         // Clear the geometry change flag
         ref.setGeometryChanged(false);
 
+        mpSrcDisplayContents = pDisplayContents;
+
         // Check the src layers to see if any handles have changed.
         for ( uint32_t layer = 0; layer < mLayers.size(); layer++ )
         {
             // Trap changes in dynamic state for which we want to re-analyze composition results.
             // We have to propagate a geometry change downstream for these states.
             bool bForceGeometryChange = false;
+            uint32_t changes = 0;
+
+            if ( mLayers[layer].getHandle() != pDisplayContents->hwLayers[layer].handle )
+            {
+                bContentChanged = true;
+                changes |= Content::CHANGE_LAYER_BUFFER;
+            }
 
             // Current state.
             const bool bOldEncrypted = mLayers[layer].isEncrypted();
@@ -196,6 +345,11 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
 
             // Update frame state.
             mLayers[layer].onUpdateFrameState(pDisplayContents->hwLayers[layer], now);
+            if ( layer < mShadows.size() )
+            {
+                // The buffer state has been refreshed for the new handle.
+                mShadows[layer].setHandle( pDisplayContents->hwLayers[layer].handle );
+            }
 
             // Encryption status change.
             const bool bNewEncrypted = mLayers[layer].isEncrypted();
@@ -224,6 +378,17 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
                 bForceGeometryChange = true;
             }
 
+            // Late producer change.
+            // The plane allocator should keep late layers out of the composition.
+            const bool bLateProducer = FenceLatencyTracker::get().isLateProducer( d, layer );
+            if ( mLayers[layer].isLateProducer() != bLateProducer )
+            {
+                ALOGD_IF( sbInternalBuild, "Layer late producer change %d->%d, forcing geometry change",
+                    mLayers[layer].isLateProducer(), bLateProducer );
+                mLayers[layer].setLateProducer( bLateProducer );
+                bForceGeometryChange = true;
+            }
+
             if ( bForceGeometryChange )
             {
                 // Reflect layer state changes into layer flags.
@@ -231,12 +396,19 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
 
                 // And set geometry change.
                 ref.setGeometryChanged(true);
+                changes |= Content::CHANGE_LAYER_STATE;
             }
+            mLayers[layer].setChanges(changes);
         }
 
         // use outbuf for virtual display only
         if (pDisplayContents->outbuf && (ref.getDisplayType() == eDTVirtual) )
         {
+            if ( mOutputLayer.getHandle() != pDisplayContents->outbuf )
+            {
+                bContentChanged = true;
+            }
+
             // Make sure our output layer is refreshed with current state
             mOutputLayer.onUpdateFrameState(pDisplayContents->outbuf);
             mOutputLayer.setAcquireFenceReturn(&pDisplayContents->outbufAcquireFenceFd);
@@ -246,6 +418,21 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
         }
     }
 
+    // Publish the video cadence detected up to the last frame.
+    // A change re-evaluates composition so the video can be given a plane of its own.
+    uint32_t videoFps, videoPulldownMin, videoPulldownMax;
+    VideoModeDetectionFilter::getCadence( d, videoFps, videoPulldownMin, videoPulldownMax );
+    if ( ( ref.getVideoCadenceFps() != videoFps )
+      || ( ref.getVideoPulldownMin() != videoPulldownMin )
+      || ( ref.getVideoPulldownMax() != videoPulldownMax ) )
+    {
+        ALOGD_IF( CONTENT_DEBUG, "Content::Display video cadence changed from %u to %u, forcing geometry change",
+                                 ref.getVideoCadenceFps(), videoFps );
+        ref.setVideoCadence( videoFps, videoPulldownMin, videoPulldownMax );
+        ref.setGeometryChanged(true);
+        stackChanges |= Content::CHANGE_DISPLAY_MODE;
+    }
+
     if (ref.getFormat() != displayFormat)
     {
         // Make sure a geometry change is issued if the display format changes
@@ -254,15 +441,31 @@ void InputAnalyzer::Display::onPrepare(hwc_display_contents_1_t* pDisplayContent
 
         ref.setGeometryChanged(true);
         ref.setFormat(displayFormat);;
+        stackChanges |= Content::CHANGE_DISPLAY_MODE;
     }
 
     // The RenderTarget is useful at this point as it defines the output resolution of the display
     // However, we have no valid render target buffer handle yet.
     const hwc_layer_1_t& rt = pDisplayContents->hwLayers[mLayers.size()];
-    ref.setWidth(rt.displayFrame.right - rt.displayFrame.left);
-    ref.setHeight(rt.displayFrame.bottom - rt.displayFrame.top);
+    const uint32_t width = rt.displayFrame.right - rt.displayFrame.left;
+    const uint32_t height = rt.displayFrame.bottom - rt.displayFrame.top;
+    if ( ( ref.getWidth() != width ) || ( ref.getHeight() != height ) )
+    {
+        bContentChanged = true;
+        stackChanges |= Content::CHANGE_DISPLAY_MODE;
+    }
+    ref.setWidth(width);
+    ref.setHeight(height);
 
     layerstack.updateLayerFlags();
+
+    // Replaces the unspecified change recorded by any geometry change above.
+    layerstack.setChanges(stackChanges);
+
+    if ( bContentChanged || ref.isGeometryChanged() )
+    {
+        ref.setGeneration(Content::allocateGeneration());
+    }
 }
 
 InputAnalyzer::InputAnalyzer()
@@ -292,12 +495,19 @@ void InputAnalyzer::onPrepare(size_t numDisplays, hwc_display_contents_1_t** ppD
         }
 
         mContent.resize(numDisplays);
+
+        // A change in the number of displays is a change of content.
+        if (numDisplays)
+        {
+            mContent.editDisplay(0).setGeneration(Content::allocateGeneration());
+        }
     }
 
     for ( size_t d = 0; d < numDisplays; d++ )
     {
         LogicalDisplay* pDisplay = displayManager.getSurfaceFlingerDisplay(d);
-        mDisplays[d].onPrepare( ppDisplayContents[d],
+        mDisplays[d].onPrepare( d,
+                                ppDisplayContents[d],
                                 mContent.editDisplay(d),
                                 hwcFrameIndex,
                                 now,
@@ -324,9 +534,10 @@ String8 InputAnalyzer::Display::dump(const char* pIdentifier) const
         return String8();
 
     // Debug - report to logcat the status of everything that we are being asked to set.
-    String8 output = String8::format("%s retireFenceFd:%d outbuf:%p outbufAcquireFenceFd:%d flags:%x numHwLayers:%zd\n",
+    String8 output = String8::format("%s retireFenceFd:%d outbuf:%p outbufAcquireFenceFd:%d flags:%x numHwLayers:%zd rebuilt:%u skipped:%u\n",
         pIdentifier, mpSrcDisplayContents->retireFenceFd, mpSrcDisplayContents->outbuf,
-        mpSrcDisplayContents->outbufAcquireFenceFd, mpSrcDisplayContents->flags, mpSrcDisplayContents->numHwLayers);
+        mpSrcDisplayContents->outbufAcquireFenceFd, mpSrcDisplayContents->flags, mpSrcDisplayContents->numHwLayers,
+        mRebuiltLayers, mSkippedLayers);
 
     for (uint32_t ly = 0; ly < mLayers.size(); ly++)
     {
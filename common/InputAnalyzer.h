@@ -45,20 +45,52 @@ public:
         void                        setForceGeometryChange(bool force)  { mbForceGeometry = force; }
 
         // Initialise on an onPrepare call
-        void                        onPrepare(hwc_display_contents_1_t* pDisplayContents, Content::Display& ref, uint32_t hwcFrameIndex, nsecs_t timestamp, LogicalDisplay* pHwDisplay);
+        void                        onPrepare(uint32_t d, hwc_display_contents_1_t* pDisplayContents, Content::Display& ref, uint32_t hwcFrameIndex, nsecs_t timestamp, LogicalDisplay* pHwDisplay);
 
         // Clear the state to disabled
-        void                        disable() { mLayers.clear(); mpSrcDisplayContents = NULL; setForceGeometryChange(true); }
+        void                        disable() { mLayers.clear(); mShadows.clear(); mpSrcDisplayContents = NULL; setForceGeometryChange(true); }
 
         // Dump display to logcat
         String8                     dump(const char* pIdentifier = "InputAnalyzer") const;
 
     private:
+        // The hwc_layer_1_t state that a layer was last built from.
+        // Layers that still match their shadow are not rebuilt on a geometry change.
+        class LayerShadow
+        {
+        public:
+            LayerShadow() : mbValid(false) { }
+
+            // Returns the changes (see Content::EChange) from the shadow to layer.
+            uint32_t                getChanges(const hwc_layer_1_t& layer) const;
+            void                    set(const hwc_layer_1_t& layer);
+            buffer_handle_t         getHandle() const                   { return mbValid ? mHandle : NULL; }
+            void                    setHandle(buffer_handle_t handle)   { mHandle = handle; }
+
+        private:
+            buffer_handle_t         mHandle;
+            uint32_t                mHints;
+            uint32_t                mFlags;
+            int32_t                 mBlending;
+            uint32_t                mTransform;
+            hwc_frect_t             mSourceCrop;
+            hwc_rect_t              mDisplayFrame;
+            Layer::VisibleRegions   mVisibleRegions;
+            uint8_t                 mPlaneAlpha;
+            bool                    mbValid;
+        };
+
         std::vector<Layer>          mLayers;
+        std::vector<LayerShadow>    mShadows;                           // Source state for each of mLayers
+        std::vector<LayerShadow>    mPrevShadows;                       // Shadows of the previous geometry, retained for reuse
         Layer                       mOutputLayer;                       // Space to store any output layer passed into the HWC.
         hwc_display_contents_1_t*   mpSrcDisplayContents;               // Pointer to original source display
 
         bool                        mbForceGeometry:1;                  // Geometry changed on this frame
+
+        // Statistics.
+        uint32_t                    mRebuiltLayers;                     // Layers rebuilt on geometry changes
+        uint32_t                    mSkippedLayers;                     // Layers left unchanged on geometry changes
     };
 
 
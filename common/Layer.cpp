@@ -121,6 +121,7 @@ void Layer::clear()
     mTransform = ETransform::NONE;
     mPlaneAlpha = 0;
     mDataSpace = DataSpace_Unknown;
+    mChanges = 0;
 
     mSrc.left = 0;
     mSrc.right = 0;
@@ -131,6 +132,10 @@ void Layer::clear()
     mDst.top = 0;
     mDst.bottom = 0;
 
+    mSolidColor = 0;
+    mbSolidColor = false;
+    mbLateProducer = false;
+
     mBufferDetails.clear( );
 }
 
@@ -138,6 +143,7 @@ void Layer::onUpdatePending(nsecs_t now)
 {
     mFrameRate.update(now, true);
     mHandle = NULL;
+    mbSolidColor = false;
 
     mBufferDetails.clear( );
 }
@@ -151,6 +157,7 @@ void Layer::onUpdateFrameState(buffer_handle_t handle, nsecs_t now)
     // The API allows us to assume an unchanged handle is unchanged buffer state
     if (bHandleChanged)
     {
+        mbSolidColor = false;
         onUpdateBufferState();
     }
 }
@@ -182,6 +189,9 @@ void Layer::onUpdateFrameState(const Layer& layer)
     mPlaneAlpha             = layer.mPlaneAlpha;
     mDataSpace              = layer.mDataSpace;
     mbFrontBufferRendered   = layer.mbFrontBufferRendered;
+    mSolidColor             = layer.mSolidColor;
+    mbSolidColor            = layer.mbSolidColor;
+    mbLateProducer          = layer.mbLateProducer;
 
     mSourceAcquireFence.setLocation( layer.getAcquireFenceReturn() );
     mSourceReleaseFence.setLocation( layer.getReleaseFenceReturn() );
@@ -298,6 +308,8 @@ void Layer::onUpdateAll(hwc_layer_1& layer, nsecs_t now, bool bForceOpaque)
 
     mDataSpace = DataSpace_Unknown; // Default assumption
 
+    mbSolidColor = false;
+
     mVisibleRegions.clear();
     if (layer.visibleRegionScreen.numRects > 0)
     {
@@ -337,6 +349,7 @@ void Layer::onUpdateAll(buffer_handle_t handle, bool bForceOpaque)
     mpComposition = NULL;
     mPlaneAlpha = 1.0f;
     mDataSpace = DataSpace_Unknown;
+    mbSolidColor = false;
 
     mFrameRate.reset(0);
 
@@ -573,6 +586,8 @@ String8 Layer::dump(const char* pPrefix) const
     if (isSrcOffset())              output.appendFormat(" SO");
     if (isSrcCropped())             output.appendFormat(" SC");
     if (isFrontBufferRendered())    output.appendFormat(" FBR");
+    if (isSolidColor())             output.appendFormat(" SOLID(%08x)", mSolidColor);
+    if (isLateProducer())           output.appendFormat(" LATE");
     if (getBufferCompression() != COMPRESSION_NONE)
     {
         output.appendFormat(" RC(%s)", AbstractBufferManager::get().getCompressionName(getBufferCompression()));
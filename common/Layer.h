@@ -20,6 +20,7 @@
 #include "AbstractComposition.h"
 #include "Timeline.h"
 #include "Format.h"
+#include "SmallVector.h"
 #include "Utils.h"
 #include <utils/Vector.h>
 
@@ -150,6 +151,11 @@ public:
         bool             mbDeviceIdValid:1;// Is mDeviceId valid.
     };
 
+    // Visible regions are nearly always a single rect. Keep the common cases inline so that
+    // copying a layer does not touch the heap.
+    static const uint32_t cInlineVisibleRegions = 2;
+    typedef SmallVector<hwc_rect_t, cInlineVisibleRegions> VisibleRegions;
+
     Layer();
     Layer(hwc_layer_1_t& hwc_layer);
     Layer(buffer_handle_t handle);
@@ -191,6 +197,7 @@ public:
     const hwc_rect_t&   getDst() const                      { return mDst;                              }
     hwc_rect_t&         editDst()                           { return mDst;                              }
     float               getPlaneAlpha() const               { return mPlaneAlpha;                       }
+    uint32_t            getChanges() const                  { return mChanges;                          }
     uint32_t            getFps() const                      { return mFrameRate.getFps();               }
     const FramerateTracker& getFrameRateTracker() const     { return mFrameRate;                        }
     FramerateTracker&   editFrameRateTracker()              { return mFrameRate;                        }
@@ -223,8 +230,17 @@ public:
     bool                isFrontBufferRendered() const       { return mbFrontBufferRendered;             }
     bool                isFullScreenVideo(uint32_t outWidth, uint32_t outHeight) const;
 
-    const Vector<hwc_rect_t>& getVisibleRegions() const     { return mVisibleRegions;                   }
-    Vector<hwc_rect_t>& editVisibleRegions()                { return mVisibleRegions;                   }
+    // Every pixel of the buffer is known to be getSolidColor() (RGBA_8888 byte order, as stored).
+    // This is a hint; the buffer remains valid and must still be used where the color can not be.
+    bool                isSolidColor() const                { return mbSolidColor;                      }
+    uint32_t            getSolidColor() const               { return mSolidColor;                       }
+
+    // The producer has recently been delivering buffers whose acquire fences signal after onSet
+    // (see FenceLatencyTracker). Composing such a layer would stall the rest of the composition.
+    bool                isLateProducer() const              { return mbLateProducer;                    }
+
+    const VisibleRegions& getVisibleRegions() const         { return mVisibleRegions;                   }
+    VisibleRegions&     editVisibleRegions()                { return mVisibleRegions;                   }
 
     // Set various state.  NOTE: you *MUST* call 'onUpdateFlags()' following any of these.
     void setBufferFormat(int32_t format)                    { mBufferDetails.setFormat( format );
@@ -246,9 +262,17 @@ public:
     void setSrc(const hwc_frect_t src)                      { mSrc = src;                               }
     void setDst(const hwc_rect_t dst)                       { mDst = dst;                               }
     void setPlaneAlpha(float planeAlpha)                    { mPlaneAlpha = planeAlpha;                 }
-    void setVisibleRegions(const Vector<hwc_rect_t>& vr)    { mVisibleRegions = vr;                     }
+    void setVisibleRegions(const VisibleRegions& vr)        { mVisibleRegions = vr;                     }
     void setFps(uint32_t fps)                               { mFrameRate.setFps(fps);                   }
     void setComposition(AbstractComposition *pComposition)  { mpComposition = pComposition;             }
+    void setSolidColor(uint32_t color)                      { mSolidColor = color; mbSolidColor = true; }
+    void setLateProducer(bool bLate)                        { mbLateProducer = bLate;                   }
+
+    // Changes to this layer since the previous frame (see Content::EChange).
+    // This is set by the InputAnalyzer. Filters that hold copies of layers must refresh them
+    // from the source layer each frame for the changes to remain accurate.
+    void setChanges(uint32_t changes)                       { mChanges = changes;                       }
+    void addChanges(uint32_t changes)                       { mChanges |= changes;                      }
     void setBufferPavpSession(uint32_t session, uint32_t instance, uint32_t isEncrypted);
 
     int  getAcquireFence() const                            { return mSourceAcquireFence.get(); }
@@ -329,35 +353,22 @@ private:
     }
 
 private:
-
-    // This class tracks the frame rate that this layers handle is changing at
-    FramerateTracker            mFrameRate;
-
-    // Fence references.
-    Timeline::FenceReference mSourceAcquireFence;    // This is the location of the source layers acquire fence return value
-    Timeline::FenceReference mSourceReleaseFence;    // This is the location of the source layers release fence return value
-
-    AbstractComposition*        mpComposition;          // Pointer to the engine required to compose this layer. Null if its a uncomposed allocation.
-
-    // Buffer details for this layers handle.
-    // Only guaranteed to be valid between the start of prepare and the end of set
-    BufferDetails               mBufferDetails;
+    // Members are ordered by how often they are touched. The fields at the top are read by
+    // every stage of every frame (filters, plane allocation, composition) and are kept
+    // together at the start of the object; rarely used state follows.
 
     // Copy of the input layer state. This can be modified by the HWC at need
     buffer_handle_t             mHandle;
+    AbstractComposition*        mpComposition;          // Pointer to the engine required to compose this layer. Null if its a uncomposed allocation.
     hwc_frect_t                 mSrc;
     hwc_rect_t                  mDst;
-    Vector<hwc_rect_t>          mVisibleRegions;
     uint32_t                    mHints;
     uint32_t                    mFlags;
     EBlendMode                  mBlending;
     ETransform                  mTransform;
     float                       mPlaneAlpha;
     DataSpace                   mDataSpace;
-
-    // Store layer scale factor, maybe used to do some optimization.
-    float                       mWidthScaleFactor;
-    float                       mHeightScaleFactor;
+    uint32_t                    mChanges;               // Changes since the previous frame (see Content::EChange).
 
     // State flags for the layer used in a variety of places
     bool                        mbVideo:1;                  // Is this a video buffer
@@ -368,6 +379,30 @@ private:
     bool                        mbSrcOffset:1;              // Layer is presenting an offset subrect of the source buffer.
     bool                        mbSrcCropped:1;             // Layer is presenting a cropped subrect of the source buffer.
     bool                        mbFrontBufferRendered:1;    // Rendering may occur after the buffer is presented.
+    bool                        mbSolidColor:1;             // The buffer is known to be a single color.
+    bool                        mbLateProducer:1;           // The producer's acquire fences are signaling late.
+
+    // Solid color hint, valid if mbSolidColor is set. Reset whenever the handle changes.
+    uint32_t                    mSolidColor;
+
+    // Fence references.
+    Timeline::FenceReference mSourceAcquireFence;    // This is the location of the source layers acquire fence return value
+    Timeline::FenceReference mSourceReleaseFence;    // This is the location of the source layers release fence return value
+
+    // Buffer details for this layers handle.
+    // Only guaranteed to be valid between the start of prepare and the end of set
+    BufferDetails               mBufferDetails;
+
+    VisibleRegions              mVisibleRegions;
+
+    // Cold state, only used by a few filters and for debug.
+
+    // This class tracks the frame rate that this layers handle is changing at
+    FramerateTracker            mFrameRate;
+
+    // Store layer scale factor, maybe used to do some optimization.
+    float                       mWidthScaleFactor;
+    float                       mHeightScaleFactor;
 };
 
 inline bool operator==(const hwc_layer_1 &hwcLayer, const Layer &layer)
@@ -35,7 +35,7 @@ bool LayerBlanker::clear(unsigned display, bool bGeometryChange)
     return true;
 }
 
-bool LayerBlanker::DisplayInfo::blank(unsigned layer)
+bool LayerBlanker::DisplayInfo::blank(unsigned layer, buffer_handle_t fillHandle, uint32_t fillColor)
 {
     uint32_t index = mCount;
     bool bChanged = true;
@@ -51,13 +51,15 @@ bool LayerBlanker::DisplayInfo::blank(unsigned layer)
     else
     {
         LayerInfo &info = mLayerInfo[index];
-        if (info.mLayerIdx == layer)
+        if ((info.mLayerIdx == layer) && (info.mFillHandle == fillHandle) && (info.mFillColor == fillColor))
         {
             bChanged = false;
         }
     }
     LayerInfo &info = mLayerInfo[index];
     info.mLayerIdx = layer;
+    info.mFillHandle = fillHandle;
+    info.mFillColor = fillColor;
     info.mbChanged = bChanged;
     if (bChanged)
     {
@@ -72,6 +74,12 @@ bool LayerBlanker::blank(unsigned display, unsigned layer)
     return mDisplayInfo.editItemAt(display).blank(layer);
 }
 
+bool LayerBlanker::fill(unsigned display, unsigned layer, buffer_handle_t handle, uint32_t color)
+{
+    ALOG_ASSERT(handle);
+    return mDisplayInfo.editItemAt(display).blank(layer, handle, color);
+}
+
 const Content& LayerBlanker::update(const Content& ref)
 {
     // Check for changes
@@ -119,10 +127,19 @@ const Content& LayerBlanker::update(const Content& ref)
                 const Layer& oldLayer = layerStack.getLayer(info.mLayerIdx);
                 if (info.mbChanged)
                 {
-                    info.mLayer.onUpdateAll(mpBlankBuffer->handle);
+                    info.mLayer.onUpdateAll(info.mFillHandle ? info.mFillHandle : mpBlankBuffer->handle);
                     // TODO: Try and crop the buffer if large enough rather than scaling.
                     info.mLayer.setDst(oldLayer.getDst());
                     info.mLayer.setVisibleRegions(oldLayer.getVisibleRegions());
+                    if (info.mFillHandle)
+                    {
+                        // A fully opaque color does not need blending whatever the original layer asked for.
+                        const bool bOpaque = (info.mFillColor >> 24) == 0xFF;
+                        info.mLayer.setBlending(bOpaque ? EBlendMode::NONE : oldLayer.getBlending());
+                        info.mLayer.setPlaneAlpha(oldLayer.getPlaneAlpha());
+                        info.mLayer.setFlags(oldLayer.getFlags());
+                        info.mLayer.setSolidColor(info.mFillColor);
+                    }
                     info.mLayer.onUpdateFlags();
                     info.mbChanged = false;
                 }
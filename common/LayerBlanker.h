@@ -41,6 +41,12 @@ public:
     // Should be called between 'clear' and 'update'.
     bool blank(unsigned display, unsigned layer);
 
+    // Have the specified layer on a display replaced by a buffer filled with a solid color.
+    // Unlike 'blank', the blending and plane alpha of the original layer are retained and the
+    // replacement is tagged with the color (see Layer::isSolidColor).
+    // Should be called between 'clear' and 'update'.
+    bool fill(unsigned display, unsigned layer, buffer_handle_t handle, uint32_t color);
+
     // Specify the buffer to replace layers with.
     void setBlankingBuffer(sp<GraphicBuffer> buffer) { mpBlankBuffer = buffer; }
 
@@ -53,10 +59,12 @@ private:
     struct LayerInfo {
         static const unsigned INVALID_INDEX = UINT_MAX;
         LayerInfo() { clear(); }
-        void clear() { mLayerIdx = INVALID_INDEX; mbChanged = true; }
-        Layer    mLayer;
-        unsigned mLayerIdx;
-        bool     mbChanged;
+        void clear() { mLayerIdx = INVALID_INDEX; mFillHandle = NULL; mFillColor = 0; mbChanged = true; }
+        Layer           mLayer;
+        unsigned        mLayerIdx;
+        buffer_handle_t mFillHandle;    // Solid color buffer or NULL to use the blanking buffer.
+        uint32_t        mFillColor;
+        bool            mbChanged;
     };
 
     // Per-display tracking information.
@@ -68,7 +76,7 @@ private:
         unsigned count() const { return mCount; }
         bool isGeometryChanged() const { return mbGeometryChanged || (mLayerInfo.size() != mCount); }
         void prune() { if (mLayerInfo.size() > mCount) { mbGeometryChanged = true; mLayerInfo.resize(mCount); } }
-        bool blank(unsigned layer);
+        bool blank(unsigned layer, buffer_handle_t fillHandle = NULL, uint32_t fillColor = 0);
         std::vector<LayerInfo> mLayerInfo;
     private:
         unsigned mCount;
@@ -16,6 +16,7 @@
 
 #include "Common.h"
 #include "Log.h"
+#include "HotPathStats.h"
 #include "Layer.h"
 #include "AbstractLog.h"
 #include "AbstractCompositionChecker.h"
@@ -53,12 +54,14 @@ private:
     char*                   mBack;
     bool                    mbLogviewToLogcat;
     uint32_t                mAllocatedSize;
+    nsecs_t                 mReserveTime;       // Time the entry in progress was reserved (0 if not timed).
     Mutex                   mLock;
 };
 
 BasicLog::BasicLog(uint32_t maxLogSize) :
     mOptionLogSizeK("debuglogbufk", 64),
-    mbLogviewToLogcat(false)
+    mbLogviewToLogcat(false),
+    mReserveTime(0)
 {
     int32_t logSizeK = mOptionLogSizeK;
     if (logSizeK < 16) logSizeK = 16;
@@ -82,6 +85,7 @@ BasicLog::~BasicLog()
 char* BasicLog::reserve(uint32_t maxSize)
 {
     mLock.lock();
+    mReserveTime = HotPathStats::isEnabled() ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
     ALOGD_IF(HWCLOG_DEBUG, "Log: OpenNewLogEntry mBack=%p", mBack);
     char* possibleEntryEnd = mBack + maxSize;
     if (possibleEntryEnd > mLogBuf + mAllocatedSize)
@@ -143,6 +147,10 @@ void BasicLog::log(char* endPtr)
         mBack = endPtr;
     }
 
+    if (mReserveTime)
+    {
+        HotPathStats::get().add(HotPathStats::LOG_WRITE, systemTime(SYSTEM_TIME_MONOTONIC) - mReserveTime);
+    }
     mLock.unlock();
 }
 
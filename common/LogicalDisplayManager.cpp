@@ -175,13 +175,16 @@ const Content& LogicalDisplayManager::onApply( const Content& ref )
     ALOG_ASSERT( cMaxSupportedPhysicalDisplays <= 32 );
 
     // A change in any SF display propagates a geometry change.
+    // Unlike changes made by the display manager itself (mbGeometryChange) these leave the
+    // description of the changes to each display intact.
+    bool bSFGeometryChange = false;
     for ( uint32_t sf = 0; sf < inDisplays; ++sf )
     {
         const Content::Display& sfDisplay = ref.getDisplay( sf );
         if ( sfDisplay.isGeometryChanged() )
         {
             ALOGD_IF( LOGDISP_DEBUG, "LogicalDisplayManager : Filter geometry change on SF display %u (=> geometry change)", sf );
-            mbGeometryChange = true;
+            bSFGeometryChange = true;
         }
     }
 
@@ -193,13 +196,14 @@ const Content& LogicalDisplayManager::onApply( const Content& ref )
         maFilterDisplayState.resize( outDisplays );
         mbGeometryChange = true;
     }
+    const bool bGeometryChange = mbGeometryChange || bSFGeometryChange;
 
     // Clear all physical displays to start with.
     // Logical displays filter() will fill in display state.
     for ( uint32_t pd = 0; pd < outDisplays; ++pd )
     {
         Content::Display& phDisplay = mFilterOut.editDisplay( pd );
-        if ( mbGeometryChange )
+        if ( bGeometryChange )
         {
             phDisplay.setDisplayType( eDTUnspecified );
             phDisplay.setOutputLayer( NULL );
@@ -217,13 +221,13 @@ const Content& LogicalDisplayManager::onApply( const Content& ref )
     {
         const Content::Display& sfDisplay = ref.getDisplay( sf );
         ALOGD_IF( LOGDISP_DEBUG, "LogicalDisplayManager : Filter SF%u%s %s",
-            sf, sfDisplay.isGeometryChanged() ? " (Geom)" : "", mbGeometryChange ? "+Geom" : "" );
+            sf, sfDisplay.isGeometryChanged() ? " (Geom)" : "", bGeometryChange ? "+Geom" : "" );
         if ( !mDisplayState[ sf ].isAttached() )
             continue;
         LogicalDisplay* pLD = mDisplayState[ sf ].getDisplay();
         ALOG_ASSERT( pLD );
         pLD->filter( *this, sfDisplay, mFilterOut, maFilterDisplayState,
-                    ( mbGeometryChange || sfDisplay.isGeometryChanged( ) ) );
+                    ( bGeometryChange || sfDisplay.isGeometryChanged( ) ) );
     }
 
     // Finish updates.
@@ -272,6 +276,20 @@ const Content& LogicalDisplayManager::onApply( const Content& ref )
         mFilterOut.setGeometryChanged( mbGeometryChange );
         mbGeometryChange = false;
     }
+    else if ( bSFGeometryChange )
+    {
+        for ( uint32_t pd = 0; pd < outDisplays; ++pd )
+        {
+            Content::Display& phDisplay = mFilterOut.editDisplay( pd );
+            if ( !phDisplay.isGeometryChanged() )
+            {
+                // Keep the changes (if any) that this display already describes.
+                const uint32_t changes = phDisplay.getChanges();
+                phDisplay.setGeometryChanged( true );
+                phDisplay.editLayerStack().setChanges( changes );
+            }
+        }
+    }
 
     if ( LOGDISP_DEBUG )
     {
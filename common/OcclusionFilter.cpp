@@ -0,0 +1,281 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "Layer.h"
+#include "Log.h"
+#include "Transform.h"
+#include "Utils.h"
+
+#include "OcclusionFilter.h"
+#include "FilterManager.h"
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// Factory instance
+OcclusionFilter gOcclusionFilter;
+
+static inline uint64_t rectArea( const hwc_rect_t& r )
+{
+    return (uint64_t)( r.right - r.left ) * ( r.bottom - r.top );
+}
+
+OcclusionFilter::OcclusionFilter() :
+    mOptionOcclusion( "occlusion", 1 ),
+    mCulledLayers( 0 ),
+    mTrimmedLayers( 0 ),
+    mCulledPixels( 0 )
+{
+    // Add this filter to the filter list
+    FilterManager::getInstance().add(*this, FilterPosition::Occlusion);
+}
+
+OcclusionFilter::~OcclusionFilter()
+{
+    // remove this filter
+    FilterManager::getInstance().remove(*this);
+}
+
+bool OcclusionFilter::isOccluder( const Layer& layer )
+{
+    return layer.isEnabled()
+        && layer.isOpaque()
+        && !( layer.getFlags() & HWC_SKIP_LAYER );
+}
+
+bool OcclusionFilter::subtractOccluders( const hwc_rect_t& rect, const std::vector<hwc_rect_t>& occluders,
+                                         std::vector<hwc_rect_t>& fragments )
+{
+    fragments.clear();
+    fragments.push_back( rect );
+
+    for ( const hwc_rect_t& occ : occluders )
+    {
+        for ( uint32_t f = 0; f < fragments.size(); )
+        {
+            const hwc_rect_t frag = fragments[f];
+            hwc_rect_t overlap;
+            if ( !computeOverlap( frag, occ, &overlap ) )
+            {
+                ++f;
+                continue;
+            }
+
+            // Replace the fragment with up to four bands around the overlap.
+            fragments.erase( fragments.begin() + f );
+            if ( frag.top < overlap.top )
+            {
+                hwc_rect_t r = { frag.left, frag.top, frag.right, overlap.top };
+                fragments.insert( fragments.begin() + f++, r );
+            }
+            if ( overlap.bottom < frag.bottom )
+            {
+                hwc_rect_t r = { frag.left, overlap.bottom, frag.right, frag.bottom };
+                fragments.insert( fragments.begin() + f++, r );
+            }
+            if ( frag.left < overlap.left )
+            {
+                hwc_rect_t r = { frag.left, overlap.top, overlap.left, overlap.bottom };
+                fragments.insert( fragments.begin() + f++, r );
+            }
+            if ( overlap.right < frag.right )
+            {
+                hwc_rect_t r = { overlap.right, overlap.top, frag.right, overlap.bottom };
+                fragments.insert( fragments.begin() + f++, r );
+            }
+            if ( fragments.size() > cMaxFragments )
+            {
+                return false;
+            }
+        }
+        if ( fragments.empty() )
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+const Content& OcclusionFilter::onApply(const Content& ref)
+{
+    mCulledLayers = 0;
+    mTrimmedLayers = 0;
+    mCulledPixels = 0;
+
+    if ( !mOptionOcclusion )
+    {
+        return ref;
+    }
+
+    bool bModified = false;
+
+    for ( uint32_t d = 0; ( d < ref.size() ) && ( d < cMaxSupportedSFDisplays ); d++ )
+    {
+        const Content::Display& display = ref.getDisplay(d);
+        const Content::LayerStack& layerStack = display.getLayerStack();
+        DisplayState& displayState = mDisplayState[d];
+        const uint32_t layerCount = layerStack.size();
+
+        if ( !display.isEnabled() || ( layerCount < 2 ) )
+        {
+            displayState.mDecisions.clear();
+            continue;
+        }
+
+        // Walk top to bottom accumulating the opaque area.
+        mOccluders.clear();
+        mDecisions.assign( layerCount, eKeep );
+        mTrims.resize( layerCount );
+        bool bAny = false;
+        for ( int32_t ly = layerCount - 1; ly >= 0; --ly )
+        {
+            const Layer& layer = layerStack.getLayer( ly );
+            const hwc_rect_t& dst = layer.getDst();
+            if ( !layer.isEnabled() || ( dst.left >= dst.right ) || ( dst.top >= dst.bottom ) )
+            {
+                continue;
+            }
+
+            if ( mOccluders.size() && !( layer.getFlags() & HWC_SKIP_LAYER )
+              && subtractOccluders( dst, mOccluders, mFragments ) )
+            {
+                if ( mFragments.empty() )
+                {
+                    mDecisions[ly] = eCull;
+                    bAny = true;
+                    continue;
+                }
+                if ( ( mFragments.size() == 1 ) && ( mFragments[0] != dst ) )
+                {
+                    mDecisions[ly] = eTrim;
+                    mTrims[ly] = mFragments[0];
+                    bAny = true;
+                }
+            }
+
+            if ( isOccluder( layer ) )
+            {
+                mOccluders.push_back( dst );
+            }
+        }
+
+        const bool bChanged = ( mDecisions != displayState.mDecisions );
+        displayState.mDecisions.swap( mDecisions );
+
+        if ( !bAny && !( bChanged && !display.isGeometryChanged() ) )
+        {
+            continue;
+        }
+
+        if ( !bModified )
+        {
+            // Copy the content for modification
+            mReference = ref;
+            bModified = true;
+        }
+        Content::Display& out = mReference.editDisplay(d);
+        Content::LayerStack& outStack = out.editLayerStack();
+
+        // Removing or trimming layers (or ceasing to) changes what follows.
+        if ( bChanged )
+        {
+            out.setGeometryChanged( true );
+        }
+
+        if ( !bAny )
+        {
+            continue;
+        }
+
+        // The storage must not be resized once the stack references it.
+        if ( displayState.mLayers.size() < layerCount )
+        {
+            displayState.mLayers.resize( layerCount );
+        }
+
+        const std::vector<uint8_t>& decisions = displayState.mDecisions;
+        for ( uint32_t ly = 0; ly < layerCount; ++ly )
+        {
+            if ( decisions[ly] != eTrim )
+                continue;
+
+            Layer& layer = outStack.editLayer( ly, displayState.mLayers );
+            const uint64_t before = rectArea( layer.getDst() );
+            if ( !clipLayerToDestRect( &layer, mTrims[ly] ) )
+            {
+                continue;
+            }
+
+            // Keep the visible regions within the trimmed frame.
+            Layer::VisibleRegions& visRegions = layer.editVisibleRegions();
+            for ( int32_t r = visRegions.size() - 1; r >= 0; --r )
+            {
+                hwc_rect_t clipped;
+                if ( computeOverlap( visRegions[r], layer.getDst(), &clipped ) )
+                {
+                    visRegions.editItemAt(r) = clipped;
+                }
+                else
+                {
+                    visRegions.removeAt(r);
+                }
+            }
+            layer.onUpdateFlags();
+
+            ++mTrimmedLayers;
+            mCulledPixels += before - rectArea( layer.getDst() );
+            ALOGD_IF( FILTER_DEBUG, "OcclusionFilter: D%u trimmed layer %u %s", d, ly, layer.dump().string() );
+        }
+
+        // Remove from the top so indices below are unaffected.
+        for ( int32_t ly = layerCount - 1; ly >= 0; --ly )
+        {
+            if ( decisions[ly] != eCull )
+                continue;
+
+            ++mCulledLayers;
+            mCulledPixels += rectArea( outStack.getLayer( ly ).getDst() );
+            ALOGD_IF( FILTER_DEBUG, "OcclusionFilter: D%u culled layer %u %s", d, ly, outStack.getLayer( ly ).dump().string() );
+            outStack.removeLayer( ly );
+        }
+        outStack.updateLayerFlags();
+    }
+
+    if ( !bModified )
+    {
+        // No work to do so return the unmodified content.
+        // Don't keep our (old) reference copy hanging around, we might not be
+        // back for a while.
+        if (mReference.size())
+        {
+            mReference.resize(0);
+        }
+        return ref;
+    }
+
+    return mReference;
+}
+
+String8 OcclusionFilter::dump()
+{
+    return String8::format( "Culled:%u Trimmed:%u Pixels:%" PRIu64, mCulledLayers, mTrimmedLayers, mCulledPixels );
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,91 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_OCCLUSIONFILTER_H
+#define INTEL_UFO_HWC_OCCLUSIONFILTER_H
+
+#include "AbstractFilter.h"
+#include "Option.h"
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This filter removes layers that are completely hidden by opaque layers above them
+// and trims layers that are partially hidden where the remaining area is rectangular.
+class OcclusionFilter : public AbstractFilter
+{
+public:
+    OcclusionFilter();
+    virtual ~OcclusionFilter();
+
+    const char* getName() const { return "OcclusionFilter"; }
+    const Content& onApply(const Content& ref);
+    // The output is purely a function of the input and the option.
+    bool getDependencySignature( uint64_t& signature ) const { signature = mOptionOcclusion.get(); return true; }
+    String8 dump();
+
+protected:
+    // Maximum number of rectangles used to track the uncovered part of a layer.
+    // Layers that fragment further are assumed visible.
+    static const uint32_t cMaxFragments = 16;
+
+    enum EDecision
+    {
+        eKeep,
+        eTrim,
+        eCull
+    };
+
+    // Subtract the occluders from rect.
+    // Returns false if the result could not be tracked, otherwise fragments holds the uncovered area.
+    static bool subtractOccluders( const hwc_rect_t& rect, const std::vector<hwc_rect_t>& occluders,
+                                   std::vector<hwc_rect_t>& fragments );
+
+    // Can this layer hide layers below it.
+    static bool isOccluder( const Layer& layer );
+
+    // Private reference to hold modified state
+    Content mReference;
+
+    // Helper struct to contain per display state
+    struct DisplayState
+    {
+        std::vector<Layer>      mLayers;        // Storage for trimmed layers.
+        std::vector<uint8_t>    mDecisions;     // Per-layer decisions last frame (EDecision).
+    };
+    DisplayState mDisplayState[cMaxSupportedSFDisplays];
+
+    // Scratch space.
+    std::vector<hwc_rect_t> mOccluders;
+    std::vector<hwc_rect_t> mFragments;
+    std::vector<uint8_t>    mDecisions;
+    std::vector<hwc_rect_t> mTrims;
+
+    Option      mOptionOcclusion;
+
+    // Last frame statistics.
+    uint32_t    mCulledLayers;
+    uint32_t    mTrimmedLayers;
+    uint64_t    mCulledPixels;
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_OCCLUSIONFILTER_H
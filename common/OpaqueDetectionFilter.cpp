@@ -0,0 +1,434 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "OpaqueDetectionFilter.h"
+#include "FilterManager.h"
+#include "CompositionManager.h"
+#include "Layer.h"
+#include <algorithm>
+#include <math.h>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+#define OPAQUE_DETECTION_FILTER_DEBUG 0
+
+// Factory instance
+OpaqueDetectionFilter gOpaqueDetectionFilter;
+
+// A single analysis request. Jobs are executed by the filter's scan pool.
+class OpaqueDetectionFilter::DetectionJob : public ScanJob
+{
+public:
+    DetectionJob(sp<ScanBuffer> pLinearBuffer);
+
+    const Layer& getLayer()                         { return mDetectionLayer; }
+    Layer& editLayer()                              { return mDetectionLayer; }
+    bool isOpaque() const                           { return mbResult; }
+    const PixelScan::Stats& getScanStats() const    { return mScanStats; }
+
+protected:
+    void onRun();
+
+private:
+    sp<ScanBuffer>      mpLinearBuffer;     // Linear copy of the buffer for rapid processing
+    Layer               mDetectionLayer;    // Layer currently being analysed
+    bool                mbResult;
+    PixelScan::Stats    mScanStats;         // Scan statistics for this analysis
+};
+
+OpaqueDetectionFilter::DetectionJob::DetectionJob(sp<ScanBuffer> pLinearBuffer) :
+    mpLinearBuffer(pLinearBuffer),
+    mDetectionLayer(pLinearBuffer->getBuffer()->handle),
+    mbResult(false)
+{
+    // Largest layers first.
+    mPriority = (uint64_t)mDetectionLayer.getBufferWidth() * mDetectionLayer.getBufferHeight();
+}
+
+void OpaqueDetectionFilter::DetectionJob::onRun()
+{
+    if (!isCancelled())
+    {
+        mDetectionLayer.waitRendering(ms2ns( 1000 ));
+    }
+
+    uint32_t* pBuffer = isCancelled() ? NULL : mpLinearBuffer->map();
+    if (pBuffer)
+    {
+        // Only the presented part of the buffer matters.
+        const hwc_frect_t& src = mDetectionLayer.getSrc();
+        const uint32_t w = mDetectionLayer.getBufferWidth();
+        const uint32_t h = mDetectionLayer.getBufferHeight();
+        const uint32_t s = mDetectionLayer.getBufferPitch() / 4;
+        const uint32_t x1 = (uint32_t)max( 0.0f, floorf( src.left ) );
+        const uint32_t y1 = (uint32_t)max( 0.0f, floorf( src.top ) );
+        const uint32_t x2 = min( w, (uint32_t)max( 0.0f, ceilf( src.right ) ) );
+        const uint32_t y2 = min( h, (uint32_t)max( 0.0f, ceilf( src.bottom ) ) );
+
+        // Compare just the alpha channel (RGBA_8888 byte order).
+        const uint32_t ALPHA = 0xFF000000;
+        mbResult = ( x1 < x2 ) && ( y1 < y2 )
+                && PixelScan::checkRegion( ALPHA, ALPHA, ALPHA, pBuffer, s, x1, y1, x2, y2, &mScanStats );
+        ALOGD_IF( OPAQUE_DETECTION_FILTER_DEBUG, "OpaqueDetectionFilter: Detect %u,%u %u,%u result %d",
+                  x1, y1, x2, y2, mbResult );
+    }
+
+    mpLinearBuffer = NULL;
+}
+
+OpaqueDetectionFilter::OpaqueDetectionFilter() :
+    mBM( AbstractBufferManager::get() ),
+    mOptionOpaqueDetect( "opaquedetect", 1 ),
+    mPool( "OpaqueDetect", cMaxCandidates ),
+    mDetections( 0 ),
+    mOpaqueDetections( 0 ),
+    mOpaqueLayers( 0 )
+{
+    // Add this filter to the filter list
+    FilterManager::getInstance().add(*this, FilterPosition::OpaqueDetection);
+}
+
+OpaqueDetectionFilter::~OpaqueDetectionFilter()
+{
+    // remove this filter
+    FilterManager::getInstance().remove(*this);
+
+    for (Candidate& candidate : mCandidates)
+    {
+        cancelDetection( candidate );
+    }
+}
+
+bool OpaqueDetectionFilter::isCandidate( const Layer& layer )
+{
+    switch ( layer.getBufferFormat() )
+    {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            break;
+        default:
+            return false;
+    }
+
+    // Plane alpha needs blending whatever the content.
+    // Front buffer rendered content can change without the handle changing.
+    return layer.getHandle()
+        && ( layer.getBlending() != EBlendMode::NONE )
+        && !layer.isPlaneAlpha()
+        && !layer.isComposition()
+        && !layer.isEncrypted()
+        && !layer.isFrontBufferRendered()
+        && !( layer.getFlags() & HWC_SKIP_LAYER )
+        && ( (uint64_t)layer.getDstWidth() * layer.getDstHeight() >= cMinDstArea );
+}
+
+void OpaqueDetectionFilter::invalidateNewContent( const Content& ref )
+{
+    mPresenting.clear();
+    for (uint32_t d = 0; d < ref.size(); d++)
+    {
+        const Content::LayerStack& layerStack = ref.getDisplay(d).getLayerStack();
+        for (uint32_t ly = 0; ly < layerStack.size(); ly++)
+        {
+            const buffer_handle_t handle = layerStack.getLayer(ly).getHandle();
+            if ( handle )
+            {
+                mPresenting.push_back( handle );
+            }
+        }
+    }
+    std::sort( mPresenting.begin(), mPresenting.end() );
+    mPresenting.erase( std::unique( mPresenting.begin(), mPresenting.end() ), mPresenting.end() );
+
+    // A handle that was not presented last frame has been (re)queued with new content.
+    for (buffer_handle_t handle : mPresenting)
+    {
+        if ( !std::binary_search( mPresented.begin(), mPresented.end(), handle ) )
+        {
+            mBM.setBufferContentAlpha( handle, AbstractBufferManager::eContentAlpha_Unknown );
+        }
+    }
+    mPresented.swap( mPresenting );
+}
+
+OpaqueDetectionFilter::Candidate* OpaqueDetectionFilter::findCandidate( buffer_handle_t handle )
+{
+    Candidate* pFree = NULL;
+    for (Candidate& candidate : mCandidates)
+    {
+        if ( candidate.mHandle == handle )
+        {
+            return &candidate;
+        }
+        if ( ( pFree == NULL ) && ( candidate.mHandle == 0 ) )
+        {
+            pFree = &candidate;
+        }
+    }
+    if ( pFree )
+    {
+        pFree->reset();
+        pFree->mHandle = handle;
+    }
+    return pFree;
+}
+
+void OpaqueDetectionFilter::initiateDetection( Candidate& candidate, const Layer& layer )
+{
+    ATRACE_CALL_IF(DISPLAY_TRACE);
+
+    // If all the workers are backed up then try again next frame.
+    // Check before the copy so we dont waste a composition.
+    if ( mPool.isFull() )
+    {
+        return;
+    }
+
+    if ( candidate.mpLinearBuffer == NULL
+      || candidate.mpLinearBuffer->getWidth() != layer.getBufferWidth()
+      || candidate.mpLinearBuffer->getHeight() < layer.getBufferHeight() )
+    {
+        // Any previous mapping is released once the last job using it completes.
+        candidate.mpScanBuffer = NULL;
+        candidate.mpLinearBuffer = mBM.createGraphicBuffer( "OPAQUEDETECT",
+                                                            layer.getBufferWidth(), layer.getBufferHeight(),
+                                                            HAL_PIXEL_FORMAT_RGBA_8888,
+                                                            GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER );
+        if ( candidate.mpLinearBuffer == NULL )
+        {
+            ALOGD_IF( OPAQUE_DETECTION_FILTER_DEBUG, "OpaqueDetectionFilter: Failed to allocate linear buffer" );
+            return;
+        }
+    }
+    if ( candidate.mpScanBuffer == NULL )
+    {
+        candidate.mpScanBuffer = new ScanBuffer( candidate.mpLinearBuffer );
+    }
+    candidate.mFramesUnused = 0;
+
+    sp<DetectionJob> pJob = new DetectionJob( candidate.mpScanBuffer );
+
+    // Copy the whole buffer without any of the original layer state (src rect, dst rect, rotation, ...).
+    Layer clonedLayer[1];
+    clonedLayer[0].onUpdateAll( layer.getHandle() );
+    CompositionManager::getInstance().performComposition( Content::LayerStack( clonedLayer, 1 ), pJob->getLayer() );
+    pJob->editLayer().setSrc( layer.getSrc() );
+
+    // Hand over to the low priority detection workers
+    if ( mPool.submit( pJob ) )
+    {
+        ALOGD_IF( OPAQUE_DETECTION_FILTER_DEBUG, "OpaqueDetectionFilter: Detect %s", layer.dump().string() );
+        candidate.mpDetectionJob = pJob;
+    }
+}
+
+void OpaqueDetectionFilter::cancelDetection( Candidate& candidate )
+{
+    if ( candidate.mpDetectionJob != NULL )
+    {
+        mPool.cancel( candidate.mpDetectionJob );
+        candidate.mpDetectionJob = NULL;
+    }
+}
+
+const Content& OpaqueDetectionFilter::onApply(const Content& ref)
+{
+    for (Candidate& candidate : mCandidates)
+    {
+        candidate.mbSeen = false;
+    }
+
+    if ( mOptionOpaqueDetect )
+    {
+        invalidateNewContent( ref );
+
+        // Track the buffers that still need analysing and check those that stay unchanged.
+        for (uint32_t d = 0; d < ref.size(); d++)
+        {
+            const Content::LayerStack& layerStack = ref.getDisplay(d).getLayerStack();
+            for (uint32_t ly = 0; ly < layerStack.size(); ly++)
+            {
+                const Layer& layer = layerStack.getLayer(ly);
+                if ( !isCandidate( layer )
+                  || ( mBM.getBufferContentAlpha( layer.getHandle() ) != AbstractBufferManager::eContentAlpha_Unknown ) )
+                    continue;
+
+                Candidate* pCandidate = findCandidate( layer.getHandle() );
+                // Layers can appear on more than one display.
+                if ( ( pCandidate == NULL ) || pCandidate->mbSeen )
+                    continue;
+
+                pCandidate->mbSeen = true;
+                ++pCandidate->mRepeatCount;
+                if ( ( pCandidate->mpDetectionJob == NULL )
+                  && ( pCandidate->mRepeatCount >= cFramesBeforeCheck ) )
+                {
+                    initiateDetection( *pCandidate, layer );
+                }
+            }
+        }
+    }
+    else
+    {
+        // Everything is new content when we are re-enabled.
+        mPresented.clear();
+    }
+
+    for (Candidate& candidate : mCandidates)
+    {
+        // The content may change once the handle goes away so any pending result is useless.
+        if ( !candidate.mbSeen && candidate.mHandle )
+        {
+            cancelDetection( candidate );
+            candidate.reset();
+        }
+
+        if ( ( candidate.mpDetectionJob != NULL ) && candidate.mpDetectionJob->isFinished() )
+        {
+            mScanStats.add( candidate.mpDetectionJob->getScanStats() );
+            ++mDetections;
+            const bool bOpaque = candidate.mpDetectionJob->isOpaque();
+            if ( bOpaque )
+            {
+                ++mOpaqueDetections;
+            }
+            mBM.setBufferContentAlpha( candidate.mHandle, bOpaque ? AbstractBufferManager::eContentAlpha_Opaque
+                                                                  : AbstractBufferManager::eContentAlpha_Translucent );
+            candidate.mpDetectionJob = NULL;
+            candidate.reset();
+        }
+
+        // Release the linear copy once it has been idle for a while.
+        if ( ( candidate.mpDetectionJob == NULL ) && ( candidate.mpLinearBuffer != NULL )
+          && ( ++candidate.mFramesUnused > cMaxBufferAge ) )
+        {
+            candidate.mpLinearBuffer = NULL;
+            candidate.mpScanBuffer = NULL;
+        }
+    }
+
+    // Mark the layers with opaque content.
+    mOpaqueLayers = 0;
+    bool bModified = false;
+    for (uint32_t d = 0; ( d < ref.size() ) && ( d < cMaxSupportedSFDisplays ); d++)
+    {
+        const Content::Display& display = ref.getDisplay(d);
+        const Content::LayerStack& layerStack = display.getLayerStack();
+        DisplayState& displayState = mDisplayState[d];
+        const uint32_t layerCount = layerStack.size();
+
+        bool bAny = false;
+        mOpaque.assign( layerCount, 0 );
+        if ( mOptionOpaqueDetect )
+        {
+            for (uint32_t ly = 0; ly < layerCount; ly++)
+            {
+                const Layer& layer = layerStack.getLayer(ly);
+                if ( isCandidate( layer )
+                  && ( mBM.getBufferContentAlpha( layer.getHandle() ) == AbstractBufferManager::eContentAlpha_Opaque ) )
+                {
+                    mOpaque[ly] = 1;
+                    bAny = true;
+                }
+            }
+        }
+
+        const bool bChanged = ( mOpaque != displayState.mOpaque );
+        displayState.mOpaque.swap( mOpaque );
+
+        if ( !bAny && !( bChanged && !display.isGeometryChanged() ) )
+        {
+            continue;
+        }
+
+        if ( !bModified )
+        {
+            // Copy the content for modification
+            mReference = ref;
+            bModified = true;
+        }
+        Content::Display& out = mReference.editDisplay(d);
+        Content::LayerStack& outStack = out.editLayerStack();
+
+        // Blending changes can change plane and composition choices.
+        if ( bChanged )
+        {
+            out.setGeometryChanged( true );
+        }
+
+        if ( !bAny )
+        {
+            continue;
+        }
+
+        // The storage must not be resized once the stack references it.
+        if ( displayState.mLayers.size() < layerCount )
+        {
+            displayState.mLayers.resize( layerCount );
+        }
+
+        for (uint32_t ly = 0; ly < layerCount; ly++)
+        {
+            if ( !displayState.mOpaque[ly] )
+                continue;
+
+            Layer& layer = outStack.editLayer( ly, displayState.mLayers );
+            layer.setBlending( EBlendMode::NONE );
+            // The device id depends on the blending.
+            layer.onUpdateBufferState();
+            layer.onUpdateFlags();
+            ++mOpaqueLayers;
+        }
+        outStack.updateLayerFlags();
+    }
+
+    if ( !bModified )
+    {
+        // No work to do so return the unmodified content.
+        // Don't keep our (old) reference copy hanging around, we might not be
+        // back for a while.
+        if (mReference.size())
+        {
+            mReference.resize(0);
+        }
+        return ref;
+    }
+
+    return mReference;
+}
+
+String8 OpaqueDetectionFilter::dump()
+{
+    uint32_t tracked = 0;
+    for (const Candidate& candidate : mCandidates)
+    {
+        if ( candidate.mHandle )
+            ++tracked;
+    }
+
+    String8 output = String8::format( "Tracked:%u Opaque:%u Detections:%u/%u ",
+                                      tracked, mOpaqueLayers, mOpaqueDetections, mDetections );
+    output += PixelScan::dumpStats( mScanStats );
+    output += String8(" ") + mPool.dump();
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,122 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_OPAQUEDETECTIONFILTER_H
+#define INTEL_UFO_HWC_OPAQUEDETECTIONFILTER_H
+
+#include "AbstractFilter.h"
+#include "AbstractBufferManager.h"
+#include "Option.h"
+#include "PixelScan.h"
+#include "ScanPool.h"
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This filter finds blended layers with an alpha format where every pixel is actually
+// fully opaque and marks them opaque so that they can skip blending and use planes or
+// formats that only support opaque content.
+// The alpha channel is analysed on the background scan pool once a buffer has been
+// presented unchanged for a number of frames. The result is cached with the buffer in the
+// buffer manager and reset whenever new content is queued to the buffer.
+class OpaqueDetectionFilter : public AbstractFilter
+{
+public:
+    OpaqueDetectionFilter();
+    virtual ~OpaqueDetectionFilter();
+
+    const char* getName() const { return "OpaqueDetectionFilter"; }
+    const Content& onApply(const Content& ref);
+    String8 dump();
+
+private:
+    // Maximum number of buffers awaiting analysis at once.
+    static const uint32_t cMaxCandidates = 4;
+    // Number of frames a buffer must be presented unchanged before it is analysed.
+    static const uint32_t cFramesBeforeCheck = 10;
+    // Layers must cover at least this many pixels to be worth analysing.
+    static const uint32_t cMinDstArea = 128 * 128;
+    // Number of frames an unused linear buffer is kept around.
+    static const uint32_t cMaxBufferAge = 60;
+
+    class DetectionJob;
+
+    // Per buffer tracking while the analysis is pending.
+    struct Candidate
+    {
+        Candidate() : mHandle(0), mRepeatCount(0), mFramesUnused(0), mbSeen(false) {}
+        void reset() { mHandle = 0; mRepeatCount = 0; }
+
+        buffer_handle_t     mHandle;            // Tracked handle, 0 if the candidate is free.
+        uint32_t            mRepeatCount;       // Consecutive frames the handle has been seen.
+        uint32_t            mFramesUnused;      // Frames since the linear buffer was last used.
+        bool                mbSeen;             // Handle was seen this frame.
+        sp<DetectionJob>    mpDetectionJob;
+        sp<GraphicBuffer>   mpLinearBuffer;
+        sp<ScanBuffer>      mpScanBuffer;       // CPU mapping of mpLinearBuffer, retained across detections
+    };
+
+    // Could this layer benefit from being marked opaque.
+    static bool isCandidate( const Layer& layer );
+
+    // Reset the cached analysis of any buffer that was not presented last frame.
+    void invalidateNewContent( const Content& ref );
+
+    // Find the candidate tracking handle, allocating a free one if required. Returns NULL if none are available.
+    Candidate* findCandidate( buffer_handle_t handle );
+
+    // Start an analysis on the candidate for layer.
+    void initiateDetection( Candidate& candidate, const Layer& layer );
+
+    // Abandon any analysis in progress on the candidate.
+    void cancelDetection( Candidate& candidate );
+
+    AbstractBufferManager&  mBM;
+    Option                  mOptionOpaqueDetect;
+    ScanPool                mPool;
+
+    Candidate               mCandidates[cMaxCandidates];
+
+    // Sorted handles presented last frame and this frame.
+    std::vector<buffer_handle_t> mPresented;
+    std::vector<buffer_handle_t> mPresenting;
+
+    // Private reference to hold modified state
+    Content                 mReference;
+
+    // Helper struct to contain per display state
+    struct DisplayState
+    {
+        std::vector<Layer>      mLayers;        // Storage for layers marked opaque.
+        std::vector<uint8_t>    mOpaque;        // Per-layer decisions last frame.
+    };
+    DisplayState            mDisplayState[cMaxSupportedSFDisplays];
+    std::vector<uint8_t>    mOpaque;            // Scratch space.
+
+    // Statistics.
+    PixelScan::Stats        mScanStats;         // Accumulated scan statistics from completed detections
+    uint32_t                mDetections;        // Completed analyses.
+    uint32_t                mOpaqueDetections;  // Analyses that found opaque content.
+    uint32_t                mOpaqueLayers;      // Layers marked opaque last frame.
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_OPAQUEDETECTIONFILTER_H
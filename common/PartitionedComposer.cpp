@@ -16,6 +16,7 @@
 
 #include "Common.h"
 #include "PartitionedComposer.h"
+#include "HotPathStats.h"
 #include "Log.h"
 #include "Utils.h"
 
@@ -212,13 +213,16 @@ void PartitionedComposer::onCompose(const Content::LayerStack& source, const Lay
     }
 
     Vector<Partition> partitions;
+    {
+        HOTPATH_SCOPE(PARTITIONING);
 
-    // Initialise partition list to top of stack
-    const hwc_rect_t& r = target.getDst();
-    partitions.push_back(Partition(Rect(r.left, r.top, r.right, r.bottom)));
+        // Initialise partition list to top of stack
+        const hwc_rect_t& r = target.getDst();
+        partitions.push_back(Partition(Rect(r.left, r.top, r.right, r.bottom)));
 
-    // Generate the partitions from frontmost to backmost
-    intersect(source, source.size()-1, partitions, 0);
+        // Generate the partitions from frontmost to backmost
+        intersect(source, source.size()-1, partitions, 0);
+    }
 
     // Start the frame
     mpRenderer->beginFrame(source, target);
@@ -54,6 +54,7 @@ public:
     virtual const char* getName() const;
     virtual float onEvaluate(const Content::LayerStack& source, const Layer& target, AbstractComposer::CompositionState** ppState, Cost type = Power);
     virtual void onCompose(const Content::LayerStack& source, const Layer& target, AbstractComposer::CompositionState* pState);
+    virtual bool isConcurrentComposeSupported() const { return true; }
     virtual ResourceHandle onAcquire(const Content::LayerStack& source, const Layer& target);
     virtual void onRelease(ResourceHandle hResource);
 private:
@@ -16,6 +16,7 @@
 
 #include "Hwc.h"
 #include "PersistentRegistry.h"
+#include "ThreadManager.h"
 
 
 namespace intel {
@@ -403,6 +404,12 @@ void PersistentRegistry::waitDirty( void ) const
     }
 }
 
+status_t PersistentRegistry::AsyncWriter::readyToRun()
+{
+    ThreadManager::get().registerThread( ThreadManager::eThreadBackground, "PersistentRegistryWriter" );
+    return NO_ERROR;
+}
+
 bool PersistentRegistry::AsyncWriter::threadLoop()
 {
     // Wait for an update.
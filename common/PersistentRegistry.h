@@ -84,6 +84,7 @@ private:
     {
     public:
         AsyncWriter( PersistentRegistry* pRegistry ) : mpRegistry( pRegistry ) { }
+        virtual status_t readyToRun();
         virtual bool threadLoop();
     protected:
         PersistentRegistry* mpRegistry;
@@ -19,6 +19,7 @@
 #include "Log.h"
 #include "PlaneAllocatorJB.h"
 #include "AbstractPhysicalDisplay.h"
+#include "VSyncPhaseScheduler.h"
 
 
 #if INTEL_HWC_INTERNAL_BUILD
@@ -42,13 +43,21 @@ PhysicalDisplayManager::PhysicalDisplayManager( Hwc& hwc, CompositionManager& co
     mPhysicalDisplays( 0 ),
     mbRemapIndices( false ),
     mIdleTimeout(hwc),
-    mEnablePlaneAllocator("planealloc", 1, false)
+    mEnablePlaneAllocator("planealloc", 1, false),
+    mOptionKeepPlanes("keepplanes", 1),
+    mOptionParallelAllocation("parallelplanealloc", 1),
+    mAllocationPool("hwc_planealloc", cMaxSupportedPhysicalDisplays - 1, PRIORITY_URGENT_DISPLAY),
+    mKeptAllocations( 0 )
 {
     for ( uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; ++d )
     {
         mDisplayState[ d ].setIndex( d );
         mpPhysicalDisplay[ d ] = NULL;
     }
+    for ( uint32_t c = 0; c < GEOMETRY_COUNT; ++c )
+    {
+        maGeometryChanges[ c ] = 0;
+    }
 }
 
 PhysicalDisplayManager::~PhysicalDisplayManager()
@@ -109,19 +118,48 @@ AbstractPhysicalDisplay* PhysicalDisplayManager::getPhysicalDisplay( uint32_t ph
     return mpPhysicalDisplay[ phyIndex ];
 }
 
-int PhysicalDisplayManager::onPrepare(const Content& ref)
+PhysicalDisplayManager::AllocationJob::AllocationJob() :
+    mpDisplay( NULL ),
+    mpCaps( NULL ),
+    mGeometryChange( GEOMETRY_FULL ),
+    mbGeometryChange( false ),
+    mbSubmitted( false ),
+    mbFound( false ),
+    mDuration( 0 ),
+    mMaxDuration( 0 ),
+    mSearches( 0 ),
+    mConcurrentSearches( 0 )
 {
-    bool bIdleShouldReAnalyse = mIdleTimeout.shouldReAnalyse();
+}
+
+void PhysicalDisplayManager::AllocationJob::prepare( const Content::Display& display, const DisplayCaps& caps, bool bOptimizeIdleDisplay )
+{
+    mpDisplay = &display;
+    mpCaps = &caps;
+    mbFound = false;
+    mAllocator.setOptimizeIdleDisplay( bOptimizeIdleDisplay );
+}
+
+void PhysicalDisplayManager::AllocationJob::search()
+{
+    ALOG_ASSERT( mpDisplay && mpCaps );
+    ATRACE_NAME_IF( DISPLAY_TRACE, "PlaneAllocationSearch" );
+    const nsecs_t start = systemTime( SYSTEM_TIME_MONOTONIC );
+    mbFound = mAllocator.search( *mpDisplay, *mpCaps );
+    mDuration = systemTime( SYSTEM_TIME_MONOTONIC ) - start;
+    mMaxDuration = max( mMaxDuration, mDuration );
+    ++mSearches;
+}
+
+void PhysicalDisplayManager::startAllocations( const Content& ref, bool bIdleShouldReAnalyse )
+{
+    AllocationJob* apSearches[ cMaxSupportedPhysicalDisplays ];
+    uint32_t searches = 0;
 
     for (uint32_t d = 0; d < ref.size(); d++)
     {
         const Content::Display& display = ref.getDisplay(d);
-
-        // NOTE:
-        //  The LDM determines if we can assume SF display order here.
-        const int32_t sfIndex = getSFDisplayOrder() ? d : -1;
-        const uint32_t displayIndex = display.getDisplayManagerIndex();
-        const uint32_t phyIndex = remap( displayIndex );
+        const uint32_t phyIndex = remap( display.getDisplayManagerIndex() );
 
         AbstractPhysicalDisplay* pHwDisplay = getPhysicalDisplay( phyIndex );
         if ( pHwDisplay == NULL )
@@ -129,16 +167,12 @@ int PhysicalDisplayManager::onPrepare(const Content& ref)
             continue;
         }
 
-        DisplayState& state = mDisplayState[ pHwDisplay->getDisplayManagerIndex() ];
-
-        // Inform the composition manager of the currently active input buffers
-        // This enables it to invalidate any previous results
-        mCompositionManager.onAccept(display, d);
-
-        state.setFrameIndex( display.getFrameIndex( ) );
-        state.setFrameReceivedTime( display.getFrameReceivedTime( ) );
+        const uint32_t dmIndex = pHwDisplay->getDisplayManagerIndex();
+        DisplayState& state = mDisplayState[ dmIndex ];
+        AllocationJob& job = maAllocationJob[ dmIndex ];
 
         // Give the display the chance to adapt to the display format.
+        // This may change the caps so must be done before any search is started.
         pHwDisplay->updateOutputFormat( display.getFormat() );
 
         bool bGeomChange = display.isGeometryChanged();
@@ -165,69 +199,199 @@ int PhysicalDisplayManager::onPrepare(const Content& ref)
             }
         }
 
-        PlaneComposition &pc = state.getPlaneComposition();
-        if ( bGeomChange || bIdleShouldReAnalyse )
+        job.mbGeometryChange = bGeomChange || bIdleShouldReAnalyse;
+        if ( !job.mbGeometryChange )
         {
-            ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare Display D%d Geometry Changed", d);
-            ALOGD_IF(PHYDISP_DEBUG, "%s", display.dump().string());
-            ATRACE_NAME_IF(DISPLAY_TRACE, "PlaneAllocation");
+            continue;
+        }
 
-            // Indicate that we no longer require the resources from the previous composition
-            // This will also clear the output to disabled.
-            pc.onRelease();
+        // Classify the change to see if the previous plane assignment could be kept.
+        // Idle re-analysis and changes not reported by the content always need a full allocation.
+        job.mGeometryChange = GEOMETRY_FULL;
+        if ( display.isGeometryChanged() && !bIdleShouldReAnalyse )
+        {
+            job.mGeometryChange = maAllocation[ dmIndex ].classify( display );
+        }
 
-            // reinitialise the PlaneComposition record
-            pc.setCompositionManager(&mCompositionManager);
-            pc.setDisplayInput(&display);
+        // Displays that may keep their planes only search if the reassignment fails.
+        const bool bShowContent = display.isEnabled() && !display.isBlanked();
+        const bool bMayKeep = mOptionKeepPlanes && ( job.mGeometryChange <= GEOMETRY_SIZE );
+        if ( mEnablePlaneAllocator && bShowContent && !bMayKeep )
+        {
+            job.prepare( display, pHwDisplay->getDisplayCaps(), mIdleTimeout.frameIsIdle() );
+            apSearches[ searches++ ] = &job;
+        }
+    }
 
-            // Allocate planes/compositions if there is something to display.
-            if ( display.isEnabled() && !display.isBlanked() )
-            {
-                bool bOK;
+    // The first search is left to run on this thread when its display is reached.
+    if ( mOptionParallelAllocation && ( searches > 1 ) )
+    {
+        for ( uint32_t s = 1; s < searches; ++s )
+        {
+            apSearches[ s ]->mbSubmitted = true;
+            ++apSearches[ s ]->mConcurrentSearches;
+            mAllocationPool.submit( *apSearches[ s ] );
+        }
+    }
+}
 
-                if (mEnablePlaneAllocator)
-                {
-                    // This path allocates via Jason's algorithm
-                    PlaneAllocatorJB planeAllocator(mIdleTimeout.frameIsIdle());
-                    bOK = planeAllocator.analyze(display, pHwDisplay->getDisplayCaps(), pc);
-                }
-                else
-                {
-                    // This path always composes to a full screen layer
-                    bOK = pc.addFullScreenComposition(pHwDisplay->getDisplayCaps(), 0, 0, display.getNumLayers(), display.getFormat());
-                }
+int PhysicalDisplayManager::onPrepare(const Content& ref)
+{
+    bool bIdleShouldReAnalyse = mIdleTimeout.shouldReAnalyse();
 
-                // Indicate that we intend to commit these resources to a display now
-                if (bOK)
-                {
-                    bOK = pc.onAcquire();
-                    ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare PlaneAllocator returned:\n%s", pc.dump().string());
-                }
+    startAllocations( ref, bIdleShouldReAnalyse );
+
+    for (uint32_t d = 0; d < ref.size(); d++)
+    {
+        const Content::Display& display = ref.getDisplay(d);
+
+        // NOTE:
+        //  The LDM determines if we can assume SF display order here.
+        const int32_t sfIndex = getSFDisplayOrder() ? d : -1;
+        const uint32_t displayIndex = display.getDisplayManagerIndex();
+        const uint32_t phyIndex = remap( displayIndex );
+
+        AbstractPhysicalDisplay* pHwDisplay = getPhysicalDisplay( phyIndex );
+        if ( pHwDisplay == NULL )
+        {
+            continue;
+        }
+
+        DisplayState& state = mDisplayState[ pHwDisplay->getDisplayManagerIndex() ];
+        AllocationJob& job = maAllocationJob[ pHwDisplay->getDisplayManagerIndex() ];
+
+        // Inform the composition manager of the currently active input buffers
+        // This enables it to invalidate any previous results
+        mCompositionManager.onAccept(display, d);
+
+        state.setFrameIndex( display.getFrameIndex( ) );
+        state.setFrameReceivedTime( display.getFrameReceivedTime( ) );
 
-                if (!bOK)
+        PlaneComposition &pc = state.getPlaneComposition();
+        AllocationRecord& allocation = maAllocation[ pHwDisplay->getDisplayManagerIndex() ];
+        if ( job.mbGeometryChange )
+        {
+            ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare Display D%d Geometry Changed", d);
+            ALOGD_IF(PHYDISP_DEBUG, "%s", display.dump().string());
+
+            const EGeometryChange geometryChange = job.mGeometryChange;
+            ++maGeometryChanges[ geometryChange ];
+            ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare Display D%d Geometry change %s",
+                d, getGeometryChangeName( geometryChange ) );
+
+            const bool bShowContent = display.isEnabled() && !display.isBlanked();
+            bool bKept = false;
+            if ( mOptionKeepPlanes && mEnablePlaneAllocator && bShowContent && ( geometryChange <= GEOMETRY_SIZE ) )
+            {
+                ATRACE_NAME_IF(DISPLAY_TRACE, "PlaneReassignment");
+                const DisplayCaps& caps = pHwDisplay->getDisplayCaps();
+                if ( pc.reassign( caps, display ) )
                 {
-                    // Failed to acquire the resources for this composition.
-                    // Fall back to full surfaceflinger composition (if possible!)
-                    // TODO:
-                    //  SF fallback to be replaced.
-                    if ( sfIndex != -1 )
+                    if ( !pc.onAcquire() )
                     {
-                        ALOGD_IF( PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare  D:%d Display:%d RPD:%d (sf:%d) onAcquire() Failed, falling back to SF composition", d, displayIndex, phyIndex, sfIndex );
-                        ALOGE_IF( display.isFrontBufferRendered(), "SurfaceFlingerComposer fallback used with front buffer rendered content\n%s", display.dump().string() );
-                        pc.fallbackToSurfaceFlinger( sfIndex );
+                        // onAcquire has already released anything it acquired.
+                        pc.clear();
+                    }
+                    else if ( !caps.isSupported( pc.getDisplayOutput(), pc.getZOrder() ) )
+                    {
+                        pc.onRelease();
                     }
                     else
                     {
-                        ALOGW( "Can not fallback to SurfaceFlinger composition for remapped physical displays" );
+                        ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare Kept plane assignment:\n%s", pc.dump().string());
+                        bKept = true;
                     }
                 }
+            }
 
-                // Notify the idle logic that the display can benefit from the timeout.
-                // Only if 1) Multiple planes, 2) No planes are used for FBR.
+            if ( bKept )
+            {
+                ++mKeptAllocations;
+                allocation.set( display );
                 const Content::Display& outDisplay = pc.getDisplayOutput();
                 mIdleTimeout.setCanOptimize(d, ( outDisplay.getNumEnabledLayers() > 1 )
                                             && ( !outDisplay.isFrontBufferRendered() ) );
             }
+            else
+            {
+                ATRACE_NAME_IF(DISPLAY_TRACE, "PlaneAllocation");
+
+                // Only allocations from the plane allocator can be kept.
+                allocation.invalidate();
+
+                // Indicate that we no longer require the resources from the previous composition
+                // This will also clear the output to disabled.
+                pc.onRelease();
+
+                // reinitialise the PlaneComposition record
+                pc.setCompositionManager(&mCompositionManager);
+                pc.setDisplayInput(&display);
+
+                // Allocate planes/compositions if there is something to display.
+                if ( bShowContent )
+                {
+                    bool bOK;
+
+                    if (mEnablePlaneAllocator)
+                    {
+                        // This path allocates via Jason's algorithm
+                        if ( job.mbSubmitted )
+                        {
+                            mAllocationPool.wait( job );
+                            job.mbSubmitted = false;
+                        }
+                        else
+                        {
+                            job.prepare( display, pHwDisplay->getDisplayCaps(), mIdleTimeout.frameIsIdle() );
+                            job.search();
+                        }
+                        bOK = job.mbFound && job.mAllocator.apply( pc );
+                    }
+                    else
+                    {
+                        // This path always composes to a full screen layer
+                        bOK = pc.addFullScreenComposition(pHwDisplay->getDisplayCaps(), 0, 0, display.getNumLayers(), display.getFormat());
+                    }
+
+                    // Indicate that we intend to commit these resources to a display now
+                    if (bOK)
+                    {
+                        bOK = pc.onAcquire();
+                        ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare PlaneAllocator returned:\n%s", pc.dump().string());
+                    }
+
+                    if (bOK)
+                    {
+                        if (mEnablePlaneAllocator)
+                        {
+                            allocation.set( display );
+                        }
+                    }
+                    else
+                    {
+                        // Failed to acquire the resources for this composition.
+                        // Fall back to full surfaceflinger composition (if possible!)
+                        // TODO:
+                        //  SF fallback to be replaced.
+                        if ( sfIndex != -1 )
+                        {
+                            ALOGD_IF( PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare  D:%d Display:%d RPD:%d (sf:%d) onAcquire() Failed, falling back to SF composition", d, displayIndex, phyIndex, sfIndex );
+                            ALOGE_IF( display.isFrontBufferRendered(), "SurfaceFlingerComposer fallback used with front buffer rendered content\n%s", display.dump().string() );
+                            pc.fallbackToSurfaceFlinger( sfIndex );
+                        }
+                        else
+                        {
+                            ALOGW( "Can not fallback to SurfaceFlinger composition for remapped physical displays" );
+                        }
+                    }
+
+                    // Notify the idle logic that the display can benefit from the timeout.
+                    // Only if 1) Multiple planes, 2) No planes are used for FBR.
+                    const Content::Display& outDisplay = pc.getDisplayOutput();
+                    mIdleTimeout.setCanOptimize(d, ( outDisplay.getNumEnabledLayers() > 1 )
+                                                && ( !outDisplay.isFrontBufferRendered() ) );
+                }
+            }
         }
         else
         {
@@ -237,6 +401,16 @@ int PhysicalDisplayManager::onPrepare(const Content& ref)
         ALOGD_IF(PHYDISP_DEBUG, "PhysicalDisplayManager::onPrepare Display D%d Planes will display:\n%s", d, pc.dump().string());
     }
 
+    // Searches must not outlive the frame content (normally they have all been applied already).
+    for ( uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; ++d )
+    {
+        if ( maAllocationJob[ d ].mbSubmitted )
+        {
+            mAllocationPool.wait( maAllocationJob[ d ] );
+            maAllocationJob[ d ].mbSubmitted = false;
+        }
+    }
+
     // Re-set the idle timer for the next frame.
     mIdleTimeout.nextFrame();
 
@@ -245,6 +419,32 @@ int PhysicalDisplayManager::onPrepare(const Content& ref)
 
 int PhysicalDisplayManager::onSet(const Content& ref)
 {
+    // Start the compositions for all displays before any display is set, so that
+    // compositions for different displays can run concurrently on their composers.
+    mCompositionManager.beginConcurrentCompose();
+    for (uint32_t d = 0; d < ref.size(); d++)
+    {
+        const Content::Display& display = ref.getDisplay(d);
+        AbstractPhysicalDisplay* pHwDisplay = getPhysicalDisplay( remap( display.getDisplayManagerIndex() ) );
+
+        // NOTE:
+        //  A blanked display is still attached and must be processed,
+        //  Else a display with no layers is not attached/unused and should be skipped.
+        if ( pHwDisplay && ( display.getNumEnabledLayers() || display.isBlanked() ) )
+        {
+            DisplayState& state = mDisplayState[ pHwDisplay->getDisplayManagerIndex() ];
+
+            // Keep display state blank/unblank aligned with the display content.
+            bool bChange = false;
+            state.onBlank( display.isBlanked(), BLANK_CONTENT, bChange );
+
+            // Perform any compositions required prior to sending to display
+            mCompositionManager.setComposeDisplay( pHwDisplay->getDisplayManagerIndex() );
+            state.getPlaneComposition().onCompose();
+        }
+    }
+    mCompositionManager.endConcurrentCompose();
+
     for (uint32_t d = 0; d < ref.size(); d++)
     {
         ALOGD_IF(PHYDISP_DEBUG, " ---- DISPLAY D%d FRAME %03d ----", d, mHwc.getRedrawFrames());
@@ -257,25 +457,18 @@ int PhysicalDisplayManager::onSet(const Content& ref)
 
         AbstractPhysicalDisplay* pHwDisplay = getPhysicalDisplay( phyIndex );
 
-        // NOTE:
-        //  A blanked display is still attached and must be processed,
-        //  Else a display with no layers is not attached/unused and should be skipped.
         if ( pHwDisplay && ( display.getNumEnabledLayers() || display.isBlanked() ) )
         {
             DisplayState& state = mDisplayState[ pHwDisplay->getDisplayManagerIndex() ];
             Content::Display& current = state.getContent();
 
-            // Keep display state blank/unblank aligned with the display content.
-            bool bChange = false;
-            state.onBlank( display.isBlanked(), BLANK_CONTENT, bChange );
-
             ALOGD_IF( PHYDISP_DEBUG, "PhysicalDisplayManager::onSet Display D%d [%sx%u layers]. Physical display %p [%sx%u layers]",
                 d, display.isBlanked() ? "Blanked " : "", display.getNumEnabledLayers(),
                 pHwDisplay, current.isBlanked() ? "Blanked ": "", current.getNumEnabledLayers() );
 
-            // Perform any compositions required prior to sending to display
+            // Only this display's compositions need to be complete before it is set.
             PlaneComposition &pc = state.getPlaneComposition();
-            pc.onCompose();
+            pc.waitCompose();
 
             // Log the new physical display state
             const Content::Display& out = pc.getDisplayOutput();
@@ -341,7 +534,7 @@ int PhysicalDisplayManager::onSet(const Content& ref)
             current.editLayerStack() = stack;
 
             // Dump trace at end to capture final replicated release fence state.
-            Log::add( current, String8::format( "P%u %s", phyIndex, pHwDisplay->getName() ).string() );
+            Log::add( current, "P%u %s", phyIndex, pHwDisplay->getName() );
             ALOGD_IF(PHYDISP_DEBUG, "%s", out.dump(pHwDisplay->getName()).string());
 
 #if INTEL_HWC_INTERNAL_BUILD
@@ -351,9 +544,14 @@ int PhysicalDisplayManager::onSet(const Content& ref)
             }
 #endif
         }
+    }
 
-        // Close the input frame's acquire fences.
-        display.closeAcquireFences( );
+    // Compositions may source layers from other displays, so the input
+    // acquire fences are only closed once every composition is complete.
+    mCompositionManager.waitCompositions();
+    for (uint32_t d = 0; d < ref.size(); d++)
+    {
+        ref.getDisplay(d).closeAcquireFences( );
     }
 
     return 0;
@@ -406,9 +604,108 @@ String8 PhysicalDisplayManager::dump( void )
             str += "\n";
         str += String8::format( " P%u %s ", d,  mDisplayState[d].getHwDisplay()->dump().string() );
     }
+    str += "\n Geometry changes";
+    for ( uint32_t c = 0; c < GEOMETRY_COUNT; ++c )
+    {
+        str.appendFormat( " %s:%u", getGeometryChangeName( EGeometryChange( c ) ), maGeometryChanges[ c ] );
+    }
+    str.appendFormat( " Kept:%u", mKeptAllocations );
+    str += "\n Plane allocation";
+    for ( uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; ++d )
+    {
+        const AllocationJob& job = maAllocationJob[ d ];
+        if ( job.mSearches )
+        {
+            str.appendFormat( " P%u:[searches:%u concurrent:%u last:%" PRIi64 "us max:%" PRIi64 "us]",
+                              d, job.mSearches, job.mConcurrentSearches,
+                              job.mDuration / 1000, job.mMaxDuration / 1000 );
+        }
+    }
+    str += String8( " " ) + mAllocationPool.dump();
+    str += String8( "\n " ) + VSyncPhaseScheduler::get().dump();
     return str;
 }
 
+const char* PhysicalDisplayManager::getGeometryChangeName( EGeometryChange change )
+{
+    switch ( change )
+    {
+        case GEOMETRY_NONE:     return "None";
+        case GEOMETRY_POSITION: return "Position";
+        case GEOMETRY_SIZE:     return "Size";
+        case GEOMETRY_FORMAT:   return "Format";
+        case GEOMETRY_LAYERS:   return "Layers";
+        case GEOMETRY_ZORDER:   return "ZOrder";
+        case GEOMETRY_FULL:     return "Full";
+        case GEOMETRY_COUNT:    break;
+    }
+    return "<?>";
+}
+
+void PhysicalDisplayManager::AllocationRecord::set( const Content::Display& display )
+{
+    const Content::LayerStack& layers = display.getLayerStack();
+    mLayers.resize( layers.size() );
+    for ( uint32_t ly = 0; ly < layers.size(); ++ly )
+    {
+        const Layer& layer = layers.getLayer( ly );
+        LayerGeometry& geometry = mLayers[ ly ];
+        geometry.mSrcWidth = layer.getSrcWidth();
+        geometry.mSrcHeight = layer.getSrcHeight();
+        geometry.mDstWidth = layer.getDstWidth();
+        geometry.mDstHeight = layer.getDstHeight();
+        geometry.mFormat = layer.getBufferFormat();
+        geometry.mCompression = layer.getBufferCompression();
+        geometry.mbEncrypted = layer.isEncrypted();
+    }
+    mbValid = true;
+}
+
+PhysicalDisplayManager::EGeometryChange PhysicalDisplayManager::AllocationRecord::classify( const Content::Display& display ) const
+{
+    const uint32_t changes = display.getChanges();
+    if ( !mbValid || ( changes & ( Content::CHANGE_DISPLAY_MODE | Content::CHANGE_UNSPECIFIED ) ) )
+    {
+        return GEOMETRY_FULL;
+    }
+    if ( changes & Content::CHANGE_LAYER_MOVED )
+    {
+        return GEOMETRY_ZORDER;
+    }
+    const Content::LayerStack& layers = display.getLayerStack();
+    if ( ( changes & ( Content::CHANGE_LAYER_ADDED | Content::CHANGE_LAYERS_REMOVED ) )
+      || ( layers.size() != mLayers.size() ) )
+    {
+        return GEOMETRY_LAYERS;
+    }
+    if ( changes & Content::CHANGE_LAYER_STATE )
+    {
+        return GEOMETRY_FORMAT;
+    }
+
+    // New buffers and rects may still have changed the format or size of a layer.
+    EGeometryChange change = ( changes & Content::CHANGE_LAYER_RECTS ) ? GEOMETRY_POSITION : GEOMETRY_NONE;
+    for ( uint32_t ly = 0; ly < layers.size(); ++ly )
+    {
+        const Layer& layer = layers.getLayer( ly );
+        const LayerGeometry& geometry = mLayers[ ly ];
+        if ( ( geometry.mFormat != layer.getBufferFormat() )
+          || ( geometry.mCompression != layer.getBufferCompression() )
+          || ( geometry.mbEncrypted != layer.isEncrypted() ) )
+        {
+            return GEOMETRY_FORMAT;
+        }
+        if ( ( geometry.mSrcWidth != layer.getSrcWidth() )
+          || ( geometry.mSrcHeight != layer.getSrcHeight() )
+          || ( geometry.mDstWidth != layer.getDstWidth() )
+          || ( geometry.mDstHeight != layer.getDstHeight() ) )
+        {
+            change = GEOMETRY_SIZE;
+        }
+    }
+    return change;
+}
+
 String8 PhysicalDisplayManager::dumpDetail( void )
 {
     return dump( );
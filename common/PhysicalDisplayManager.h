@@ -19,10 +19,13 @@
 
 #include "AbstractDisplayManager.h"
 #include "AbstractPhysicalDisplay.h"
+#include "PlaneAllocatorJB.h"
 #include "PlaneComposition.h"
 #include "Timer.h"
 #include "Option.h"
+#include "WorkerPool.h"
 #include <utils/BitSet.h>
+#include <vector>
 
 namespace intel {
 namespace ufo {
@@ -109,6 +112,86 @@ public:
 
 
 private:
+    // Classification of a geometry change by how much it can affect the plane allocation.
+    // Changes up to GEOMETRY_SIZE can keep the previous assignment of planes to layers if
+    // it still passes a capability check, the rest require a full plane allocation.
+    enum EGeometryChange
+    {
+        GEOMETRY_NONE,              // The layers are unchanged (eg a geometry change propagated from another display).
+        GEOMETRY_POSITION,          // Layers moved or their visible regions changed.
+        GEOMETRY_SIZE,              // Layer source or destination sizes changed.
+        GEOMETRY_FORMAT,            // Layer format, compression, encryption, blending, transform or other state changed.
+        GEOMETRY_LAYERS,            // Layers were added or removed.
+        GEOMETRY_ZORDER,            // Layers were reordered.
+        GEOMETRY_FULL,              // Display mode change, unspecified change or no previous allocation.
+        GEOMETRY_COUNT
+    };
+
+    static const char* getGeometryChangeName( EGeometryChange change );
+
+    // Summary of the layers that the current plane allocation of a display was made for.
+    class AllocationRecord
+    {
+    public:
+        AllocationRecord() : mbValid( false ) { }
+
+        void            set( const Content::Display& display );
+        void            invalidate( void ) { mbValid = false; }
+
+        // Classify the change from the recorded layers to the display content.
+        EGeometryChange classify( const Content::Display& display ) const;
+
+    private:
+        struct LayerGeometry
+        {
+            float               mSrcWidth;
+            float               mSrcHeight;
+            uint32_t            mDstWidth;
+            uint32_t            mDstHeight;
+            uint32_t            mFormat;
+            ECompressionType    mCompression;
+            bool                mbEncrypted;
+        };
+        std::vector<LayerGeometry>  mLayers;
+        bool                        mbValid;
+    };
+
+    // The plane allocation for one display in a frame.
+    // The search runs on the allocation pool when more than one display needs a new allocation
+    // in the same frame (displays share no planes); the result is always applied in display order.
+    class AllocationJob : public WorkerPool::Job
+    {
+    public:
+        AllocationJob();
+
+        // Set up a search of display on caps.
+        void prepare( const Content::Display& display, const DisplayCaps& caps, bool bOptimizeIdleDisplay );
+
+        // Run the prepared search on the calling thread.
+        void search();
+
+        PlaneAllocatorJB            mAllocator;
+        const Content::Display*     mpDisplay;
+        const DisplayCaps*          mpCaps;
+        EGeometryChange             mGeometryChange;        //< Classification of this frame's change.
+        bool                        mbGeometryChange:1;     //< The display needs a new plane assignment this frame.
+        bool                        mbSubmitted:1;          //< Submitted to the pool, waiting to be applied.
+        bool                        mbFound:1;              //< The search found a solution.
+
+        // Statistics.
+        nsecs_t                     mDuration;              //< Duration of the last search.
+        nsecs_t                     mMaxDuration;
+        uint32_t                    mSearches;
+        uint32_t                    mConcurrentSearches;    //< Searches submitted to the pool.
+
+    protected:
+        virtual void onRun() { search(); }
+    };
+
+    // Classify the geometry change for each display and submit the plane allocation searches
+    // that are certain to be needed to the allocation pool.
+    void startAllocations( const Content& ref, bool bIdleShouldReAnalyse );
+
     Hwc&                                    mHwc;
     CompositionManager&                     mCompositionManager;
     PhysicalDisplayNotificationReceiver*    mpDisplayNotificationReceiver;
@@ -271,6 +354,15 @@ private:
     IdleTimeout mIdleTimeout;
 
     Option      mEnablePlaneAllocator;
+    Option      mOptionKeepPlanes;                                      //< Keep plane assignments across minor geometry changes.
+    Option      mOptionParallelAllocation;                              //< Search for plane allocations on multiple displays concurrently.
+
+    WorkerPool                  mAllocationPool;
+    AllocationJob               maAllocationJob[ cMaxSupportedPhysicalDisplays ];
+
+    AllocationRecord            maAllocation[ cMaxSupportedPhysicalDisplays ];          //< Layers each allocation was made for.
+    uint32_t                    maGeometryChanges[ GEOMETRY_COUNT ];                    //< Count of geometry changes by class.
+    uint32_t                    mKeptAllocations;                                       //< Count of allocations kept across geometry changes.
 };
 
 }; // namespace hwc
@@ -0,0 +1,209 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "PixelScan.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+#define PIXELSCAN_DEBUG 0
+
+static inline bool pixelMatches( uint32_t px, uint32_t color1, uint32_t color2, uint32_t mask )
+{
+    px &= mask;
+    return ( px == color1 ) || ( px == color2 );
+}
+
+const char* PixelScan::getImplementationName( void )
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+bool PixelScan::checkRow( uint32_t color1, uint32_t color2, uint32_t mask,
+                          const uint32_t* pRow, uint32_t x1, uint32_t x2 )
+{
+    uint32_t x = x1;
+
+#if defined(__AVX2__)
+    const __m256i vC1 = _mm256_set1_epi32( color1 );
+    const __m256i vC2 = _mm256_set1_epi32( color2 );
+    const __m256i vMask = _mm256_set1_epi32( mask );
+    // Two vectors per iteration; the compare results are and'ed so there is only one branch.
+    for ( ; x + 16 <= x2; x += 16 )
+    {
+        const __m256i a = _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)( pRow + x ) ), vMask );
+        const __m256i b = _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)( pRow + x + 8 ) ), vMask );
+        const __m256i ma = _mm256_or_si256( _mm256_cmpeq_epi32( a, vC1 ), _mm256_cmpeq_epi32( a, vC2 ) );
+        const __m256i mb = _mm256_or_si256( _mm256_cmpeq_epi32( b, vC1 ), _mm256_cmpeq_epi32( b, vC2 ) );
+        if ( _mm256_movemask_epi8( _mm256_and_si256( ma, mb ) ) != -1 )
+        {
+            return false;
+        }
+    }
+    for ( ; x + 8 <= x2; x += 8 )
+    {
+        const __m256i a = _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)( pRow + x ) ), vMask );
+        const __m256i ma = _mm256_or_si256( _mm256_cmpeq_epi32( a, vC1 ), _mm256_cmpeq_epi32( a, vC2 ) );
+        if ( _mm256_movemask_epi8( ma ) != -1 )
+        {
+            return false;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i vC1 = _mm_set1_epi32( color1 );
+    const __m128i vC2 = _mm_set1_epi32( color2 );
+    const __m128i vMask = _mm_set1_epi32( mask );
+    // Two vectors per iteration; the compare results are and'ed so there is only one branch.
+    for ( ; x + 8 <= x2; x += 8 )
+    {
+        const __m128i a = _mm_and_si128( _mm_loadu_si128( (const __m128i*)( pRow + x ) ), vMask );
+        const __m128i b = _mm_and_si128( _mm_loadu_si128( (const __m128i*)( pRow + x + 4 ) ), vMask );
+        const __m128i ma = _mm_or_si128( _mm_cmpeq_epi32( a, vC1 ), _mm_cmpeq_epi32( a, vC2 ) );
+        const __m128i mb = _mm_or_si128( _mm_cmpeq_epi32( b, vC1 ), _mm_cmpeq_epi32( b, vC2 ) );
+        if ( _mm_movemask_epi8( _mm_and_si128( ma, mb ) ) != 0xFFFF )
+        {
+            return false;
+        }
+    }
+#endif
+
+    // Scalar tail (or the whole row if no vector implementation is available).
+    for ( ; x < x2; ++x )
+    {
+        if ( !pixelMatches( pRow[x], color1, color2, mask ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PixelScan::checkSamples( uint32_t color1, uint32_t color2, uint32_t mask,
+                              const uint32_t* pBuffer, uint32_t strideInPixels,
+                              uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                              uint64_t& pixelsRead )
+{
+    const uint32_t w = x2 - x1;
+    uint32_t phase = 0;
+    for ( uint32_t y = y1; y < y2; y += cSampleStrideY )
+    {
+        const uint32_t* pRow = pBuffer + (size_t)y * strideInPixels;
+        // Offset the start of each sampled row so successive rows probe different columns.
+        for ( uint32_t x = x1 + ( phase % w ); x < x2; x += cSampleStrideX )
+        {
+            ++pixelsRead;
+            if ( !pixelMatches( pRow[x], color1, color2, mask ) )
+            {
+                ALOGD_IF( PIXELSCAN_DEBUG, "PixelScan: sample mismatch at %u,%u", x, y );
+                return false;
+            }
+        }
+        phase += cSampleStrideX / 3;
+    }
+    return true;
+}
+
+bool PixelScan::checkRegion( uint32_t color1, uint32_t color2, uint32_t mask,
+                             const uint32_t* pBuffer, uint32_t strideInPixels,
+                             uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                             Stats* pStats )
+{
+    ATRACE_CALL_IF(DISPLAY_TRACE);
+
+    // Colors outside the mask can never match.
+    color1 &= mask;
+    color2 &= mask;
+
+    if ( pStats )
+    {
+        ++pStats->mScans;
+    }
+
+    if ( ( x1 >= x2 ) || ( y1 >= y2 ) )
+    {
+        if ( pStats )
+        {
+            ++pStats->mMatches;
+        }
+        return true;
+    }
+
+    uint64_t pixelsRead = 0;
+
+    // Coarse pass.
+    if ( (uint64_t)( x2 - x1 ) * ( y2 - y1 ) >= cMinPixelsForSampling )
+    {
+        if ( !checkSamples( color1, color2, mask, pBuffer, strideInPixels, x1, y1, x2, y2, pixelsRead ) )
+        {
+            if ( pStats )
+            {
+                ++pStats->mSampleRejects;
+                pStats->mPixelsRead += pixelsRead;
+            }
+            return false;
+        }
+    }
+
+    // Full verification.
+    const uint32_t* pRow = pBuffer + (size_t)y1 * strideInPixels;
+    for ( uint32_t y = y1; y < y2; ++y )
+    {
+        pixelsRead += ( x2 - x1 );
+        if ( !checkRow( color1, color2, mask, pRow, x1, x2 ) )
+        {
+            ALOGD_IF( PIXELSCAN_DEBUG, "PixelScan: checkRegion %u, %u, %u, %u Failed on row %u", x1, y1, x2, y2, y );
+            if ( pStats )
+            {
+                ++pStats->mFullRejects;
+                pStats->mPixelsRead += pixelsRead;
+            }
+            return false;
+        }
+        pRow += strideInPixels;
+    }
+
+    if ( pStats )
+    {
+        ++pStats->mMatches;
+        pStats->mPixelsRead += pixelsRead;
+    }
+    return true;
+}
+
+String8 PixelScan::dumpStats( const Stats& stats )
+{
+    return String8::format( "Scan[%s]:%" PRIu64 " SampleReject:%" PRIu64 " FullReject:%" PRIu64 " Match:%" PRIu64 " Px:%" PRIu64,
+                            getImplementationName(),
+                            stats.mScans, stats.mSampleRejects, stats.mFullRejects, stats.mMatches, stats.mPixelsRead );
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,109 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_PIXELSCAN_H
+#define INTEL_UFO_HWC_PIXELSCAN_H
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// CPU scanning helpers for 32bit per pixel linear buffers.
+//
+// A pixel px "matches" if ( px & mask ) equals either color1 or color2.
+// Pass color1 == color2 to test for a single color and mask 0xFFFFFFFF to compare all channels.
+//
+// Regions are specified in pixels as [x1,x2) x [y1,y2) relative to pBuffer.
+// Empty or inverted regions trivially match.
+//
+// The scan first runs a coarse pass over a sparse set of strided samples so that the common
+// case (a region that does not match) is rejected after touching only a small fraction of
+// the buffer. Only if every sample matches is the full region verified.
+// The full verification is vectorized (AVX2 or SSE2, depending on the build target) with
+// a portable scalar fallback.
+class PixelScan
+{
+public:
+    struct Stats
+    {
+        Stats() : mScans(0), mSampleRejects(0), mFullRejects(0), mMatches(0), mPixelsRead(0) {}
+        void add( const Stats& other )
+        {
+            mScans         += other.mScans;
+            mSampleRejects += other.mSampleRejects;
+            mFullRejects   += other.mFullRejects;
+            mMatches       += other.mMatches;
+            mPixelsRead    += other.mPixelsRead;
+        }
+        uint64_t    mScans;             // Number of region scans.
+        uint64_t    mSampleRejects;     // Scans rejected by the coarse sampling pass.
+        uint64_t    mFullRejects;       // Scans rejected during full verification.
+        uint64_t    mMatches;           // Scans where the whole region matched.
+        uint64_t    mPixelsRead;        // Total pixels read (approximate).
+    };
+
+    // Returns true if every pixel in the region matches color1 or color2 under mask.
+    static bool checkRegion( uint32_t color1, uint32_t color2, uint32_t mask,
+                             const uint32_t* pBuffer, uint32_t strideInPixels,
+                             uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                             Stats* pStats = NULL );
+
+    // Returns true if every pixel in the region is exactly color.
+    static bool checkRegion( uint32_t color,
+                             const uint32_t* pBuffer, uint32_t strideInPixels,
+                             uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                             Stats* pStats = NULL )
+    {
+        return checkRegion( color, color, 0xFFFFFFFF, pBuffer, strideInPixels, x1, y1, x2, y2, pStats );
+    }
+
+    // Returns true if every pixel in the region is exactly color1 or color2.
+    static bool checkRegion( uint32_t color1, uint32_t color2,
+                             const uint32_t* pBuffer, uint32_t strideInPixels,
+                             uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                             Stats* pStats = NULL )
+    {
+        return checkRegion( color1, color2, 0xFFFFFFFF, pBuffer, strideInPixels, x1, y1, x2, y2, pStats );
+    }
+
+    // Name of the vector implementation compiled in (for dumpsys).
+    static const char* getImplementationName( void );
+
+    static String8 dumpStats( const Stats& stats );
+
+private:
+    // Horizontal distance between samples in the coarse pass.
+    // Prime so that samples do not alias with power-of-two periodic content.
+    static const uint32_t cSampleStrideX = 61;
+    // Vertical distance between sampled rows in the coarse pass.
+    static const uint32_t cSampleStrideY = 7;
+    // Regions smaller than this (in pixels) skip the coarse pass.
+    static const uint32_t cMinPixelsForSampling = 4096;
+
+    static bool checkSamples( uint32_t color1, uint32_t color2, uint32_t mask,
+                              const uint32_t* pBuffer, uint32_t strideInPixels,
+                              uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                              uint64_t& pixelsRead );
+
+    static bool checkRow( uint32_t color1, uint32_t color2, uint32_t mask,
+                          const uint32_t* pRow, uint32_t x1, uint32_t x2 );
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_PIXELSCAN_H
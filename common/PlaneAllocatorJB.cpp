@@ -15,6 +15,8 @@
 */
 
 #include "Hwc.h"
+#include "FrameArena.h"
+#include "HotPathStats.h"
 #include "Option.h"
 #include "PlaneAllocatorJB.h"
 #include "Utils.h"
@@ -90,6 +92,20 @@ public:
     static const int64_t MIN_SCORE      = -0xFFFFFFFFFFFFLL;
     static const int64_t MAX_SCORE      = +0xFFFFFFFFFFFFLL;
 
+    // Score for composing a layer whose producer is flagged as late.
+    // This outweighs the best score any single layer can earn on a plane (pass through plus
+    // front/back weighting), so moving a late layer onto a plane is always worth more than
+    // moving any other layer. Unlike MIN_SCORE it still lets the layer be composed once the
+    // planes run out.
+    static const int64_t LATE_PRODUCER_SCORE = -16;
+
+    // Bonus for presenting the video layer of a display with a stable video cadence (see
+    // Content::Display::isVideoCadence) on a plane without pre-processing.
+    // This outweighs the best score any other layer can earn on a plane, so the video gets a
+    // pass through plane whenever one can take it and each video frame reaches the display
+    // without a GPU or VPP pass.
+    static const int64_t VIDEO_CADENCE_SCORE = 16;
+
 
     // Dummy composition (we don't expect this to be called into).
     class ProposedComposition : public AbstractComposition
@@ -156,6 +172,7 @@ public:
             mZOrder( 0 ),
             mCompositions( 0 )
         {
+            maZOrderStr[ 0 ] = '\0';
         }
 
         // Destructor.
@@ -197,7 +214,7 @@ public:
             {
                 str += String8::format( "P%u ", pl ) + maPlanes[ pl ].dump() + String8( "\n" );
             }
-            str += String8::format( " (ZOrder %u/%s)", mZOrder, mZOrderStr.string() );
+            str += String8::format( " (ZOrder %u/%s)", mZOrder, maZOrderStr );
             return str;
         }
 
@@ -207,7 +224,8 @@ public:
         Plane*          maPlanes;
         // Display ZOrder.
         uint32_t        mZOrder;
-        String8         mZOrderStr;
+        // Kept inline as this is written for every candidate solution during the search.
+        char            maZOrderStr[ MAX_PLANES+1 ];
         // Number of compositions required.
         uint32_t        mCompositions;
     };
@@ -286,14 +304,16 @@ public:
     };
 
     // Default constructor.
-    PlaneAllocator( const Content::Display& display, const DisplayCaps& caps ) :
-        mDisplayInput( display ),
-        mDisplayCaps( caps ),
+    PlaneAllocator( ) :
+        mpDisplayInput( NULL ),
+        mpDisplayCaps( NULL ),
         mNumPlanes( 0 ),
         mNumLayers( 0 ),
         maLayerConfig( NULL),
+        mMaxLayerConfigs( 0 ),
         mMaxHandledSets( MAX_PLANES ),
-        mMaxUnhandledSets( MAX_PLANES )
+        mMaxUnhandledSets( MAX_PLANES ),
+        mpOptimalSolution( NULL )
     {
     }
 
@@ -303,11 +323,12 @@ public:
         delete [] maLayerConfig;
     }
 
-    // Initialize.
-    // This allocates layers/planes.
+    // Initialize for a display and its caps, which must remain valid until the next init.
+    // This allocates layers/planes. The layer configs are reused across calls and only
+    // reallocated when the display has more layers than any previous search.
     // By default all planes are enabled and maximum unhandled sets is bound only by number of planes.
     // Returns true if successful.
-    bool init( uint32_t enabledPlanes = 0, uint32_t maxUnhandledSets = 0 );
+    bool init( const Content::Display& display, const DisplayCaps& caps, uint32_t enabledPlanes = 0, uint32_t maxUnhandledSets = 0 );
 
     // Returns number initialized planes.
     uint32_t getNumPlanes( void ) const { return mNumPlanes; }
@@ -326,6 +347,11 @@ public:
     // On success, returns a pointer to the best solution.
     const Solution* findOptimalSolution( void );
 
+    // The result of the last findOptimalSolution (NULL if it failed).
+    const Solution* getOptimalSolution( void ) const { return mpOptimalSolution; }
+
+    const DisplayCaps& getDisplayCaps( void ) const { ALOG_ASSERT( mpDisplayCaps ); return *mpDisplayCaps; }
+
 private:
 
     // CachedOptions class describes options passed to the isLayerSupportedOnPlane() method.
@@ -353,9 +379,9 @@ private:
         uint32_t  mPermittedPreProcessCSCMask;
     };
 
-    // References to display content and display caps.
-    const Content::Display& mDisplayInput;
-    const DisplayCaps& mDisplayCaps;
+    // Display content and display caps (set by init).
+    const Content::Display* mpDisplayInput;
+    const DisplayCaps* mpDisplayCaps;
 
     // Cached plane caps info.
     CachedPlaneCaps maCachedPlaneCaps[MAX_PLANES];
@@ -369,6 +395,9 @@ private:
     // Layer config.
     LayerConfig* maLayerConfig;
 
+    // Number of layer configs allocated.
+    uint32_t mMaxLayerConfigs;
+
     // The maximum number of contiguous handled sets.
     // If planes are totatally independent then we are effectively unlimited for handled sets.
     // Setting zero here will disable all plane usage (except for the main plane).
@@ -382,6 +411,7 @@ private:
 
     // Internal solutions.
     Solution mSolution[2];
+    const Solution* mpOptimalSolution;
 
     // For displays requiring complex validation.
     Content::Display mDisplayOutput;
@@ -457,34 +487,49 @@ private:
     };
 }; // PlaneAllocator
 
-bool PlaneAllocator::init( uint32_t enabledPlanes, uint32_t maxUnhandledSets )
+bool PlaneAllocator::init( const Content::Display& display, const DisplayCaps& caps, uint32_t enabledPlanes, uint32_t maxUnhandledSets )
 {
+    mpDisplayInput = &display;
+    mpDisplayCaps = &caps;
+    mpOptimalSolution = NULL;
     if ( enabledPlanes )
     {
-        ALOG_ASSERT( enabledPlanes <= mDisplayCaps.getNumPlanes() );
+        ALOG_ASSERT( enabledPlanes <= mpDisplayCaps->getNumPlanes() );
         mNumPlanes = enabledPlanes;
     }
     else
     {
-        mNumPlanes = mDisplayCaps.getNumPlanes();
+        mNumPlanes = mpDisplayCaps->getNumPlanes();
     }
     mMaxHandledSets = mNumPlanes;
     mMaxUnhandledSets = maxUnhandledSets ? maxUnhandledSets : mNumPlanes;
-    const uint32_t numLayers = mDisplayInput.getNumLayers();
-    delete [] maLayerConfig;
+    const uint32_t numLayers = mpDisplayInput->getNumLayers();
     mNumLayers = 0;
-    maLayerConfig = new LayerConfig[ numLayers ];
-    if ( maLayerConfig == NULL )
+    if ( numLayers > mMaxLayerConfigs )
     {
-        return false;
+        delete [] maLayerConfig;
+        mMaxLayerConfigs = 0;
+        maLayerConfig = new LayerConfig[ numLayers ];
+        if ( maLayerConfig == NULL )
+        {
+            return false;
+        }
+        mMaxLayerConfigs = numLayers;
+    }
+    else
+    {
+        for ( uint32_t ly = 0; ly < numLayers; ++ly )
+        {
+            maLayerConfig[ ly ] = LayerConfig( );
+        }
     }
     mNumLayers = numLayers;
     // Cache some plane caps.
     for ( uint32_t pl = 0; pl < mNumPlanes; ++pl )
     {
         // ZOrders.
-        maCachedPlaneCaps[ pl ].mSupportedZOrderPreMask = mDisplayCaps.getZOrderPreMask(pl);
-        maCachedPlaneCaps[ pl ].mSupportedZOrderPostMask = mDisplayCaps.getZOrderPostMask(pl);
+        maCachedPlaneCaps[ pl ].mSupportedZOrderPreMask = mpDisplayCaps->getZOrderPreMask(pl);
+        maCachedPlaneCaps[ pl ].mSupportedZOrderPostMask = mpDisplayCaps->getZOrderPostMask(pl);
         maCachedPlaneCaps[ pl ].mFlags = 0;
         // For now, we can assume that any sprite planes have at least the same level of capability
         // as the main plane. If this changes for any future chips, we will need to adjust this. However,
@@ -492,14 +537,14 @@ bool PlaneAllocator::init( uint32_t enabledPlanes, uint32_t maxUnhandledSets )
         maCachedPlaneCaps[ pl ].mFlags |= PlaneAllocator::CachedPlaneCaps::FLAG_CAP_COLLAPSE;
         // If upper layers end up collapsed and presented over lower layers then blending is required.
         // Let the allocator know whether this plane supports opaque/blended collapsed layer-sets.
-        if ( mDisplayCaps.isBlendingSupported( pl ) )
+        if ( mpDisplayCaps->isBlendingSupported( pl ) )
             maCachedPlaneCaps[ pl ].mFlags |= PlaneAllocator::CachedPlaneCaps::FLAG_CAP_BLEND;
         // Can the plane be disabled?
         // If not, then we flag it as required.
-        if ( !mDisplayCaps.isDisableSupported( pl ) )
+        if ( !mpDisplayCaps->isDisableSupported( pl ) )
             maCachedPlaneCaps[ pl ].mFlags |= PlaneAllocator::CachedPlaneCaps::FLAG_HINT_REQUIRED;
         // Can the plane present protected content?
-        if ( mDisplayCaps.isDecryptSupported( pl ) )
+        if ( mpDisplayCaps->isDecryptSupported( pl ) )
             maCachedPlaneCaps[ pl ].mFlags |= PlaneAllocator::CachedPlaneCaps::FLAG_CAP_DECRYPT;
     }
     return true;
@@ -509,8 +554,8 @@ bool PlaneAllocator::isLayerSupportedOnPlane(uint32_t pl, const Layer& layer, co
 {
 
     // Display size.
-    const uint32_t displayWidth = mDisplayInput.getWidth();
-    const uint32_t displayHeight = mDisplayInput.getHeight();
+    const uint32_t displayWidth = mpDisplayInput->getWidth();
+    const uint32_t displayHeight = mpDisplayInput->getHeight();
 
     // Initial refusal checks. These are absolute, they cannot be resolved by preprocessing.
     bConsiderPreProcess = false;
@@ -601,7 +646,7 @@ bool PlaneAllocator::isLayerSupportedOnPlane(uint32_t pl, const Layer& layer, co
         bConsiderPreProcess = true;
         return false;
     }
-    else if ( mDisplayCaps.areDeviceNativeBuffersRequired() && !layer.isComposition() && !layer.isBufferDeviceIdValid() )
+    else if ( mpDisplayCaps->areDeviceNativeBuffersRequired() && !layer.isComposition() && !layer.isBufferDeviceIdValid() )
     {
         ALOGD_IF( PLANEALLOC_CAPS_DEBUG, "%s %s : No [device id is invalid]",
             planeCaps.getName(), layer.dump().string() );
@@ -636,7 +681,7 @@ bool PlaneAllocator::isLayerSupportedOnPlane(uint32_t pl, const Layer& layer, co
 bool PlaneAllocator::isLayerSupportedOnPlane( uint32_t ly, uint32_t pl, const CachedOptions& options, Eval& eval )
 {
     // Display input layers.
-    const Content::LayerStack layers = mDisplayInput.getLayerStack();
+    const Content::LayerStack layers = mpDisplayInput->getLayerStack();
     const Layer& layer = layers[ ly ];
 
 
@@ -645,7 +690,7 @@ bool PlaneAllocator::isLayerSupportedOnPlane( uint32_t ly, uint32_t pl, const Ca
     ALOG_ASSERT(formatCSCClass < DisplayCaps::CSC_CLASS_MAX);
 
     // Caps for this plane.
-    const DisplayCaps::PlaneCaps& planeCaps = mDisplayCaps.getPlaneCaps( pl );
+    const DisplayCaps::PlaneCaps& planeCaps = mpDisplayCaps->getPlaneCaps( pl );
 
     bool bConsiderPreProcess = false;
 
@@ -667,11 +712,15 @@ bool PlaneAllocator::isLayerSupportedOnPlane( uint32_t ly, uint32_t pl, const Ca
     uint32_t levelWeighting = 0;
     if ( ly == 0 )
             levelWeighting = +1;
-    else if ( ly == ( mDisplayInput.getNumLayers() - 1) )
+    else if ( ly == ( mpDisplayInput->getNumLayers() - 1) )
             levelWeighting = +1;
 
     // Default the score assuming we can support this layer without needing pre-processing.
     eval.mScore = passThruScore + levelWeighting;
+    if ( mpDisplayInput->isVideoCadence() && layer.isVideo() )
+    {
+        eval.mScore += VIDEO_CADENCE_SCORE;
+    }
 
     bool bOK = isLayerSupportedOnPlane(pl, layer, planeCaps, options, formatCSCClass, bConsiderPreProcess);
 
@@ -691,18 +740,18 @@ bool PlaneAllocator::isLayerSupportedOnPlane( uint32_t ly, uint32_t pl, const Ca
             ppLayer.setComposition( &eval.mComposition );
 
             // Establish pre-process composition target.
-            DisplayCaps::ECSCClass formatClass = mDisplayCaps.halFormatToCSCClass( layer.getBufferFormat(), bOpaque );
+            DisplayCaps::ECSCClass formatClass = mpDisplayCaps->halFormatToCSCClass( layer.getBufferFormat(), bOpaque );
             hwc_frect_t src = { 0, 0, (float)layer.getDstWidth(), (float)layer.getDstHeight() };
             hwc_rect_t dst = layer.getDst();
             ppLayer.setSrc( src );
             ppLayer.setDst( dst );
-            ppLayer.setBufferFormat( mDisplayCaps.getPlaneCaps( pl ).getCSCFormat( formatClass ) );
+            ppLayer.setBufferFormat( mpDisplayCaps->getPlaneCaps( pl ).getCSCFormat( formatClass ) );
             ppLayer.onUpdateFlags();
 
             // Validate that this layer is actually supported on the plane
             CachedOptions options( true, true, false );
             options.mPermittedPreProcessCSCMask = 0;
-            bOK = isLayerSupportedOnPlane(pl, ppLayer, mDisplayCaps.getPlaneCaps( pl ), options, formatClass, bConsiderPreProcess);
+            bOK = isLayerSupportedOnPlane(pl, ppLayer, mpDisplayCaps->getPlaneCaps( pl ), options, formatClass, bConsiderPreProcess);
             if (bOK)
             {
                 // We can handle this layer but only via pre-processing.
@@ -743,7 +792,7 @@ bool PlaneAllocator::isLayerSupportedOnPlane( uint32_t ly, uint32_t pl, const Ca
 
 void PlaneAllocator::preEvaluate( PlaneAllocatorJB::Options* pOptions, bool bOptimizeIdleDisplay )
 {
-    const Content::LayerStack inputStack = mDisplayInput.getLayerStack();
+    const Content::LayerStack inputStack = mpDisplayInput->getLayerStack();
     ALOG_ASSERT( mNumLayers == inputStack.size() );
     // TODO:
     //   Add more "smarts" here when setting scores.
@@ -798,6 +847,14 @@ void PlaneAllocator::preEvaluate( PlaneAllocatorJB::Options* pOptions, bool bOpt
             unhandledEval.mScore = PlaneAllocator::MIN_SCORE;
             unhandledEval.mbValid = true;
         }
+        else if ( layer.isLateProducer() )
+        {
+            // Prefer a dedicated plane for layers whose buffers are regularly not ready at set.
+            // A late layer in the composition holds up the whole frame while the plane only
+            // holds up itself.
+            unhandledEval.mScore = PlaneAllocator::LATE_PRODUCER_SCORE;
+            unhandledEval.mbValid = true;
+        }
         else
         {
             // Don't really want collapse/composition (favour plane).
@@ -841,6 +898,8 @@ void PlaneAllocator::preEvaluate( PlaneAllocatorJB::Options* pOptions, bool bOpt
 
 const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
 {
+    HOTPATH_SCOPE( PLANE_ALLOCATION );
+
     // We use uint32_t bit fields to track assigment - this limits us to no more than 32 planes.
     ALOG_ASSERT(MAX_PLANES <= 32);
 
@@ -865,8 +924,8 @@ const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
     // Log inputs/pre-evaluation.
     if ( PLANEALLOC_SUMMARY_DEBUG || PLANEALLOC_OPT_DEBUG )
     {
-        const Content::LayerStack& inputStack = mDisplayInput.getLayerStack();
-        ALOGD( "PlaneAllocator::optimizeSolution %s\n--INPUT--", mDisplayCaps.getName() );
+        const Content::LayerStack& inputStack = mpDisplayInput->getLayerStack();
+        ALOGD( "PlaneAllocator::optimizeSolution %s\n--INPUT--", mpDisplayCaps->getName() );
         // Dump evaluation status.
         for ( uint32_t ly = 0; ly < mNumLayers; ++ly )
         {
@@ -942,7 +1001,8 @@ const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
     uint32_t handledSets = 0;   //< Count of handled sets.
     uint32_t unhandledSets = 0; //< Count of unhandled sets.
 
-    Scratch *scratch = new Scratch[ mNumLayers ];
+    // Scratch is only needed for the duration of this call so take it from the frame arena.
+    Scratch *scratch = FrameArena::get().allocateArray<Scratch>( mNumLayers );
     if( !scratch )
     {
         ALOGE("Failed to allocate memory for scratch!!!");
@@ -1371,19 +1431,19 @@ const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
                                 layer.setComposition( &plane.mComposition );
 
                                 // Establish collapsed composition target
-                                DisplayCaps::ECSCClass formatClass = mDisplayCaps.halFormatToCSCClass( mDisplayInput.getFormat(), bOpaque );
-                                hwc_frect_t src = { 0, 0, (float)mDisplayInput.getWidth(), (float)mDisplayInput.getHeight() };
-                                hwc_rect_t dst = { 0, 0, (int32_t)mDisplayInput.getWidth(), (int32_t)mDisplayInput.getHeight() };
+                                DisplayCaps::ECSCClass formatClass = mpDisplayCaps->halFormatToCSCClass( mpDisplayInput->getFormat(), bOpaque );
+                                hwc_frect_t src = { 0, 0, (float)mpDisplayInput->getWidth(), (float)mpDisplayInput->getHeight() };
+                                hwc_rect_t dst = { 0, 0, (int32_t)mpDisplayInput->getWidth(), (int32_t)mpDisplayInput->getHeight() };
                                 layer.setSrc( src );
                                 layer.setDst( dst );
-                                layer.setBufferFormat( mDisplayCaps.getPlaneCaps( pl ).getCSCFormat( formatClass ) );
+                                layer.setBufferFormat( mpDisplayCaps->getPlaneCaps( pl ).getCSCFormat( formatClass ) );
                                 layer.onUpdateFlags();
 
                                 // Validate that this layer is actually supported on the plane
                                 CachedOptions options( true, true, false );
                                 options.mPermittedPreProcessCSCMask = 0;
                                 bool bConsiderPreProcess = false;
-                                bPlanesValid = isLayerSupportedOnPlane(pl, layer, mDisplayCaps.getPlaneCaps( pl ), options, formatClass, bConsiderPreProcess);
+                                bPlanesValid = isLayerSupportedOnPlane(pl, layer, mpDisplayCaps->getPlaneCaps( pl ), options, formatClass, bConsiderPreProcess);
                                 if (!bPlanesValid)
                                 {
                                     ALOGD_IF( PLANEALLOC_CAPS_DEBUG, "%s No [Collapsed target invalid] ", layer.dump().string());
@@ -1394,7 +1454,8 @@ const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
                         if (bPlanesValid)
                         {
                             // Find best ZOrder given caps.
-                            solution.mZOrderStr = zOrderStr;
+                            ALOG_ASSERT( mNumPlanes <= MAX_PLANES );
+                            memcpy( solution.maZOrderStr, zOrderStr, mNumPlanes+1 );
                             solution.mZOrder = findBestZOrder( zOrderStr );
 
                             ALOGD_IF( PLANEALLOC_OPT_DEBUG, "Proposed solution:\n%s", solution.dump().string() );
@@ -1448,22 +1509,21 @@ const PlaneAllocator::Solution* PlaneAllocator::findOptimalSolution( void )
     ALOGD_IF( PLANEALLOC_OPT_DEBUG, "Done [permutations:%u valid solution:%u score %" PRIi64"].",
         permutations, bValidSolution, bestScore );
 
-    delete[] scratch;
     if ( bValidSolution )
     {
         ALOGD_IF( PLANEALLOC_SUMMARY_DEBUG,
             "PlaneAllocator::optimizeSolution %s Success\n--SOLUTION--\n%s",
-            mDisplayCaps.getName(), mSolution[ solutionIndex ].dump().string() );
-        return &mSolution[ solutionIndex ];
+            mpDisplayCaps->getName(), mSolution[ solutionIndex ].dump().string() );
+        mpOptimalSolution = &mSolution[ solutionIndex ];
     }
-    return NULL;
+    return mpOptimalSolution;
 }
 
 uint32_t PlaneAllocator::findBestZOrder( const char *pchZOrderStr )
 {
     // Get ZOrder LUT.
-    const DisplayCaps::ZOrderLUTEntry* pZOrderLUT = mDisplayCaps.getZOrderLUT( );
-    const uint32_t numZOrders = mDisplayCaps.getNumZOrders( );
+    const DisplayCaps::ZOrderLUTEntry* pZOrderLUT = mpDisplayCaps->getZOrderLUT( );
+    const uint32_t numZOrders = mpDisplayCaps->getNumZOrders( );
 
     if ( ( pZOrderLUT == NULL ) || !numZOrders )
     {
@@ -1559,17 +1619,17 @@ uint32_t PlaneAllocator::findBestZOrder( const char *pchZOrderStr )
 
 bool PlaneAllocator::validateSolution( const Solution& solution )
 {
-    if ( !mDisplayCaps.hasComplexConstraints() )
+    if ( !mpDisplayCaps->hasComplexConstraints() )
     {
         // Nothing more to validate.
         return true;
     }
 
     // Update generic state.
-    mDisplayOutput.updateDisplayState( mDisplayInput );
+    mDisplayOutput.updateDisplayState( *mpDisplayInput );
 
     // Access stack.
-    const Content::LayerStack& inputStack = mDisplayInput.getLayerStack();
+    const Content::LayerStack& inputStack = mpDisplayInput->getLayerStack();
 
     // And generate output stack.
     Content::LayerStack& outputStack = mDisplayOutput.editLayerStack();
@@ -1601,13 +1661,14 @@ bool PlaneAllocator::validateSolution( const Solution& solution )
     outputStack.updateLayerFlags();
 
     // Make final check against the caps.
-    bool bIsSupported = mDisplayCaps.isSupported( mDisplayOutput, solution.mZOrder );
+    bool bIsSupported = mpDisplayCaps->isSupported( mDisplayOutput, solution.mZOrder );
 
     ALOGD_IF( PLANEALLOC_OPT_DEBUG, "validateSolution isSupported? : %d : %s", bIsSupported, mDisplayOutput.dump().string());
     return bIsSupported;
 }
 
 PlaneAllocatorJB::PlaneAllocatorJB( bool bOptimizeIdleDisplay ) :
+    mpAllocator( NULL ),
     mbOptimizeIdleDisplay( bOptimizeIdleDisplay )
 {
     // Lazy allocation lookup of composition options on first access of the allocator.
@@ -1619,20 +1680,36 @@ PlaneAllocatorJB::PlaneAllocatorJB( bool bOptimizeIdleDisplay ) :
 
 PlaneAllocatorJB::~PlaneAllocatorJB()
 {
+    delete mpAllocator;
 }
 
 bool PlaneAllocatorJB::analyze( const Content::Display& display, const DisplayCaps& caps, PlaneComposition& composition )
+{
+    return search( display, caps ) && apply( composition );
+}
+
+bool PlaneAllocatorJB::search( const Content::Display& display, const DisplayCaps& caps )
 {
     ALOGD_IF( PLANEALLOC_SUMMARY_DEBUG || PLANEALLOC_CAPS_DEBUG,
             "PlaneAllocator analyze %s : x%u layers into x%u planes ******************",
             caps.getName(), display.getNumLayers(), caps.getNumPlanes() );
 
-    PlaneAllocator allocator( display, caps );
+    // The allocator is kept across searches so its layer configs are not reallocated every frame.
+    if ( mpAllocator == NULL )
+    {
+        mpAllocator = new PlaneAllocator;
+        if ( mpAllocator == NULL )
+        {
+            ALOGE( "Failed to create allocator" );
+            return false;
+        }
+    }
+    PlaneAllocator& allocator = *mpAllocator;
 
     // Enable all planes unless overlays are disabled.
     // Limit unhandled sets to 2 (this is the maximum number of collapsed sets of layers).
     uint32_t enabledPlanes = ( spOptions->mOverlay == 0 ) ? 1 : 0;
-    if ( !allocator.init( enabledPlanes, 2 ) )
+    if ( !allocator.init( display, caps, enabledPlanes, 2 ) )
     {
         ALOGE( "Failed to initialize allocator input space" );
         return false;
@@ -1642,12 +1719,22 @@ bool PlaneAllocatorJB::analyze( const Content::Display& display, const DisplayCa
     allocator.preEvaluate( spOptions, mbOptimizeIdleDisplay );
 
     // Run optimizer
-    const PlaneAllocator::Solution* pSolution = allocator.findOptimalSolution( );
-    if ( pSolution == NULL )
+    if ( allocator.findOptimalSolution( ) == NULL )
     {
         ALOGE( "PlaneAllocator::optimizeSolution %s Failed\n%s", caps.getName(), display.getLayerStack().dump().string() );
         return false;
     }
+    return true;
+}
+
+bool PlaneAllocatorJB::apply( PlaneComposition& composition )
+{
+    const PlaneAllocator::Solution* pSolution = mpAllocator ? mpAllocator->getOptimalSolution( ) : NULL;
+    if ( pSolution == NULL )
+    {
+        return false;
+    }
+    const DisplayCaps& caps = mpAllocator->getDisplayCaps( );
 
     // Process solution.
     for ( uint32_t pl = 0; pl < pSolution->mNumPlanes; ++pl )
@@ -25,6 +25,9 @@ namespace intel {
 namespace ufo {
 namespace hwc {
 
+class PlaneAllocator;
+class PlaneComposition;
+
 // This is a class for managing (detecting and invoking)
 // the overlay capabilities supported by the Drm driver.
 class PlaneAllocatorJB : NonCopyable
@@ -47,8 +50,20 @@ public:
     // Returns true if succesful.
     bool analyze( const Content::Display& display, const DisplayCaps& caps, PlaneComposition& out );
 
+    // analyze() split into its two steps.
+    // search() finds the best use of the planes. It makes no requests of the composition manager,
+    // so searches for different displays (using different allocators) can run concurrently.
+    // The display and caps must remain valid until apply() has been called.
+    // apply() then builds the composition from the result of the last search on the calling thread.
+    // Each returns true if succesful.
+    bool search( const Content::Display& display, const DisplayCaps& caps );
+    bool apply( PlaneComposition& out );
+
+    void setOptimizeIdleDisplay( bool bOptimizeIdleDisplay ) { mbOptimizeIdleDisplay = bOptimizeIdleDisplay; }
+
 private:
     static Options* spOptions;
+    PlaneAllocator* mpAllocator;            // Allocator reused by each search.
     bool mbOptimizeIdleDisplay : 1;
 };
 
@@ -110,12 +110,6 @@ void PlaneComposition::onCompose()
         if (state.mpComposition)
         {
             state.mpComposition->onCompose();
-            if (state.mbIsPreprocessed)
-            {
-                // This is preprocessed layer. Update the destination frame state to reflect the composition results
-                state.mLayerPPDst.onUpdateFrameState(state.mpComposition->getTarget());
-                ALOGD_IF(COMPOSITION_DEBUG, "PlaneComposition::onCompose Preprocessed Dest Layer %i: %s", i, state.mLayerPPDst.dump().string());
-            }
         }
     }
 
@@ -126,6 +120,25 @@ void PlaneComposition::onCompose()
     return;
 }
 
+void PlaneComposition::waitCompose()
+{
+    for (uint32_t i = 0; i < MAX_PLANES; i++)
+    {
+        PlaneState& state = mPlaneState[i];
+        if (state.mpComposition)
+        {
+            state.mpComposition->waitCompose();
+            if (state.mbIsPreprocessed)
+            {
+                // This is preprocessed layer. Update the destination frame state to reflect the composition results.
+                // The composer may update the target (e.g. its acquire fence) until the composition is complete.
+                state.mLayerPPDst.onUpdateFrameState(state.mpComposition->getTarget());
+                ALOGD_IF(COMPOSITION_DEBUG, "PlaneComposition::waitCompose Preprocessed Dest Layer %i: %s", i, state.mLayerPPDst.dump().string());
+            }
+        }
+    }
+}
+
 bool PlaneComposition::onAcquire()
 {
     ALOGD_IF(COMPOSITION_DEBUG, "PlaneComposition::onAcquire zorder:%d", mZOrder);
@@ -237,6 +250,7 @@ bool PlaneComposition::addFullScreenComposition(const DisplayCaps& caps, uint32_
     ALOG_ASSERT(state.mStartIndex < 0); // Should never initialise a layer twice
 
     state.mStartIndex = srcLayerIndex;
+    state.mColorFormat = colorFormat;
     state.mLayers.resize(numLayers);
     state.mbIsPreprocessed = false;
     Content::LayerStack inputLayers = mpDisplayInput->getLayerStack();
@@ -279,6 +293,7 @@ bool PlaneComposition::addSourcePreprocess(const DisplayCaps& caps, uint32_t ove
 
     Content::LayerStack inputLayers = mpDisplayInput->getLayerStack();
     state.mStartIndex = srcLayerIndex;
+    state.mColorFormat = colorFormat;
     state.mLayerPPSrc = inputLayers.getLayer(srcLayerIndex);
     state.mbIsPreprocessed = true;
 
@@ -341,6 +356,74 @@ bool PlaneComposition::addDedicatedLayer(uint32_t overlayIndex, uint32_t srcLaye
     return true;
 }
 
+bool PlaneComposition::reassign(const DisplayCaps& caps, const Content::Display& display)
+{
+    // Take a copy of the current assignment before it is released.
+    struct Assignment
+    {
+        int32_t     mStartIndex;
+        uint32_t    mNumLayers;
+        int32_t     mColorFormat;
+        bool        mbComposition;
+        bool        mbIsPreprocessed;
+    };
+    Assignment assignment[MAX_PLANES];
+    for (uint32_t i = 0; i < MAX_PLANES; i++)
+    {
+        const PlaneState& state = mPlaneState[i];
+        assignment[i].mStartIndex = state.mStartIndex;
+        assignment[i].mNumLayers = state.mLayers.size();
+        assignment[i].mColorFormat = state.mColorFormat;
+        assignment[i].mbComposition = (state.mpComposition != NULL);
+        assignment[i].mbIsPreprocessed = state.mbIsPreprocessed;
+    }
+    const uint32_t zOrder = mZOrder;
+
+    onRelease();
+    setDisplayInput(&display);
+
+    const Content::LayerStack& layers = display.getLayerStack();
+    for (uint32_t i = 0; i < MAX_PLANES; i++)
+    {
+        const Assignment& plane = assignment[i];
+        if (plane.mStartIndex < 0)
+        {
+            continue;
+        }
+
+        bool bOK;
+        const uint32_t numLayers = plane.mbComposition && !plane.mbIsPreprocessed ? plane.mNumLayers : 1;
+        if ((numLayers == 0) || (plane.mStartIndex + numLayers > layers.size()))
+        {
+            bOK = false;
+        }
+        else if (!plane.mbComposition)
+        {
+            // A dedicated plane must still be able to present its layer directly.
+            bOK = caps.getPlaneCaps(i).isSupported(layers.getLayer(plane.mStartIndex))
+               && addDedicatedLayer(i, plane.mStartIndex);
+        }
+        else if (plane.mbIsPreprocessed)
+        {
+            bOK = addSourcePreprocess(caps, i, plane.mStartIndex, plane.mColorFormat);
+        }
+        else
+        {
+            bOK = addFullScreenComposition(caps, i, plane.mStartIndex, numLayers, plane.mColorFormat);
+        }
+
+        if (!bOK)
+        {
+            ALOGD_IF(COMPOSITION_DEBUG, "PlaneComposition::reassign Failed for plane %u", i);
+            onRelease();
+            return false;
+        }
+    }
+
+    setZOrder(zOrder);
+    return true;
+}
+
 void PlaneComposition::fallbackToSurfaceFlinger(uint32_t display)
 {
     Log::alogd( COMPOSITION_DEBUG, "D%d fallbackToSurfaceFlinger!", display );
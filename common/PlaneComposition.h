@@ -52,6 +52,7 @@ public:
     void            onUpdate(const Content::Display& src);
     void            onUpdateOutputLayer(const Layer& target);
     void            onCompose();
+    void            waitCompose();
     bool            onAcquire();
     void            onRelease();
     uint32_t        onLock( void ) { return 0; }
@@ -65,6 +66,11 @@ public:
     bool            addSourcePreprocess(const DisplayCaps& caps, uint32_t overlayIndex, uint32_t srcLayerIndex, int32_t colorFormat);
     bool            addDedicatedLayer(uint32_t overlayIndex, uint32_t srcLayerIndex);
 
+    // Release the current compositions and set up the same assignment of planes to input layers
+    // for new display content with the same layer structure. Dedicated layers are checked against
+    // the plane caps. Returns false (with the composition cleared) if the assignment can not be kept.
+    bool            reassign(const DisplayCaps& caps, const Content::Display& display);
+
     uint32_t        getZOrder() const                   { return mZOrder; }
     void            setZOrder(uint32_t zOrder)          { mZOrder = zOrder; }
 
@@ -87,12 +93,14 @@ private:
     public:
         PlaneState() :
             mStartIndex(-1),
+            mColorFormat(0),
             mpComposition(NULL),
             mbIsPreprocessed(false)
         {
         }
 
         int32_t                 mStartIndex;
+        int32_t                 mColorFormat;       // Format of the composition target (if any).
         Content::LayerStack     mLayers;
         AbstractComposition*    mpComposition;
         Layer                   mLayerPPSrc;
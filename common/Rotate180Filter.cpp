@@ -32,6 +32,7 @@ public:
 
     const char* getName() const { return "Rotate180Filter"; }
     const Content& onApply(const Content& ref);
+    bool getDependencySignature( uint64_t& signature ) const { signature = mOptionRotate180.get(); return true; }
     String8 dump();
 private:
     Option              mOptionRotate180;
@@ -73,9 +74,7 @@ const Content& Rotate180Filter::onApply(const Content& ref)
             mLayers[d].resize(layerStack.size());
             for (uint32_t ly = 0; ly < layerStack.size(); ++ly)
             {
-                Layer& layer = mLayers[d][ly];
-                const Layer& src = layerStack.getLayer(ly);
-                layer = src;
+                Layer& layer = layerStack.editLayer(ly, mLayers[d]);
 
                 // As the transform is a bitfield, we can simply invert some bits to rotate the bitmap by 180
                 uint32_t t = uint32_t(layer.getTransform());
@@ -89,9 +88,6 @@ const Content& Rotate180Filter::onApply(const Content& ref)
                 r.top = display.getHeight() - layer.getDst().bottom;
                 r.bottom = display.getHeight() - layer.getDst().top;
                 layer.editDst() = r;
-
-                // Update the layerstack with our pointer
-                layerStack.setLayer(ly, &layer);
             }
         }
     }
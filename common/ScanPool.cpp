@@ -0,0 +1,199 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "ScanPool.h"
+#include "ThreadManager.h"
+#include <ui/GraphicBufferMapper.h>
+#include <ui/Rect.h>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+#define SCANPOOL_DEBUG 0
+
+ScanBuffer::ScanBuffer(sp<GraphicBuffer> pBuffer) :
+    mpBuffer(pBuffer),
+    mpPixels(NULL)
+{
+}
+
+ScanBuffer::~ScanBuffer()
+{
+    if (mpPixels)
+    {
+        ALOGD_IF(SCANPOOL_DEBUG, "ScanBuffer: Unmap linear buffer %p", mpBuffer->handle);
+        GraphicBufferMapper::get().unlock(mpBuffer->handle);
+    }
+}
+
+uint32_t* ScanBuffer::map()
+{
+    Mutex::Autolock _l(mLock);
+    if (mpPixels == NULL)
+    {
+        void* pvBuffer = NULL;
+        status_t r = GraphicBufferMapper::get().lock(mpBuffer->handle, GRALLOC_USAGE_SW_READ_OFTEN,
+                                                     Rect(0, 0, mpBuffer->getWidth(), mpBuffer->getHeight()), &pvBuffer);
+        if (r != OK)
+        {
+            ALOGD_IF(SCANPOOL_DEBUG, "ScanBuffer: Failed to lock surface");
+            return NULL;
+        }
+        ALOGD_IF(SCANPOOL_DEBUG, "ScanBuffer: Mapped linear buffer %p", mpBuffer->handle);
+        mpPixels = (uint32_t*)pvBuffer;
+    }
+    return mpPixels;
+}
+
+ScanPool::ScanPool(const char* pchName, uint32_t maxQueuedJobs) :
+    mpchName(pchName),
+    mMaxQueuedJobs(maxQueuedJobs),
+    mbStarted(false),
+    mbExit(false),
+    mSubmitted(0),
+    mRejected(0),
+    mCancelled(0),
+    mCompleted(0)
+{
+    mQueue.reserve(mMaxQueuedJobs);
+}
+
+ScanPool::~ScanPool()
+{
+    {
+        Mutex::Autolock _l(mLock);
+        mbExit = true;
+        for (const sp<ScanJob>& pJob : mQueue)
+        {
+            pJob->cancel();
+        }
+        mQueue.clear();
+        mWork.broadcast();
+    }
+    for (uint32_t w = 0; w < cWorkers; w++)
+    {
+        if (mpWorkers[w] != NULL)
+        {
+            mpWorkers[w]->requestExitAndWait();
+            mpWorkers[w] = NULL;
+        }
+    }
+}
+
+void ScanPool::start()
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    if (mbStarted)
+        return;
+    for (uint32_t w = 0; w < cWorkers; w++)
+    {
+        mpWorkers[w] = new Worker(*this);
+        mpWorkers[w]->run(String8::format("%s_thread%u", mpchName, w).string(), PRIORITY_BACKGROUND);
+    }
+    mbStarted = true;
+}
+
+bool ScanPool::submit(const sp<ScanJob>& pJob)
+{
+    Mutex::Autolock _l(mLock);
+    if (mQueue.size() >= mMaxQueuedJobs)
+    {
+        ALOGD_IF(SCANPOOL_DEBUG, "ScanPool %s: Queue full", mpchName);
+        ++mRejected;
+        return false;
+    }
+    start();
+    mQueue.push_back(pJob);
+    ++mSubmitted;
+    mWork.signal();
+    return true;
+}
+
+bool ScanPool::isFull()
+{
+    Mutex::Autolock _l(mLock);
+    return mQueue.size() >= mMaxQueuedJobs;
+}
+
+void ScanPool::cancel(const sp<ScanJob>& pJob)
+{
+    Mutex::Autolock _l(mLock);
+    pJob->cancel();
+    // Only jobs that never started count as cancelled; running or finished jobs complete normally.
+    for (uint32_t j = 0; j < mQueue.size(); j++)
+    {
+        if (mQueue[j] == pJob)
+        {
+            mQueue.erase(mQueue.begin() + j);
+            ++mCancelled;
+            break;
+        }
+    }
+}
+
+sp<ScanJob> ScanPool::waitJob()
+{
+    Mutex::Autolock _l(mLock);
+    while (mQueue.empty() && !mbExit)
+    {
+        mWork.wait(mLock);
+    }
+    if (mbExit)
+        return NULL;
+
+    // Highest priority first.
+    uint32_t best = 0;
+    for (uint32_t j = 1; j < mQueue.size(); j++)
+    {
+        if (mQueue[j]->getPriority() > mQueue[best]->getPriority())
+            best = j;
+    }
+    sp<ScanJob> pJob = mQueue[best];
+    mQueue.erase(mQueue.begin() + best);
+    return pJob;
+}
+
+status_t ScanPool::Worker::readyToRun()
+{
+    ThreadManager::get().registerThread(ThreadManager::eThreadDetection);
+    return NO_ERROR;
+}
+
+bool ScanPool::Worker::threadLoop()
+{
+    sp<ScanJob> pJob = mPool.waitJob();
+    if (pJob == NULL)
+        return false;
+
+    pJob->execute();
+
+    Mutex::Autolock _l(mPool.mLock);
+    ++mPool.mCompleted;
+    return true;
+}
+
+String8 ScanPool::dump()
+{
+    Mutex::Autolock _l(mLock);
+    return String8::format("Pool:%u Queued:%zu Submitted:%u Rejected:%u Cancelled:%u Completed:%u",
+                           mbStarted ? cWorkers : 0, mQueue.size(), mSubmitted, mRejected, mCancelled, mCompleted);
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,145 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_SCANPOOL_H
+#define INTEL_UFO_HWC_SCANPOOL_H
+
+#include <ui/GraphicBuffer.h>
+#include <utils/Thread.h>
+#include <atomic>
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// Background CPU analysis of buffer contents.
+// Filters copy a layer into a private linear buffer (ScanBuffer) and hand a ScanJob to a
+// ScanPool, then poll the job on later frames.
+
+// A linear buffer together with its CPU mapping.
+// The buffer is normally private to a filter and reused for every scan, so the mapping is
+// retained across frames rather than locking/unlocking gralloc for every check.
+// The mapping is released when the last reference to the buffer is dropped.
+class ScanBuffer : public RefBase
+{
+public:
+    ScanBuffer(sp<GraphicBuffer> pBuffer);
+    virtual ~ScanBuffer();
+
+    const sp<GraphicBuffer>& getBuffer() const      { return mpBuffer; }
+
+    // Map the buffer on first use. Returns NULL if the buffer can not be mapped.
+    uint32_t* map();
+
+private:
+    Mutex               mLock;
+    sp<GraphicBuffer>   mpBuffer;
+    uint32_t*           mpPixels;
+};
+
+// A single scan request. Jobs are executed by a ScanPool worker.
+class ScanJob : public RefBase
+{
+public:
+    ScanJob() : mPriority(0), mbCancelled(false), mbFinished(false) { }
+    virtual ~ScanJob() { }
+
+    bool isFinished() const                         { return mbFinished; }
+    bool isCancelled() const                        { return mbCancelled; }
+
+    // Jobs with the largest priority are executed first.
+    uint64_t getPriority() const                    { return mPriority; }
+
+    // Request the job is abandoned. A job that is already running should stop at the next opportunity.
+    void cancel()                                   { mbCancelled = true; }
+
+    // Perform the job. Called from a worker thread.
+    void execute()                                  { onRun(); mbFinished = true; }
+
+protected:
+    // Implemented by the job. Should check isCancelled() between expensive steps.
+    virtual void onRun() = 0;
+
+    uint64_t            mPriority;
+
+private:
+    std::atomic<bool>   mbCancelled;
+    std::atomic<bool>   mbFinished;
+};
+
+// Fixed size pool of low priority workers.
+// The workers are started on first use.
+class ScanPool
+{
+public:
+    ScanPool(const char* pchName, uint32_t maxQueuedJobs);
+    ~ScanPool();
+
+    // Queue a job. Returns false if the queue is full.
+    bool submit(const sp<ScanJob>& pJob);
+
+    // Cancel a job. If the job has not yet started it is removed from the queue.
+    void cancel(const sp<ScanJob>& pJob);
+
+    // Returns true if submit would fail.
+    bool isFull();
+
+    String8 dump();
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(ScanPool& pool) : mPool(pool) { }
+    private:
+        virtual status_t readyToRun();
+        virtual bool threadLoop();
+        ScanPool& mPool;
+    };
+
+    // Start the workers on first use.
+    // Lock must be held.
+    void start();
+
+    // Block until a job is available. Returns NULL if the pool is stopping.
+    sp<ScanJob> waitJob();
+
+    // Number of workers in the pool.
+    static const uint32_t           cWorkers = 2;
+
+    const char*                     mpchName;
+    const uint32_t                  mMaxQueuedJobs;     // Maximum number of jobs waiting for a worker.
+
+    Mutex                           mLock;
+    Condition                       mWork;
+    std::vector< sp<ScanJob> >      mQueue;
+    sp<Worker>                      mpWorkers[cWorkers];
+    bool                            mbStarted:1;
+    bool                            mbExit:1;
+
+    // Statistics.
+    uint32_t                        mSubmitted;
+    uint32_t                        mRejected;
+    uint32_t                        mCancelled;
+    uint32_t                        mCompleted;
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_SCANPOOL_H
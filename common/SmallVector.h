@@ -0,0 +1,188 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_SMALLVECTOR_H
+#define INTEL_UFO_HWC_SMALLVECTOR_H
+
+#include <new>
+#include <string.h>
+#include <type_traits>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class is a vector of plain data that keeps up to N elements inline, only falling back
+// to the heap when it grows beyond that. It is intended for small lists embedded in objects
+// that are copied often (e.g. layer visible regions) where the common case is a single element.
+// The elements must be trivially copyable but the vector itself is not: copies are deep,
+// duplicating any heap spill, and the heap storage is released on destruction.
+// The interface follows the subset of android::Vector used for those lists.
+template <class T, uint32_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only supports trivially copyable types");
+    static_assert(N > 0, "SmallVector must have inline storage");
+
+public:
+    SmallVector() :
+        mpItems(mInline),
+        mSize(0),
+        mCapacity(N)
+    {
+    }
+
+    SmallVector(const SmallVector& other) :
+        mpItems(mInline),
+        mSize(0),
+        mCapacity(N)
+    {
+        *this = other;
+    }
+
+    ~SmallVector()
+    {
+        if (mpItems != mInline)
+        {
+            delete [] mpItems;
+        }
+    }
+
+    SmallVector& operator=(const SmallVector& other)
+    {
+        if (this != &other)
+        {
+            mSize = 0;
+            if (reserve(other.mSize))
+            {
+                memcpy(mpItems, other.mpItems, other.mSize * sizeof(T));
+                mSize = other.mSize;
+            }
+        }
+        return *this;
+    }
+
+    uint32_t size() const                       { return mSize; }
+    bool isEmpty() const                        { return mSize == 0; }
+    uint32_t capacity() const                   { return mCapacity; }
+
+    // True if the elements are held in the inline storage.
+    bool isInline() const                       { return mpItems == mInline; }
+
+    const T* array() const                      { return mpItems; }
+    T* editArray()                              { return mpItems; }
+
+    const T& operator[](uint32_t index) const   { ALOG_ASSERT(index < mSize); return mpItems[index]; }
+    T& operator[](uint32_t index)               { ALOG_ASSERT(index < mSize); return mpItems[index]; }
+    const T& itemAt(uint32_t index) const       { return (*this)[index]; }
+    T& editItemAt(uint32_t index)               { return (*this)[index]; }
+
+    const T* begin() const                      { return mpItems; }
+    const T* end() const                        { return mpItems + mSize; }
+    T* begin()                                  { return mpItems; }
+    T* end()                                    { return mpItems + mSize; }
+
+    // Empty the list. Any heap storage is retained for reuse.
+    void clear()
+    {
+        mSize = 0;
+    }
+
+    // Make room for at least capacity elements, preserving the contents.
+    // Returns false if the allocation fails.
+    bool reserve(uint32_t capacity)
+    {
+        if (capacity <= mCapacity)
+        {
+            return true;
+        }
+        T* pItems = new(std::nothrow) T[capacity];
+        if (pItems == NULL)
+        {
+            ALOGE("SmallVector: Failed to allocate %u elements", capacity);
+            return false;
+        }
+        memcpy(pItems, mpItems, mSize * sizeof(T));
+        if (mpItems != mInline)
+        {
+            delete [] mpItems;
+        }
+        mpItems = pItems;
+        mCapacity = capacity;
+        return true;
+    }
+
+    // Resize the list. Note, new elements have stale contents.
+    // Returns the new size (which is unchanged if the allocation fails).
+    uint32_t resize(uint32_t size)
+    {
+        if (reserve(size))
+        {
+            mSize = size;
+        }
+        return mSize;
+    }
+
+    // Append an element. Returns its index or -1 on failure.
+    int32_t add(const T& item)
+    {
+        if ((mSize == mCapacity) && !reserve(mCapacity * 2))
+        {
+            return -1;
+        }
+        mpItems[mSize] = item;
+        return mSize++;
+    }
+
+    void push_back(const T& item)
+    {
+        add(item);
+    }
+
+    // Insert count elements from pItems at index. Returns index or -1 on failure.
+    int32_t insertArrayAt(const T* pItems, uint32_t index, uint32_t count)
+    {
+        ALOG_ASSERT(index <= mSize);
+        if (!reserve(mSize + count))
+        {
+            return -1;
+        }
+        memmove(mpItems + index + count, mpItems + index, (mSize - index) * sizeof(T));
+        memcpy(mpItems + index, pItems, count * sizeof(T));
+        mSize += count;
+        return index;
+    }
+
+    // Remove the element at index, preserving the order of the rest.
+    void removeAt(uint32_t index)
+    {
+        ALOG_ASSERT(index < mSize);
+        memmove(mpItems + index, mpItems + index + 1, (mSize - index - 1) * sizeof(T));
+        mSize--;
+    }
+
+private:
+    T*          mpItems;        // Points to mInline or to heap storage.
+    uint32_t    mSize;
+    uint32_t    mCapacity;
+    T           mInline[N];
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_SMALLVECTOR_H
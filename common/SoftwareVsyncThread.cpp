@@ -16,6 +16,7 @@
 
 #include "Hwc.h"
 #include "SoftwareVsyncThread.h"
+#include "ThreadManager.h"
 
 // Kernel sleep function - for some reason this isnt exported from bionic even
 // though its implemented there. Used by standard Hwcomposer::SoftwareVsyncThread impl.
@@ -82,6 +83,11 @@ void SoftwareVsyncThread::onFirstRef() {
     run("SoftwareVsyncThread", PRIORITY_URGENT_DISPLAY + PRIORITY_MORE_FAVORABLE);
 }
 
+status_t SoftwareVsyncThread::readyToRun() {
+    ThreadManager::get().registerThread(ThreadManager::eThreadVsync, "SoftwareVsyncThread");
+    return NO_ERROR;
+}
+
 bool SoftwareVsyncThread::threadLoop() {
     { // scope for lock
         Mutex::Autolock _l(mLock);
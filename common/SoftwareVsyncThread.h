@@ -53,6 +53,7 @@ private:
     enum EMode { eModeStopped = 0, eModeRunning, eModeStopping, eModeTerminating };
 
     virtual void onFirstRef();
+    virtual status_t readyToRun();
     virtual bool threadLoop();
 
 private:
@@ -0,0 +1,426 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "SolidColorFilter.h"
+#include "FilterManager.h"
+#include "CompositionManager.h"
+#include "Layer.h"
+#include <math.h>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+#define SOLIDCOLOR_FILTER_DEBUG 0
+
+// Factory instance
+SolidColorFilter gSolidColorFilter;
+
+// A single detection request. Jobs are executed by the filter's scan pool.
+class SolidColorFilter::DetectionJob : public ScanJob
+{
+public:
+    DetectionJob(sp<ScanBuffer> pLinearBuffer);
+
+    const Layer& getLayer()                         { return mDetectionLayer; }
+    Layer& editLayer()                              { return mDetectionLayer; }
+    bool isDetected(uint32_t* pColor) const;
+    const PixelScan::Stats& getScanStats() const    { return mScanStats; }
+
+protected:
+    void onRun();
+
+private:
+    sp<ScanBuffer>      mpLinearBuffer;     // Linear copy of the buffer for rapid processing
+    Layer               mDetectionLayer;    // Layer currently being detected
+    uint32_t            mColor;
+    bool                mbResult;
+    PixelScan::Stats    mScanStats;         // Scan statistics for this detection
+};
+
+SolidColorFilter::DetectionJob::DetectionJob(sp<ScanBuffer> pLinearBuffer) :
+    mpLinearBuffer(pLinearBuffer),
+    mDetectionLayer(pLinearBuffer->getBuffer()->handle),
+    mColor(0),
+    mbResult(false)
+{
+    // Largest layers first.
+    mPriority = (uint64_t)mDetectionLayer.getBufferWidth() * mDetectionLayer.getBufferHeight();
+}
+
+void SolidColorFilter::DetectionJob::onRun()
+{
+    if (!isCancelled())
+    {
+        mDetectionLayer.waitRendering(ms2ns( 1000 ));
+    }
+
+    uint32_t* pBuffer = isCancelled() ? NULL : mpLinearBuffer->map();
+    if (pBuffer)
+    {
+        // Only the presented part of the buffer matters.
+        const hwc_frect_t& src = mDetectionLayer.getSrc();
+        const uint32_t w = mDetectionLayer.getBufferWidth();
+        const uint32_t h = mDetectionLayer.getBufferHeight();
+        const uint32_t s = mDetectionLayer.getBufferPitch() / 4;
+        const uint32_t x1 = (uint32_t)max( 0.0f, floorf( src.left ) );
+        const uint32_t y1 = (uint32_t)max( 0.0f, floorf( src.top ) );
+        const uint32_t x2 = min( w, (uint32_t)max( 0.0f, ceilf( src.right ) ) );
+        const uint32_t y2 = min( h, (uint32_t)max( 0.0f, ceilf( src.bottom ) ) );
+
+        if ( ( x1 < x2 ) && ( y1 < y2 ) )
+        {
+            // Every pixel must match the first.
+            mColor = pBuffer[ (size_t)y1 * s + x1 ];
+            mbResult = PixelScan::checkRegion( mColor, pBuffer, s, x1, y1, x2, y2, &mScanStats );
+        }
+        ALOGD_IF( SOLIDCOLOR_FILTER_DEBUG, "SolidColorFilter: Detect %u,%u %u,%u result %d color %08x",
+                  x1, y1, x2, y2, mbResult, mColor );
+    }
+
+    mpLinearBuffer = NULL;
+}
+
+bool SolidColorFilter::DetectionJob::isDetected(uint32_t* pColor) const
+{
+    if (mbResult)
+        *pColor = mColor;
+
+    return mbResult;
+}
+
+void SolidColorFilter::Candidate::reset()
+{
+    mHandle = 0;
+    mRepeatCount = 0;
+    mColor = 0;
+    mbChecked = false;
+    mbSolid = false;
+}
+
+SolidColorFilter::SolidColorFilter() :
+    mBM( AbstractBufferManager::get() ),
+    mOptionSolidColor( "solidcolor", 1 ),
+    mPool( "SolidColor", cMaxCandidates ),
+    mDetections( 0 ),
+    mSolidDetections( 0 ),
+    mFilledLayers( 0 )
+{
+    // Add this filter to the filter list
+    FilterManager::getInstance().add(*this, FilterPosition::SolidColor);
+}
+
+SolidColorFilter::~SolidColorFilter()
+{
+    // remove this filter
+    FilterManager::getInstance().remove(*this);
+
+    for (Candidate& candidate : mCandidates)
+    {
+        cancelDetection( candidate );
+    }
+}
+
+bool SolidColorFilter::isCandidate( const Layer& layer )
+{
+    switch ( layer.getBufferFormat() )
+    {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            break;
+        default:
+            return false;
+    }
+
+    // Front buffer rendered content can change without the handle changing.
+    return layer.getHandle()
+        && !layer.isComposition()
+        && !layer.isEncrypted()
+        && !layer.isFrontBufferRendered()
+        && !layer.isSolidColor()
+        && !( layer.getFlags() & HWC_SKIP_LAYER )
+        && ( (uint64_t)layer.getDstWidth() * layer.getDstHeight() >= cMinDstArea )
+        && ( ( layer.getBufferWidth() > cFillBufferSize ) || ( layer.getBufferHeight() > cFillBufferSize ) );
+}
+
+SolidColorFilter::Candidate* SolidColorFilter::findCandidate( buffer_handle_t handle )
+{
+    Candidate* pFree = NULL;
+    for (Candidate& candidate : mCandidates)
+    {
+        if ( candidate.mHandle == handle )
+        {
+            return &candidate;
+        }
+        if ( ( pFree == NULL ) && ( candidate.mHandle == 0 ) )
+        {
+            pFree = &candidate;
+        }
+    }
+    if ( pFree )
+    {
+        pFree->reset();
+        pFree->mHandle = handle;
+    }
+    return pFree;
+}
+
+void SolidColorFilter::initiateDetection( Candidate& candidate, const Layer& layer )
+{
+    ATRACE_CALL_IF(DISPLAY_TRACE);
+
+    // If all the workers are backed up then try again next frame.
+    // Check before the copy so we dont waste a composition.
+    if ( mPool.isFull() )
+    {
+        return;
+    }
+
+    if ( candidate.mpLinearBuffer == NULL
+      || candidate.mpLinearBuffer->getWidth() != layer.getBufferWidth()
+      || candidate.mpLinearBuffer->getHeight() < layer.getBufferHeight() )
+    {
+        // Any previous mapping is released once the last job using it completes.
+        candidate.mpScanBuffer = NULL;
+        candidate.mpLinearBuffer = mBM.createGraphicBuffer( "SOLIDCOLOR",
+                                                            layer.getBufferWidth(), layer.getBufferHeight(),
+                                                            HAL_PIXEL_FORMAT_RGBA_8888,
+                                                            GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER );
+        if ( candidate.mpLinearBuffer == NULL )
+        {
+            ALOGD_IF( SOLIDCOLOR_FILTER_DEBUG, "SolidColorFilter: Failed to allocate linear buffer" );
+            return;
+        }
+    }
+    if ( candidate.mpScanBuffer == NULL )
+    {
+        candidate.mpScanBuffer = new ScanBuffer( candidate.mpLinearBuffer );
+    }
+    candidate.mFramesUnused = 0;
+
+    sp<DetectionJob> pJob = new DetectionJob( candidate.mpScanBuffer );
+
+    // Copy the whole buffer without any of the original layer state (src rect, dst rect, rotation, ...).
+    Layer clonedLayer[1];
+    clonedLayer[0].onUpdateAll( layer.getHandle() );
+    CompositionManager::getInstance().performComposition( Content::LayerStack( clonedLayer, 1 ), pJob->getLayer() );
+    pJob->editLayer().setSrc( layer.getSrc() );
+
+    // Hand over to the low priority detection workers
+    if ( mPool.submit( pJob ) )
+    {
+        ALOGD_IF( SOLIDCOLOR_FILTER_DEBUG, "SolidColorFilter: Detect %s", layer.dump().string() );
+        candidate.mpDetectionJob = pJob;
+    }
+}
+
+void SolidColorFilter::cancelDetection( Candidate& candidate )
+{
+    if ( candidate.mpDetectionJob != NULL )
+    {
+        mPool.cancel( candidate.mpDetectionJob );
+        candidate.mpDetectionJob = NULL;
+    }
+}
+
+const Content& SolidColorFilter::onApply(const Content& ref)
+{
+    for (Candidate& candidate : mCandidates)
+    {
+        candidate.mbSeen = false;
+    }
+
+    // Track the handles of eligible layers and check those that stay unchanged.
+    if ( mOptionSolidColor )
+    {
+        for (uint32_t d = 0; d < ref.size(); d++)
+        {
+            const Content::Display& display = ref.getDisplay(d);
+            if ( !display.isEnabled() )
+                continue;
+
+            const Content::LayerStack& layerStack = display.getLayerStack();
+            for (uint32_t ly = 0; ly < layerStack.size(); ly++)
+            {
+                const Layer& layer = layerStack.getLayer(ly);
+                if ( !isCandidate( layer ) )
+                    continue;
+
+                Candidate* pCandidate = findCandidate( layer.getHandle() );
+                // Layers can appear on more than one display.
+                if ( ( pCandidate == NULL ) || pCandidate->mbSeen )
+                    continue;
+
+                pCandidate->mbSeen = true;
+                ++pCandidate->mRepeatCount;
+                if ( !pCandidate->mbChecked
+                  && ( pCandidate->mpDetectionJob == NULL )
+                  && ( pCandidate->mRepeatCount >= cFramesBeforeCheck ) )
+                {
+                    initiateDetection( *pCandidate, layer );
+                }
+            }
+        }
+    }
+
+    for (Candidate& candidate : mCandidates)
+    {
+        // A handle that goes away may come back with new content, so forget it.
+        if ( !candidate.mbSeen && candidate.mHandle )
+        {
+            cancelDetection( candidate );
+            candidate.reset();
+        }
+
+        if ( ( candidate.mpDetectionJob != NULL ) && candidate.mpDetectionJob->isFinished() )
+        {
+            mScanStats.add( candidate.mpDetectionJob->getScanStats() );
+            ++mDetections;
+            candidate.mbChecked = true;
+            candidate.mbSolid = candidate.mpDetectionJob->isDetected( &candidate.mColor );
+            if ( candidate.mbSolid )
+            {
+                ++mSolidDetections;
+            }
+            candidate.mpDetectionJob = NULL;
+        }
+
+        // Release the linear copy once it has been idle for a while.
+        if ( ( candidate.mpDetectionJob == NULL ) && ( candidate.mpLinearBuffer != NULL )
+          && ( ++candidate.mFramesUnused > cMaxBufferAge ) )
+        {
+            candidate.mpLinearBuffer = NULL;
+            candidate.mpScanBuffer = NULL;
+        }
+    }
+
+    // Replace the solid color layers.
+    mFilledLayers = 0;
+    for (uint32_t d = 0; d < ref.size(); d++)
+    {
+        const Content::Display& display = ref.getDisplay(d);
+        mBlanker.clear( d, display.isGeometryChanged() );
+        if ( !display.isEnabled() )
+            continue;
+
+        const Content::LayerStack& layerStack = display.getLayerStack();
+        for (uint32_t ly = 0; ly < layerStack.size(); ly++)
+        {
+            const Layer& layer = layerStack.getLayer(ly);
+            const buffer_handle_t handle = layer.getHandle();
+            if ( !handle )
+                continue;
+
+            for (const Candidate& candidate : mCandidates)
+            {
+                if ( ( candidate.mHandle != handle ) || !candidate.mbSolid )
+                    continue;
+
+                buffer_handle_t fillHandle = getFillBuffer( candidate.mColor );
+                if ( fillHandle && mBlanker.fill( d, ly, fillHandle, candidate.mColor ) )
+                {
+                    ALOGD_IF( SOLIDCOLOR_FILTER_DEBUG, "SolidColorFilter: D%u filling layer %u with %08x", d, ly, candidate.mColor );
+                    ++mFilledLayers;
+                }
+                break;
+            }
+        }
+    }
+
+    ageFillBuffers();
+
+    return mBlanker.update( ref );
+}
+
+buffer_handle_t SolidColorFilter::getFillBuffer( uint32_t color )
+{
+    for (FillBuffer& fillBuffer : mFillBuffers)
+    {
+        if ( fillBuffer.mColor == color )
+        {
+            // Mark as recently used and return the handle
+            fillBuffer.mFramesSinceLastUsed = 0;
+            return fillBuffer.mpBuffer->handle;
+        }
+    }
+
+    FillBuffer fillBuffer;
+    fillBuffer.mColor = color;
+    fillBuffer.mpBuffer = mBM.createGraphicBuffer( "SOLIDCOLOR", cFillBufferSize, cFillBufferSize,
+                                                   HAL_PIXEL_FORMAT_RGBA_8888,
+                                                   GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_COMPOSER );
+    if ( fillBuffer.mpBuffer == NULL )
+    {
+        return NULL;
+    }
+
+    void* pvBuffer = NULL;
+    if ( fillBuffer.mpBuffer->lock( GRALLOC_USAGE_SW_WRITE_OFTEN, &pvBuffer ) != OK )
+    {
+        ALOGE( "SolidColorFilter: Failed to lock fill buffer" );
+        return NULL;
+    }
+    uint32_t* pRow = (uint32_t*)pvBuffer;
+    for (uint32_t y = 0; y < cFillBufferSize; y++)
+    {
+        for (uint32_t x = 0; x < cFillBufferSize; x++)
+        {
+            pRow[x] = color;
+        }
+        pRow += fillBuffer.mpBuffer->getStride();
+    }
+    fillBuffer.mpBuffer->unlock();
+
+    mFillBuffers.push_back( fillBuffer );
+    return fillBuffer.mpBuffer->handle;
+}
+
+void SolidColorFilter::ageFillBuffers()
+{
+    // Age all buffers and destroy any that are too old.
+    for (uint32_t i = 0; i < mFillBuffers.size(); )
+    {
+        if ( ++mFillBuffers[i].mFramesSinceLastUsed > cMaxBufferAge )
+            mFillBuffers.erase( mFillBuffers.begin() + i );
+        else
+            ++i;
+    }
+}
+
+String8 SolidColorFilter::dump()
+{
+    uint32_t tracked = 0;
+    uint32_t solid = 0;
+    for (const Candidate& candidate : mCandidates)
+    {
+        if ( candidate.mHandle )
+            ++tracked;
+        if ( candidate.mbSolid )
+            ++solid;
+    }
+
+    String8 output = String8::format( "Tracked:%u Solid:%u Filled:%u FillBuffers:%zu Detections:%u/%u ",
+                                      tracked, solid, mFilledLayers, mFillBuffers.size(), mSolidDetections, mDetections );
+    output += PixelScan::dumpStats( mScanStats );
+    output += String8(" ") + mPool.dump();
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,124 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_SOLIDCOLORFILTER_H
+#define INTEL_UFO_HWC_SOLIDCOLORFILTER_H
+
+#include "AbstractFilter.h"
+#include "AbstractBufferManager.h"
+#include "LayerBlanker.h"
+#include "Option.h"
+#include "PixelScan.h"
+#include "ScanPool.h"
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This filter looks for large static layers where every pixel is the same color
+// (backgrounds, dim layers, etc) and replaces them with a tiny buffer of that color
+// scaled up to the original frame. The replacement is tagged with the color so that
+// compositors can implement it as a fill (see Layer::isSolidColor).
+// Detection runs on the background scan pool; a buffer is checked once its handle has
+// been stable for a number of frames and the result holds for as long as the handle does.
+class SolidColorFilter : public AbstractFilter
+{
+public:
+    SolidColorFilter();
+    virtual ~SolidColorFilter();
+
+    const char* getName() const { return "SolidColorFilter"; }
+    const Content& onApply(const Content& ref);
+    String8 dump();
+
+private:
+    // Maximum number of buffers tracked at once.
+    static const uint32_t cMaxCandidates = 4;
+    // Number of frames a handle must be unchanged before it is checked.
+    static const uint32_t cFramesBeforeCheck = 10;
+    // Layers must cover at least this many pixels to be worth checking.
+    static const uint32_t cMinDstArea = 256 * 256;
+    // Width and height of the color buffers.
+    static const uint32_t cFillBufferSize = 16;
+    // Number of frames an unused buffer is kept around.
+    static const uint32_t cMaxBufferAge = 60;
+
+    class DetectionJob;
+
+    // Per buffer tracking.
+    struct Candidate
+    {
+        Candidate() : mHandle(0), mRepeatCount(0), mFramesUnused(0), mColor(0), mbSeen(false), mbChecked(false), mbSolid(false) {}
+        void reset();
+
+        buffer_handle_t     mHandle;            // Tracked handle, 0 if the candidate is free.
+        uint32_t            mRepeatCount;       // Consecutive frames the handle has been seen.
+        uint32_t            mFramesUnused;      // Frames since the linear buffer was last used.
+        uint32_t            mColor;             // Detected color, valid if mbSolid.
+        bool                mbSeen:1;           // Handle was seen this frame.
+        bool                mbChecked:1;        // Detection has completed for this handle.
+        bool                mbSolid:1;          // Detection found a single color.
+        sp<DetectionJob>    mpDetectionJob;
+        sp<GraphicBuffer>   mpLinearBuffer;
+        sp<ScanBuffer>      mpScanBuffer;       // CPU mapping of mpLinearBuffer, retained across detections
+    };
+
+    // Per color fill buffers.
+    struct FillBuffer
+    {
+        FillBuffer() : mColor(0), mFramesSinceLastUsed(0) {}
+        uint32_t            mColor;
+        sp<GraphicBuffer>   mpBuffer;
+        uint32_t            mFramesSinceLastUsed;
+    };
+
+    // Can this layer be checked and replaced.
+    static bool isCandidate( const Layer& layer );
+
+    // Find the candidate tracking handle, allocating a free one if required. Returns NULL if none are available.
+    Candidate* findCandidate( buffer_handle_t handle );
+
+    // Start a detection on the candidate for layer.
+    void initiateDetection( Candidate& candidate, const Layer& layer );
+
+    // Abandon any detection in progress on the candidate.
+    void cancelDetection( Candidate& candidate );
+
+    // Get a buffer filled with color. Returns NULL on failure.
+    buffer_handle_t getFillBuffer( uint32_t color );
+    void ageFillBuffers();
+
+    AbstractBufferManager&  mBM;
+    Option                  mOptionSolidColor;
+    ScanPool                mPool;
+    LayerBlanker            mBlanker;
+
+    Candidate               mCandidates[cMaxCandidates];
+    std::vector<FillBuffer> mFillBuffers;
+
+    // Statistics.
+    PixelScan::Stats        mScanStats;         // Accumulated scan statistics from completed detections
+    uint32_t                mDetections;        // Completed detections.
+    uint32_t                mSolidDetections;   // Detections that found a single color.
+    uint32_t                mFilledLayers;      // Layers replaced last frame.
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_SOLIDCOLORFILTER_H
@@ -0,0 +1,303 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "ThreadManager.h"
+#include <utils/Thread.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// Vsync delivery sits just above the flips it paces, both above SurfaceFlinger's own threads.
+// Detection only runs on otherwise idle CPU time; its results are advisory.
+const ThreadManager::Policy ThreadManager::scPolicy[eThreadClassCount] =
+{
+    { "vsync",      SCHED_FIFO,     2,                          eAffinityForeground },
+    { "flip",       SCHED_FIFO,     1,                          eAffinityForeground },
+    { "frame",      SCHED_OTHER,    PRIORITY_URGENT_DISPLAY,    eAffinityForeground },
+    { "event",      SCHED_OTHER,    PRIORITY_NORMAL,            eAffinityAny        },
+    { "timer",      SCHED_OTHER,    PRIORITY_NORMAL,            eAffinityAny        },
+    { "detection",  SCHED_IDLE,     0,                          eAffinityBackground },
+    { "background", SCHED_BATCH,    PRIORITY_BACKGROUND,        eAffinityBackground },
+};
+
+static const char* getSchedPolicyName(int32_t policy)
+{
+    switch (policy)
+    {
+        case SCHED_OTHER:   return "OTHER";
+        case SCHED_FIFO:    return "FIFO";
+        case SCHED_RR:      return "RR";
+        case SCHED_BATCH:   return "BATCH";
+        case SCHED_IDLE:    return "IDLE";
+    }
+    return "?";
+}
+
+// Read the runtime, run delay (both ns) and number of timeslices of a thread.
+static bool readSchedStat(pid_t tid, uint64_t* pRuntime, uint64_t* pDelay, uint64_t* pSlices)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+    FILE* pFile = fopen(path, "r");
+    if (pFile == NULL)
+    {
+        return false;
+    }
+    const bool bOK = (fscanf(pFile, "%" SCNu64 " %" SCNu64 " %" SCNu64, pRuntime, pDelay, pSlices) == 3);
+    fclose(pFile);
+    return bOK;
+}
+
+// Read the voluntary (sleeps, so one per wakeup) and involuntary (preemptions) context switches of a thread.
+static void readContextSwitches(pid_t tid, uint64_t* pVoluntary, uint64_t* pInvoluntary)
+{
+    *pVoluntary = 0;
+    *pInvoluntary = 0;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", tid);
+    FILE* pFile = fopen(path, "r");
+    if (pFile == NULL)
+    {
+        return;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), pFile))
+    {
+        if (sscanf(line, "voluntary_ctxt_switches: %" SCNu64, pVoluntary) == 1)
+            continue;
+        sscanf(line, "nonvoluntary_ctxt_switches: %" SCNu64, pInvoluntary);
+    }
+    fclose(pFile);
+}
+
+static bool isThreadAlive(pid_t tid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d", tid);
+    return access(path, F_OK) == 0;
+}
+
+ThreadManager::ThreadManager() :
+    mbInitialized(false)
+{
+    mThreads.reserve(cPruneThreshold);
+}
+
+void ThreadManager::initialize()
+{
+    Mutex::Autolock _l(mLock);
+    if (mbInitialized)
+    {
+        return;
+    }
+    mOptionPolicy.initialize("threadpolicy", 1);
+    mOptionPolicy.setForceGeometryChange(false);
+    mOptionForegroundCpus.initialize("threadfgcpus", 0);
+    mOptionForegroundCpus.setForceGeometryChange(false);
+    mOptionBackgroundCpus.initialize("threadbgcpus", 0);
+    mOptionBackgroundCpus.setForceGeometryChange(false);
+    mbInitialized = true;
+
+    if (mOptionPolicy)
+    {
+        for (ThreadInfo& thread : mThreads)
+        {
+            thread.mbPolicyApplied = applyPolicy(thread.mTid, thread.meClass);
+        }
+    }
+}
+
+bool ThreadManager::applyPolicy(pid_t tid, EThreadClass eClass)
+{
+    const Policy& policy = scPolicy[eClass];
+    bool bOK = true;
+
+    // On Linux these all address an individual thread by its tid.
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (policy.mPolicy == SCHED_FIFO)
+    {
+        param.sched_priority = policy.mPriority;
+    }
+    int ret = sched_setscheduler(tid, policy.mPolicy, &param);
+    if (ret != 0)
+    {
+        const int err = errno;
+        ALOGW("ThreadManager: %s policy not applied to thread %d: sched_setscheduler failed: %s", policy.mpchName, tid, strerror(err));
+        bOK = false;
+    }
+    else if (policy.mPolicy != SCHED_FIFO)
+    {
+        ret = setpriority(PRIO_PROCESS, tid, policy.mPriority);
+        if (ret != 0)
+        {
+            const int err = errno;
+            ALOGW("ThreadManager: %s policy not applied to thread %d: setpriority failed: %s", policy.mpchName, tid, strerror(err));
+            bOK = false;
+        }
+    }
+
+    uint32_t cpus = 0;
+    if (policy.mAffinity == eAffinityForeground)
+    {
+        cpus = mOptionForegroundCpus.get();
+    }
+    else if (policy.mAffinity == eAffinityBackground)
+    {
+        cpus = mOptionBackgroundCpus.get();
+    }
+    if (cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t cpu = 0; cpu < 32; ++cpu)
+        {
+            if (cpus & (1u << cpu))
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        ret = sched_setaffinity(tid, sizeof(set), &set);
+        if (ret != 0)
+        {
+            const int err = errno;
+            ALOGW("ThreadManager: %s affinity not applied to thread %d: sched_setaffinity failed: %s", policy.mpchName, tid, strerror(err));
+            bOK = false;
+        }
+    }
+    return bOK;
+}
+
+void ThreadManager::registerThread(EThreadClass eClass, const char* pchName)
+{
+    ALOG_ASSERT(eClass < eThreadClassCount);
+    const pid_t tid = gettid();
+
+    Mutex::Autolock _l(mLock);
+    for (const ThreadInfo& thread : mThreads)
+    {
+        if ((thread.mTid == tid) && (thread.meClass == eClass))
+        {
+            return;
+        }
+    }
+
+    ThreadInfo thread;
+    thread.mTid = tid;
+    thread.meClass = eClass;
+    if (pchName)
+    {
+        thread.mName = pchName;
+    }
+    else
+    {
+        char name[17] = { 0 };
+        prctl(PR_GET_NAME, name, 0, 0, 0);
+        thread.mName = name;
+    }
+
+    thread.mbPolicyApplied = false;
+    if (mbInitialized && mOptionPolicy)
+    {
+        thread.mbPolicyApplied = applyPolicy(tid, eClass);
+    }
+
+    if (mThreads.size() >= cPruneThreshold)
+    {
+        prune();
+    }
+
+    // A recycled tid replaces the thread that used it before.
+    for (ThreadInfo& existing : mThreads)
+    {
+        if (existing.mTid == tid)
+        {
+            existing = thread;
+            return;
+        }
+    }
+    mThreads.push_back(thread);
+}
+
+void ThreadManager::prune()
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    uint32_t kept = 0;
+    for (uint32_t t = 0; t < mThreads.size(); ++t)
+    {
+        if (isThreadAlive(mThreads[t].mTid))
+        {
+            mThreads[kept++] = mThreads[t];
+        }
+    }
+    mThreads.resize(kept);
+}
+
+String8 ThreadManager::dump()
+{
+    Mutex::Autolock _l(mLock);
+    if (!mbInitialized)
+    {
+        return String8();
+    }
+    prune();
+
+    String8 output = String8::format("Policy:%s fgcpus:0x%x bgcpus:0x%x\n",
+                                     mOptionPolicy ? "on" : "off",
+                                     mOptionForegroundCpus.get(), mOptionBackgroundCpus.get());
+    for (const ThreadInfo& thread : mThreads)
+    {
+        const int32_t policy = sched_getscheduler(thread.mTid);
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        sched_getparam(thread.mTid, &param);
+        const int32_t nice = getpriority(PRIO_PROCESS, thread.mTid);
+
+        uint32_t cpus = 0;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(thread.mTid, sizeof(set), &set) == 0)
+        {
+            for (uint32_t cpu = 0; cpu < 32; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    cpus |= 1u << cpu;
+                }
+            }
+        }
+
+        uint64_t runtime = 0, delay = 0, slices = 0;
+        readSchedStat(thread.mTid, &runtime, &delay, &slices);
+        uint64_t wakeups = 0, preemptions = 0;
+        readContextSwitches(thread.mTid, &wakeups, &preemptions);
+
+        output.appendFormat("  %-24s %5d %-10s %s%s:%d nice:%d cpus:0x%x run:%" PRIu64 "ms delay:%" PRIu64 "ms wakeups:%" PRIu64 " preempted:%" PRIu64 "\n",
+                            thread.mName.string(), thread.mTid, scPolicy[thread.meClass].mpchName,
+                            thread.mbPolicyApplied ? "" : "!", getSchedPolicyName(policy), param.sched_priority, nice, cpus,
+                            runtime / 1000000, delay / 1000000, wakeups, preemptions);
+    }
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
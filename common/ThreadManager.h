@@ -0,0 +1,121 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_THREADMANAGER_H
+#define INTEL_UFO_HWC_THREADMANAGER_H
+
+#include "Common.h"
+#include "Option.h"
+#include "Singleton.h"
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class keeps a registry of the threads the HWC creates and applies a scheduling
+// policy to each according to its class: the scheduling class and priority, and the set of
+// CPUs it may run on. Every HWC thread registers itself as it starts.
+// Threads can start while options are still being set up (the persistent registry that backs
+// options has its own writer thread), so the policy is only applied once the Hwc has initialized
+// the manager; threads registered before then have it applied at that point.
+// The policy can be disabled, in which case threads keep the priority they were started with.
+// The CPU sets are bit masks given by options; 0 leaves the affinity alone:
+//   intel.hwc.threadfgcpus : CPUs for vsync, flip and frame threads.
+//   intel.hwc.threadbgcpus : CPUs for detection and background threads.
+class ThreadManager : public Singleton<ThreadManager>
+{
+public:
+    static ThreadManager& get() { return getInstance(); }
+
+    // Read the options and apply the policy to the threads registered so far.
+    void initialize();
+
+    enum EThreadClass
+    {
+        eThreadVsync,       // Vsync and page flip event delivery.
+        eThreadFlip,        // Display queue workers issuing flips.
+        eThreadFrame,       // Work on the critical path of a frame (plane allocation, composition).
+        eThreadEvent,       // Hotplug and other kernel events.
+        eThreadTimer,       // Timer callbacks.
+        eThreadDetection,   // Content analysis (transparency and solid color detection).
+        eThreadBackground,  // Deferred housekeeping (persistent registry writes).
+        eThreadClassCount
+    };
+
+    // Register the calling thread and apply the policy for its class.
+    // If pchName is NULL then the kernel thread name is used.
+    // Registering a thread again is harmless.
+    void registerThread(EThreadClass eClass, const char* pchName = NULL);
+
+    // Dump the registered threads with their actual scheduling and their runtime
+    // and wakeups so far.
+    String8 dump();
+
+private:
+    friend class Singleton<ThreadManager>;
+
+    ThreadManager();
+
+    enum EAffinity
+    {
+        eAffinityAny,
+        eAffinityForeground,
+        eAffinityBackground
+    };
+
+    struct Policy
+    {
+        const char*     mpchName;
+        int32_t         mPolicy;        // SCHED_* class.
+        int32_t         mPriority;      // Realtime priority for SCHED_FIFO, else the nice value.
+        EAffinity       mAffinity;
+    };
+
+    struct ThreadInfo
+    {
+        pid_t           mTid;
+        EThreadClass    meClass;
+        String8         mName;
+        bool            mbPolicyApplied;
+    };
+
+    // Once this many threads are registered, exited threads are dropped on registration.
+    static const uint32_t cPruneThreshold = 64;
+
+    static const Policy scPolicy[eThreadClassCount];
+
+    // Apply the policy for a class to a thread. Returns false if any part was refused.
+    bool applyPolicy(pid_t tid, EThreadClass eClass);
+
+    // Drop threads that have exited.
+    // Lock must be held.
+    void prune();
+
+    Option                  mOptionPolicy;
+    Option                  mOptionForegroundCpus;
+    Option                  mOptionBackgroundCpus;
+
+    Mutex                   mLock;
+    std::vector<ThreadInfo> mThreads;
+    bool                    mbInitialized;
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_THREADMANAGER_H
@@ -16,6 +16,7 @@
 
 #include "Common.h"
 #include "Timeline.h"
+#include "HotPathStats.h"
 
 #ifdef SW_SYNC_H_PATH
 // This header became private. As we still need it, we now have to find it in the makefile.
@@ -163,6 +164,7 @@ Timeline::NativeFence Timeline::repeatFence( uint32_t* pTimelineIndex )
 
 bool Timeline::mergeFence( NativeFence* pFence, NativeFence* pOtherFence )
 {
+    HOTPATH_SCOPE( FENCE_MERGE );
     ALOG_ASSERT( pFence && pOtherFence );
     ALOGD_IF( SYNC_FENCE_DEBUG, "Timeline:merge fence %p/%d other %p/%d", pFence, *pFence, pOtherFence, *pOtherFence );
 
@@ -278,6 +280,33 @@ bool Timeline::mergeFence( NativeFence* pFence, NativeFence* pOtherFence )
     }
 }
 
+int32_t Timeline::querySignalTime( NativeFence fence, nsecs_t* pSignalTime )
+{
+    ALOG_ASSERT( pSignalTime );
+    struct sync_fence_info_data* pInfo = sync_fence_info( fence );
+    if ( pInfo == NULL )
+    {
+        return -1;
+    }
+
+    int32_t status = pInfo->status;
+    if ( status == 1 )
+    {
+        nsecs_t signalTime = 0;
+        struct sync_pt_info* pSyncPointInfo = NULL;
+        while ( ( pSyncPointInfo = sync_pt_info( pInfo, pSyncPointInfo ) ) != NULL )
+        {
+            if ( nsecs_t( pSyncPointInfo->timestamp_ns ) > signalTime )
+            {
+                signalTime = nsecs_t( pSyncPointInfo->timestamp_ns );
+            }
+        }
+        *pSignalTime = signalTime;
+    }
+    sync_fence_info_free( pInfo );
+    return status;
+}
+
 Timeline::NativeFence Timeline::dupFence( const NativeFence* pOtherFence )
 {
     ALOGD_IF( SYNC_FENCE_DEBUG, "Timeline:dup fence %d", *pOtherFence );
@@ -594,6 +594,11 @@ public:
     // The returned fence must be released using close( ).
     static NativeFence dupFence( const NativeFence* pOtherFence );
 
+    // Query when a fence signalled (the latest of its sync points).
+    // Returns 1 and the signal time if the fence has signalled, 0 if it is still active and
+    // negative on error.
+    static int32_t querySignalTime( NativeFence fence, nsecs_t* pSignalTime );
+
     // Advance the 'current time' by N ticks.
     // This will release all fences up to and including the new current time.
     // By default, this will increase time by 1 tick.
@@ -15,6 +15,7 @@
 */
 
 #include "Common.h"
+#include "ThreadManager.h"
 #include "Timer.h"
 
 namespace intel {
@@ -94,6 +95,8 @@ void Timer::timeoutHandler(sigval_t value)
 {
     ALOG_ASSERT( value.sival_ptr );
     Timer *pTimer = static_cast<Timer*>(value.sival_ptr);
+    // Callbacks run on threads created by the C library for the timer.
+    ThreadManager::get().registerThread(ThreadManager::eThreadTimer, "hwc_timer");
     pTimer->mCallback.notify(*pTimer);
 }
 
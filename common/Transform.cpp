@@ -39,7 +39,7 @@ void clipLayerToDisplay( Layer* pLayer, const uint32_t dispW, const uint32_t dis
                    dispW, dispH );
 
     // clip visibleRegions to display
-    Vector<hwc_rect_t>& visRegions = pLayer->editVisibleRegions();
+    Layer::VisibleRegions& visRegions = pLayer->editVisibleRegions();
     for ( uint32_t r = 0; r < visRegions.size(); r++ )
     {
         hwc_rect_t& visRect = visRegions.editItemAt(r);
@@ -21,8 +21,8 @@
 #include "Layer.h"
 #include <ui/GraphicBufferMapper.h>
 #include <ui/Rect.h>
-#include <utils/Thread.h>
 #include "AbstractBufferManager.h"
+#include "PixelScan.h"
 #include <Utils.h>
 
 namespace intel {
@@ -36,90 +36,84 @@ namespace hwc {
 // Factory class will self register
 TransparencyFilter gTransparencyFilter;
 
-class TransparencyFilter::DetectionThread : public Thread
+// A single detection request. Jobs are executed by the shared scan pool.
+class TransparencyFilter::DetectionJob : public ScanJob
 {
 public:
-    DetectionThread(sp<GraphicBuffer> pLinearBuffer, hwc_frect_t activeRect);
-    virtual ~DetectionThread();
-
-    const char* getName() const                     { return "TransparencyFilter"; }
-    const Content& onApply(const Content& ref);
+    DetectionJob(sp<ScanBuffer> pLinearBuffer, hwc_frect_t activeRect);
+    virtual ~DetectionJob();
 
     const Layer& getLayer()                         { return mDetectionLayer; }
     Layer& editLayer()                              { return mDetectionLayer; }
-    bool isFinished()                               { return mbFinished; }
     bool isDetected(hwc_rect* pBlackMask);
+    const PixelScan::Stats& getScanStats()          { return mScanStats; }
+
+protected:
+    void onRun();
 
 private:
     void detect(uint32_t* pBuffer);
 
-    // Detection will be performed in this thread
-    virtual bool threadLoop();
-
 private:
     // Private reference to hold modified state
-    sp<GraphicBuffer>   mpLinearBuffer;     // Linear copy of the buffer for rapid processing
+    sp<ScanBuffer>      mpLinearBuffer;     // Linear copy of the buffer for rapid processing
     hwc_frect_t         mActiveRect;
     Layer               mDetectionLayer;    // Layer currently being detected
     hwc_rect_t          mBlackMask;
-    bool                mbFinished;
     bool                mbResult;
+    PixelScan::Stats    mScanStats;         // Scan statistics for this detection
 };
 
-TransparencyFilter::DetectionThread::DetectionThread(sp<GraphicBuffer> pLinearBuffer, hwc_frect_t activeRect) :
+TransparencyFilter::DetectionJob::DetectionJob(sp<ScanBuffer> pLinearBuffer, hwc_frect_t activeRect) :
     mpLinearBuffer(pLinearBuffer),
     mActiveRect(activeRect),
-    mDetectionLayer(pLinearBuffer->handle),
+    mDetectionLayer(pLinearBuffer->getBuffer()->handle),
     mBlackMask{},
-    mbFinished(false),
     mbResult(false)
 {
-    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter::TransparencyFilter::DetectionThread");
+    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter::DetectionJob");
+    // Largest layers first.
+    mPriority = (uint64_t)mDetectionLayer.getBufferWidth() * mDetectionLayer.getBufferHeight();
 }
 
-TransparencyFilter::DetectionThread::~DetectionThread()
+TransparencyFilter::DetectionJob::~DetectionJob()
 {
-    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter::TransparencyFilter::~DetectionThread");
+    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter::~DetectionJob");
 }
 
-bool TransparencyFilter::DetectionThread::threadLoop()
+void TransparencyFilter::DetectionJob::onRun()
 {
-    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: threadLoop");
-    mDetectionLayer.waitRendering(ms2ns( 1000 ));
+    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: DetectionJob run");
 
-    // Look for a some kind of transparent window possibly with a black outline
-    // Abort the entire check if we find any non black, non transparent pixel
-
-    GraphicBufferMapper& mapper = GraphicBufferMapper::get();
-    void* pvBuffer = NULL;
-    status_t r = mapper.lock(mDetectionLayer.getHandle(), GRALLOC_USAGE_SW_READ_OFTEN, Rect(0, 0, mDetectionLayer.getBufferWidth(), mDetectionLayer.getBufferHeight()), &pvBuffer);
-    if (r != OK)
+    if (!isCancelled())
     {
-        ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: Failed to lock surface");
-        return false;
+        mDetectionLayer.waitRendering(ms2ns( 1000 ));
     }
 
-    detect((uint32_t*)pvBuffer);
+    // Look for a some kind of transparent window possibly with a black outline
+    // Abort the entire check if we find any non black, non transparent pixel
+    uint32_t* pBuffer = isCancelled() ? NULL : mpLinearBuffer->map();
+    if (pBuffer)
+    {
+        detect(pBuffer);
 
-    ALOGD_IF (TRANSPARENCY_FILTER_DEBUG, "Detect result: %d", mbResult);
+        ALOGD_IF (TRANSPARENCY_FILTER_DEBUG, "Detect result: %d", mbResult);
 
 #ifdef DUMP_UNTRANSPARENT_LAYER
-    if (!mbResult)
-    {
-        static int count = 0;
-        mDetectionLayer.dumpContentToTGA(String8::format("NotTransparent%d", count));
-        count++;
-    }
+        if (!mbResult)
+        {
+            static int count = 0;
+            mDetectionLayer.dumpContentToTGA(String8::format("NotTransparent%d", count));
+            count++;
+        }
 #endif
+    }
 
-    mapper.unlock(mDetectionLayer.getHandle());
     mpLinearBuffer = NULL;
-    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: threadLoop Finished");
-    mbFinished = true;
-    return false;
+    ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: DetectionJob Finished%s", isCancelled() ? " (cancelled)" : "");
 }
 
-bool TransparencyFilter::DetectionThread::isDetected(hwc_rect* pBlackMask)
+bool TransparencyFilter::DetectionJob::isDetected(hwc_rect* pBlackMask)
 {
     if (mbResult)
         *pBlackMask = mBlackMask;
@@ -127,45 +121,6 @@ bool TransparencyFilter::DetectionThread::isDetected(hwc_rect* pBlackMask)
     return mbResult;
 }
 
-static inline bool checkRegionForColor(uint32_t color, uint32_t* pBuffer, uint32_t strideInPixels, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
-{
-    ATRACE_CALL_IF(DISPLAY_TRACE);
-    pBuffer += y1 * strideInPixels;
-    for (uint32_t y = y1; y < y2; y++)
-    {
-        for (uint32_t x = x1; x < x2; x++)
-        {
-            if (pBuffer[x] != color)
-            {
-                ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: checkRegionForColor %d, %d, %d, %d Failed at %d, %d", x1, y1, x2, y2, x, y);
-                return false;
-            }
-        }
-        pBuffer += strideInPixels;
-    }
-    return true;
-}
-
-static inline bool checkRegionForColor(uint32_t color1, uint32_t color2, uint32_t* pBuffer, uint32_t strideInPixels, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
-{
-    ATRACE_CALL_IF(DISPLAY_TRACE);
-    pBuffer += y1 * strideInPixels;
-    for (uint32_t y = y1; y < y2; y++)
-    {
-        for (uint32_t x = x1; x < x2; x++)
-        {
-            if (pBuffer[x] != color1 && pBuffer[x] != color2)
-            {
-                ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: checkRegionForColor %d, %d, %d, %d Failed at %d, %d", x1, y1, x2, y2, x, y);
-                return false;
-            }
-        }
-        pBuffer += strideInPixels;
-    }
-    return true;
-}
-
-
 static hwc_frect_t rotateRect (const hwc_frect_t& rect, ETransform transform)
 {
     hwc_frect_t rotatedRect = rect;
@@ -197,7 +152,7 @@ static hwc_frect_t rotateRect (const hwc_frect_t& rect, ETransform transform)
     return rotatedRect;
 }
 
-void TransparencyFilter::DetectionThread::detect(uint32_t* pBuffer)
+void TransparencyFilter::DetectionJob::detect(uint32_t* pBuffer)
 {
     ATRACE_CALL_IF(DISPLAY_TRACE);
 
@@ -242,15 +197,19 @@ void TransparencyFilter::DetectionThread::detect(uint32_t* pBuffer)
 
     // Perform a complete check of a the whole layer.
     // For the case that the layer is full transparent, we need check black and transparent simultaneously for non-video region
-    if (!checkRegionForColor(BLACK, TRANSPARENT, pBuffer, s, 0,  bb, w,  h )) return;   // Bottom
+    if (!PixelScan::checkRegion(BLACK, TRANSPARENT, pBuffer, s, 0,  bb, w,  h,  &mScanStats)) return;   // Bottom
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Bottom check pass, %d %d %d %d", 0, bb, w, h);
-    if (!checkRegionForColor(BLACK, TRANSPARENT, pBuffer, s, 0,  0,  w,  bt)) return;   // Top
+    if (isCancelled()) return;
+    if (!PixelScan::checkRegion(BLACK, TRANSPARENT, pBuffer, s, 0,  0,  w,  bt, &mScanStats)) return;   // Top
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Top check pass, %d %d %d %d", 0, 0, w, bt);
-    if (!checkRegionForColor(BLACK, TRANSPARENT, pBuffer, s, 0,  bt, bl, bb)) return;   // Left
+    if (isCancelled()) return;
+    if (!PixelScan::checkRegion(BLACK, TRANSPARENT, pBuffer, s, 0,  bt, bl, bb, &mScanStats)) return;   // Left
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Left check pass, %d %d %d %d", 0, bt, bl, bb);
-    if (!checkRegionForColor(BLACK, TRANSPARENT, pBuffer, s, br, bt, w,  bb)) return;   // Right
+    if (isCancelled()) return;
+    if (!PixelScan::checkRegion(BLACK, TRANSPARENT, pBuffer, s, br, bt, w,  bb, &mScanStats)) return;   // Right
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Right check pass, %d %d %d %d", br, bt, w, bb);
-    if (!checkRegionForColor(TRANSPARENT, pBuffer, s, bl, bt, br, bb)) return;   // Middle
+    if (isCancelled()) return;
+    if (!PixelScan::checkRegion(TRANSPARENT, pBuffer, s, bl, bt, br, bb, &mScanStats)) return;   // Middle
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Middle check pass, %d %d %d %d", bl, bt, br, bb);
 
     // Setup the detected blackmask region.
@@ -268,8 +227,9 @@ TransparencyFilter::DetectionItem::DetectionItem() :
     mRepeatCount(0),
     mbEnabled(0),
     mpLinearBuffer(NULL),
+    mpMappedBuffer(NULL),
     mFramesBeforeCheck(0),
-    mpDetectionThread(NULL),
+    mpDetectionJob(NULL),
     mbFirstEnabledFrame(0),
     mbFirstDisabledFrame(0)
 {
@@ -312,18 +272,27 @@ void TransparencyFilter::DetectionItem::updateRepeatCounts(const Layer& ly)
     }
 }
 
-void TransparencyFilter::DetectionItem::initiateDetection(const Layer& layer, hwc_frect_t activeRect)
+void TransparencyFilter::DetectionItem::initiateDetection(const Layer& layer, hwc_frect_t activeRect, ScanPool& pool)
 {
     ATRACE_CALL_IF(DISPLAY_TRACE);
     ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: initiateDetection");
 
     // Double check to ensure that detection isnt already running.
-    if (mpDetectionThread != NULL)
+    if (mpDetectionJob != NULL)
     {
         ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: Already running");
         return;
     }
 
+    // If all the workers are backed up then try again next frame.
+    // Check before the copy so we dont waste a composition.
+    if (pool.isFull())
+    {
+        ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: Pool full, deferring detection");
+        mRepeatCount = mFramesBeforeCheck - 1;
+        return;
+    }
+
     // Check if we need re-allocate a graphic buffer
     if (mpLinearBuffer == NULL || mpLinearBuffer->getWidth() != layer.getBufferWidth() ||
         (mpLinearBuffer->getWidth() == layer.getBufferWidth() && layer.getBufferHeight() > mpLinearBuffer->getHeight()))
@@ -332,6 +301,8 @@ void TransparencyFilter::DetectionItem::initiateDetection(const Layer& layer, hw
                                                   layer.getBufferWidth(), layer.getBufferHeight(),
                                                   HAL_PIXEL_FORMAT_RGBA_8888,
                                                   GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER );
+        // Any previous mapping is released once the last job using it completes.
+        mpMappedBuffer = NULL;
 
         ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Re-allocate linear buffer, origin size: %d %d, requested size: %d %d, handle: %p",
                  mpLinearBuffer->getWidth(), mpLinearBuffer->getHeight(), layer.getBufferWidth(), layer.getBufferHeight(), mpLinearBuffer->handle);
@@ -343,20 +314,39 @@ void TransparencyFilter::DetectionItem::initiateDetection(const Layer& layer, hw
         return;
     }
 
-    mpDetectionThread = new DetectionThread(mpLinearBuffer, activeRect);
+    if (mpMappedBuffer == NULL)
+    {
+        mpMappedBuffer = new ScanBuffer(mpLinearBuffer);
+    }
+
+    mpDetectionJob = new DetectionJob(mpMappedBuffer, activeRect);
 
     // we only need copy the whole bufer but don't want to use other original info like src rect, dst rect, rotation flag....
     Layer clonedLayer[1];
     clonedLayer[0].onUpdateAll(layer.getHandle());
-    CompositionManager::getInstance().performComposition(Content::LayerStack(clonedLayer, 1), mpDetectionThread->getLayer());
+    CompositionManager::getInstance().performComposition(Content::LayerStack(clonedLayer, 1), mpDetectionJob->getLayer());
 
     // Set needed info to detection layer
-    mpDetectionThread->editLayer().setSrc (layer.getSrc());
-    mpDetectionThread->editLayer().setDst (layer.getDst());
-    mpDetectionThread->editLayer().setTransform (layer.getTransform());
+    mpDetectionJob->editLayer().setSrc (layer.getSrc());
+    mpDetectionJob->editLayer().setDst (layer.getDst());
+    mpDetectionJob->editLayer().setTransform (layer.getTransform());
 
-    // Start the low priority detection thread
-    mpDetectionThread->run("Detect_thread", PRIORITY_BACKGROUND);
+    // Hand over to the low priority detection workers
+    if (!pool.submit(mpDetectionJob))
+    {
+        mpDetectionJob = NULL;
+        mRepeatCount = mFramesBeforeCheck - 1;
+    }
+}
+
+void TransparencyFilter::DetectionItem::cancelDetection(ScanPool& pool)
+{
+    if (mpDetectionJob != NULL)
+    {
+        ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: cancelDetection");
+        pool.cancel(mpDetectionJob);
+        mpDetectionJob = NULL;
+    }
 }
 
 void TransparencyFilter::DetectionItem::filterLayers(Content& ref)
@@ -393,6 +383,7 @@ void TransparencyFilter::DetectionItem::garbageCollect(void)
     {
         Log::alogd(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter : Garbage collect linear buffer %p", mpLinearBuffer->handle );
         mpLinearBuffer = NULL;
+        mpMappedBuffer = NULL;
     }
 }
 
@@ -406,7 +397,8 @@ String8 TransparencyFilter::DetectionItem::dump()
 }
 
 TransparencyFilter::TransparencyFilter() :
-    mDetectionNum(0)
+    mDetectionNum(0),
+    mpPool(new ScanPool("Detect", MAX_DETECT_LAYERS))
 {
     // Add this filter to the front of the filter list
     FilterManager::getInstance().add(*this, FilterPosition::Transparency);
@@ -422,6 +414,9 @@ TransparencyFilter::~TransparencyFilter()
 {
     // remove this filter
     FilterManager::getInstance().remove(*this);
+
+    // Stop the workers before the detection items release their jobs.
+    delete mpPool;
 }
 
 void TransparencyFilter::skipFilter(void)
@@ -431,6 +426,7 @@ void TransparencyFilter::skipFilter(void)
     {
         for (uint32_t i = 0; i < MAX_DETECT_LAYERS; i++)
         {
+            mDetection[i].cancelDetection(*mpPool);
             mDetection[i].garbageCollect();
         }
     }
@@ -486,6 +482,11 @@ const Content& TransparencyFilter::onApply(const Content& ref)
             mDetection[i].reset();
         }
     }
+    // Abandon any detection on layers that have gone since the last frame
+    for (uint32_t i = detectionNum; i < mDetectionNum; i++)
+    {
+        mDetection[i].cancelDetection(*mpPool);
+    }
     mDetectionNum = detectionNum;
 
     for (uint32_t i = 0; i < mDetectionNum; i++)
@@ -504,12 +505,18 @@ const Content& TransparencyFilter::onApply(const Content& ref)
             curD->mbFirstDisabledFrame = true;
             bNeedChangeRef = true;
             curD->mbEnabled = false;
-            curD->mpDetectionThread = NULL;
+            curD->cancelDetection(*mpPool);
+        }
+        else if (curD->mpDetectionJob != NULL && curD->mRepeatCount < curD->mFramesBeforeCheck)
+        {
+            // The layer changed or disappeared while the detection was pending, so the result is no longer useful.
+            ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "TransparencyFilter: %dth layer changed, cancel detection", i);
+            curD->cancelDetection(*mpPool);
         }
 
         const Content::LayerStack& layers = ref.getDisplay(0).getLayerStack();
         // If the repeat count matches, then we need to trigger a check for enable
-        if (curD->mpDetectionThread == NULL && curD->mRepeatCount == curD->mFramesBeforeCheck)
+        if (curD->mpDetectionJob == NULL && curD->mRepeatCount == curD->mFramesBeforeCheck)
         {
             // For some cases, there might have layers beneath video layer
             // If these layers are not transparent, we should combine their dst rect with video's
@@ -525,17 +532,18 @@ const Content& TransparencyFilter::onApply(const Content& ref)
             }
 
             ALOGD_IF(TRANSPARENCY_FILTER_DEBUG, "Start to detect %dth layer", i);
-            curD->initiateDetection(layers[i], activeRect);
+            curD->initiateDetection(layers[i], activeRect, *mpPool);
         }
 
-        if (!curD->mbEnabled && curD->mpDetectionThread != NULL && curD->mpDetectionThread->isFinished())
+        if (!curD->mbEnabled && curD->mpDetectionJob != NULL && curD->mpDetectionJob->isFinished())
         {
-            if (curD->mpDetectionThread->isDetected(&curD->mBlackMask) && curD->mRepeatCount >= curD->mFramesBeforeCheck)
+            mScanStats.add(curD->mpDetectionJob->getScanStats());
+            if (curD->mpDetectionJob->isDetected(&curD->mBlackMask) && curD->mRepeatCount >= curD->mFramesBeforeCheck)
             {
                 curD->mbEnabled = true;
                 curD->mbFirstEnabledFrame = true;
             }
-            curD->mpDetectionThread = NULL;
+            curD->mpDetectionJob = NULL;
         }
 
         if (curD->mbEnabled)
@@ -587,6 +595,8 @@ String8 TransparencyFilter::dump()
     {
         output += String8(" ") + mDetection[i].dump();
     }
+    output += String8(" ") + PixelScan::dumpStats(mScanStats);
+    output += String8(" ") + mpPool->dump();
 
     return output;
 }
@@ -19,6 +19,8 @@
 
 #include "AbstractFilter.h"
 #include "AbstractBufferManager.h"
+#include "PixelScan.h"
+#include "ScanPool.h"
 
 
 namespace intel {
@@ -38,7 +40,7 @@ public:
     String8 dump();
 
 private:
-    class DetectionThread;
+    class DetectionJob;
     class DetectionItem
     {
         friend TransparencyFilter;
@@ -47,7 +49,8 @@ private:
         virtual ~DetectionItem();
         void reset();
         void updateRepeatCounts(const Layer& ly);
-        void initiateDetection(const Layer& layer, hwc_frect_t videoRect);
+        void initiateDetection(const Layer& layer, hwc_frect_t videoRect, ScanPool& pool);
+        void cancelDetection(ScanPool& pool);
         void filterLayers(Content& ref);
         void garbageCollect(void);
         String8 dump();
@@ -58,8 +61,9 @@ private:
         uint32_t                mRepeatCount;
         bool                    mbEnabled;
         sp<GraphicBuffer>       mpLinearBuffer;
+        sp<ScanBuffer>          mpMappedBuffer;     // CPU mapping of mpLinearBuffer, retained across detections
         uint32_t                mFramesBeforeCheck;
-        sp<DetectionThread>     mpDetectionThread;
+        sp<DetectionJob>        mpDetectionJob;
         bool                    mbFirstEnabledFrame;
         bool                    mbFirstDisabledFrame;
     };
@@ -70,6 +74,11 @@ private:
     uint32_t            mDetectionNum;
 
     Content             mReference;
+
+    PixelScan::Stats    mScanStats;     // Accumulated scan statistics from completed detections
+
+    // Workers shared by all detection items.
+    ScanPool*           mpPool;
 };
 
 }; // namespace hwc
@@ -0,0 +1,183 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "VSyncPhaseScheduler.h"
+#include <stdlib.h>
+
+// Kernel sleep function - for some reason this isnt exported from bionic even
+// though its implemented there.
+extern "C" int clock_nanosleep(clockid_t clock_id, int flags,
+                           const struct timespec *request,
+                           struct timespec *remain);
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+VSyncPhaseScheduler::VSyncPhaseScheduler() :
+    mOptionStagger("vsyncstagger", 0, false)
+{
+}
+
+void VSyncPhaseScheduler::onVSync(uint32_t phyIndex, nsecs_t timestamp, nsecs_t period)
+{
+    ALOG_ASSERT(phyIndex < cMaxSupportedPhysicalDisplays);
+    Mutex::Autolock _l(mLock);
+    DisplayTiming& timing = maTiming[phyIndex];
+    timing.mTimestamp = timestamp;
+    timing.mPeriod = period;
+}
+
+void VSyncPhaseScheduler::reset(uint32_t phyIndex)
+{
+    ALOG_ASSERT(phyIndex < cMaxSupportedPhysicalDisplays);
+    Mutex::Autolock _l(mLock);
+    DisplayTiming& timing = maTiming[phyIndex];
+    timing.mTimestamp = 0;
+    timing.mPeriod = 0;
+}
+
+bool VSyncPhaseScheduler::isCurrent(const DisplayTiming& timing, nsecs_t now) const
+{
+    return (timing.mPeriod > 0) && (timing.mTimestamp > 0) && (now - timing.mTimestamp < cMaxTimestampAge);
+}
+
+nsecs_t VSyncPhaseScheduler::getComposeTime(uint32_t phyIndex, nsecs_t now, bool& bSkipped)
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    bSkipped = false;
+
+    const DisplayTiming& self = maTiming[phyIndex];
+    if (!isCurrent(self, now))
+    {
+        return now;
+    }
+
+    // Find this display's rank in the group of displays sharing its refresh.
+    uint32_t first = phyIndex;
+    uint32_t rank = 0;
+    uint32_t count = 0;
+    for (uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; ++d)
+    {
+        const DisplayTiming& other = maTiming[d];
+        if (!isCurrent(other, now) || (llabs(other.mPeriod - self.mPeriod) > cPeriodTolerance))
+        {
+            continue;
+        }
+        if (d < phyIndex)
+        {
+            if (rank == 0)
+            {
+                first = d;
+            }
+            ++rank;
+        }
+        ++count;
+    }
+    if (rank == 0)
+    {
+        return now;
+    }
+
+    // The phase point is measured from the first display's vsync, so displays whose vsyncs
+    // are not aligned still end up spread through the frame.
+    const DisplayTiming& reference = maTiming[first];
+    const nsecs_t period = reference.mPeriod;
+    nsecs_t composeTime = reference.mTimestamp + (period * rank) / count;
+    if (composeTime < now)
+    {
+        composeTime += ((now - composeTime + period - 1) / period) * period;
+    }
+
+    // Never hold the composition so long that the display misses its own next vsync.
+    const nsecs_t nextVSync = self.mTimestamp + ((now - self.mTimestamp) / self.mPeriod + 1) * self.mPeriod;
+    if (composeTime > nextVSync - cComposeMargin)
+    {
+        bSkipped = true;
+        return now;
+    }
+    return composeTime;
+}
+
+void VSyncPhaseScheduler::waitForComposePhase(uint32_t phyIndex)
+{
+    ALOG_ASSERT(phyIndex < cMaxSupportedPhysicalDisplays);
+    if (!mOptionStagger)
+    {
+        return;
+    }
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t composeTime;
+    {
+        Mutex::Autolock _l(mLock);
+        bool bSkipped;
+        composeTime = getComposeTime(phyIndex, now, bSkipped);
+
+        DisplayTiming& timing = maTiming[phyIndex];
+        ++timing.mComposes;
+        if (bSkipped)
+        {
+            ++timing.mSkippedComposes;
+        }
+        else if (composeTime > now)
+        {
+            const nsecs_t delay = composeTime - now;
+            ++timing.mStaggeredComposes;
+            timing.mTotalDelay += delay;
+            timing.mMaxDelay = max(timing.mMaxDelay, delay);
+        }
+    }
+
+    if (composeTime <= now)
+    {
+        return;
+    }
+
+    ATRACE_NAME_IF(DISPLAY_TRACE, "Compose stagger");
+    ALOGD_IF(VSYNC_DEBUG, "VSyncPhaseScheduler: P%u holding composition for %" PRIi64 "us", phyIndex, (composeTime - now) / 1000);
+
+    struct timespec spec;
+    spec.tv_sec  = composeTime / 1000000000;
+    spec.tv_nsec = composeTime % 1000000000;
+    int err;
+    do {
+        err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL);
+    } while (err == EINTR);
+}
+
+String8 VSyncPhaseScheduler::dump()
+{
+    Mutex::Autolock _l(mLock);
+    String8 output = String8::format("Compose stagger:%s", mOptionStagger ? "on" : "off");
+    for (uint32_t d = 0; d < cMaxSupportedPhysicalDisplays; ++d)
+    {
+        const DisplayTiming& timing = maTiming[d];
+        if (timing.mComposes == 0)
+        {
+            continue;
+        }
+        output.appendFormat(" P%u:[composes:%u staggered:%u skipped:%u avg:%" PRIi64 "us max:%" PRIi64 "us]",
+                            d, timing.mComposes, timing.mStaggeredComposes, timing.mSkippedComposes,
+                            timing.mStaggeredComposes ? timing.mTotalDelay / timing.mStaggeredComposes / 1000 : 0,
+                            timing.mMaxDelay / 1000);
+    }
+    return output;
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
@@ -0,0 +1,107 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_VSYNCPHASESCHEDULER_H
+#define INTEL_UFO_HWC_VSYNCPHASESCHEDULER_H
+
+#include "Common.h"
+#include "Option.h"
+#include "Singleton.h"
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// This class staggers composition across physical displays that run at the same refresh.
+// Left alone, the compositions for all displays are started by the same SurfaceFlinger set
+// and run on the GPU and VPP together, making memory traffic bursty.
+// Flip submission is not staggered: a flip completes at the display's own vblank whenever it
+// is issued, so holding the flip back only risks missing that vblank.
+// Each display reports its vsync (or page flip completion) timestamps. Displays with a recent
+// timestamp and a matching period form a group ordered by display manager index. The first
+// display in the group (normally the panel) is never delayed; the compositions for display
+// k of N are held until k/N of the way through the frame of the first display, so long as
+// that still leaves a margin to compose and flip before its own next vsync. Otherwise they
+// start immediately, so staggering never costs a display a frame.
+// Only compositions that run on the compose workers are held. SurfaceFlinger waits for each
+// display's compositions just before it sets that display, so earlier displays are set
+// while later ones are held.
+// Staggering is off by default and is enabled with the option intel.hwc.vsyncstagger.
+class VSyncPhaseScheduler : public Singleton<VSyncPhaseScheduler>
+{
+public:
+    static VSyncPhaseScheduler& get() { return getInstance(); }
+
+    // Record a vsync timestamp (CLOCK_MONOTONIC) for a display with the given refresh period.
+    void onVSync(uint32_t phyIndex, nsecs_t timestamp, nsecs_t period);
+
+    // Forget a display's timing, e.g. when it is unplugged or blanked.
+    void reset(uint32_t phyIndex);
+
+    // Called by a compose worker immediately before it composes for a display.
+    // Sleeps until the display's phase in the frame, if it has one.
+    void waitForComposePhase(uint32_t phyIndex);
+
+    String8 dump();
+
+private:
+    friend class Singleton<VSyncPhaseScheduler>;
+
+    VSyncPhaseScheduler();
+
+    // Timestamps older than this are not extrapolated.
+    static const nsecs_t cMaxTimestampAge = 500000000;
+    // Periods within this many ns of each other are treated as the same refresh.
+    static const nsecs_t cPeriodTolerance = 200000;
+    // A staggered composition must still start this long before the display's next vsync,
+    // leaving time to compose and then flip.
+    static const nsecs_t cComposeMargin = 8000000;
+
+    struct DisplayTiming
+    {
+        DisplayTiming() :
+            mTimestamp(0), mPeriod(0),
+            mComposes(0), mStaggeredComposes(0), mSkippedComposes(0), mTotalDelay(0), mMaxDelay(0) {}
+
+        nsecs_t     mTimestamp;         // Last vsync timestamp.
+        nsecs_t     mPeriod;            // Refresh period.
+
+        // Statistics.
+        uint32_t    mComposes;
+        uint32_t    mStaggeredComposes; // Compositions held back to the display's phase.
+        uint32_t    mSkippedComposes;   // Compositions not held because the phase was past the margin.
+        nsecs_t     mTotalDelay;
+        nsecs_t     mMaxDelay;
+    };
+
+    bool isCurrent(const DisplayTiming& timing, nsecs_t now) const;
+
+    // Return the time at which a display should start composing, which is now if it is not
+    // staggered. Sets bSkipped if a phase was assigned but has been missed.
+    // Lock must be held.
+    nsecs_t getComposeTime(uint32_t phyIndex, nsecs_t now, bool& bSkipped);
+
+    Option          mOptionStagger;
+
+    Mutex           mLock;
+    DisplayTiming   maTiming[ cMaxSupportedPhysicalDisplays ];
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_VSYNCPHASESCHEDULER_H
@@ -27,6 +27,255 @@ namespace intel {
 namespace ufo {
 namespace hwc {
 
+// Factory instance
+VideoModeDetectionFilter gVideoModeDetectionFilter;
+
+VideoModeDetectionFilter::VideoModeDetectionFilter() :
+    mOptionEnable( "videocadence", 1, false ),
+    mDetections( 0 )
+{
+    // Add this filter to the filter list
+    FilterManager::getInstance().add(*this, FilterPosition::VideoModeDetection);
+}
+
+VideoModeDetectionFilter::~VideoModeDetectionFilter()
+{
+    // remove this filter
+    FilterManager::getInstance().remove(*this);
+}
+
+void VideoModeDetectionFilter::DisplayState::reset()
+{
+    mHandle = NULL;
+    mLastUpdate = 0;
+    mNext = 0;
+    mCount = 0;
+    mMisses = 0;
+    mFps = 0;
+    mPulldownMin = 0;
+    mPulldownMax = 0;
+}
+
+int32_t VideoModeDetectionFilter::findFullscreenVideo( const Content::Display& display )
+{
+    const Content::LayerStack& layerStack = display.getLayerStack();
+    int32_t video = -1;
+    for ( uint32_t ly = 0; ly < layerStack.size(); ++ly )
+    {
+        const Layer& layer = layerStack.getLayer( ly );
+        if ( !layer.isEnabled() || !layer.isVideo() )
+            continue;
+        if ( video != -1 )
+        {
+            // More than one video layer (eg picture-in-picture). No single cadence.
+            return -1;
+        }
+        video = ly;
+    }
+    if ( video == -1 )
+        return -1;
+
+    if ( layerStack.getLayer( video ).isFullScreenVideo( display.getWidth(), display.getHeight() ) )
+    {
+        return video;
+    }
+    return -1;
+}
+
+uint32_t VideoModeDetectionFilter::snapToNominalFps( uint64_t measuredMilliHz )
+{
+    // NTSC rates (eg 23.976) are within tolerance of the integer rate.
+    static const uint32_t nominal[] = { 24, 25, 30, 48, 50, 60 };
+    for ( uint32_t i = 0; i < sizeof(nominal)/sizeof(nominal[0]); ++i )
+    {
+        const uint64_t target = nominal[i] * 1000;
+        const uint64_t tolerance = target * cRateTolerancePercent / 100;
+        if ( ( measuredMilliHz + tolerance >= target ) && ( measuredMilliHz <= target + tolerance ) )
+        {
+            return nominal[i];
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t intervalToRefreshes( nsecs_t interval, uint32_t refresh )
+{
+    // Round to the nearest number of refresh periods.
+    return (uint32_t)( ( interval * refresh + 500000000 ) / 1000000000 );
+}
+
+void VideoModeDetectionFilter::DisplayState::evaluate( uint32_t refresh, uint32_t& fps, uint32_t& pulldownMin, uint32_t& pulldownMax ) const
+{
+    fps = 0;
+    if ( mCount < cHistory )
+        return;
+
+    nsecs_t total = 0;
+    for ( uint32_t i = 0; i < cHistory; ++i )
+    {
+        total += mIntervals[i];
+    }
+    if ( total <= 0 )
+        return;
+
+    const uint32_t nominal = snapToNominalFps( (uint64_t)cHistory * 1000000000000ULL / total );
+    if ( nominal == 0 )
+        return;
+
+    // A steady cadence presents each frame for either floor or ceil of refresh/fps refreshes.
+    const uint32_t lo = max( 1U, refresh / nominal );
+    const uint32_t hi = ( refresh + nominal - 1 ) / nominal;
+    uint32_t seenMin = ~0U;
+    uint32_t seenMax = 0;
+    for ( uint32_t i = 0; i < cHistory; ++i )
+    {
+        const uint32_t n = intervalToRefreshes( mIntervals[i], refresh );
+        if ( ( n < lo ) || ( n > max( lo, hi ) ) )
+        {
+            return;
+        }
+        seenMin = min( seenMin, n );
+        seenMax = max( seenMax, n );
+    }
+
+    fps = nominal;
+    pulldownMin = seenMin;
+    pulldownMax = seenMax;
+}
+
+bool VideoModeDetectionFilter::DisplayState::update( nsecs_t now, uint32_t refresh )
+{
+    const uint32_t oldFps = mFps;
+    const nsecs_t interval = now - mLastUpdate;
+    const bool bFirst = ( mLastUpdate == 0 );
+    mLastUpdate = now;
+
+    if ( bFirst || ( interval <= 0 ) )
+    {
+        return false;
+    }
+
+    if ( interval > cPauseTimeout )
+    {
+        // Restart detection after a pause or seek.
+        mCount = 0;
+        mNext = 0;
+        mMisses = 0;
+        mFps = 0;
+        return ( oldFps != mFps );
+    }
+
+    mIntervals[ mNext ] = interval;
+    mNext = ( mNext + 1 ) % cHistory;
+    if ( mCount < cHistory )
+    {
+        ++mCount;
+    }
+
+    if ( mFps )
+    {
+        // Check that the latest interval is consistent with the published cadence.
+        // Tolerate the odd late or dropped frame.
+        const uint32_t n = intervalToRefreshes( interval, refresh );
+        if ( ( n >= mPulldownMin ) && ( n <= mPulldownMax ) )
+        {
+            mMisses = 0;
+        }
+        else if ( ++mMisses >= cMaxMisses )
+        {
+            mFps = 0;
+            mMisses = 0;
+            mCount = 0;
+            mNext = 0;
+        }
+    }
+
+    if ( mFps == 0 )
+    {
+        evaluate( refresh, mFps, mPulldownMin, mPulldownMax );
+    }
+
+    ALOGD_IF( FILTER_DEBUG && ( oldFps != mFps ),
+              "VideoModeDetectionFilter: cadence %u -> %u (%u:%u @ %uHz)", oldFps, mFps, mPulldownMin, mPulldownMax, refresh );
+    return ( oldFps != mFps );
+}
+
+const Content& VideoModeDetectionFilter::onApply(const Content& ref)
+{
+    for ( uint32_t d = 0; d < cMaxSupportedSFDisplays; ++d )
+    {
+        DisplayState& state = mDisplayState[d];
+        const uint32_t oldFps = state.mFps;
+
+        if ( !mOptionEnable || ( d >= ref.size() ) || !ref.getDisplay(d).isEnabled() )
+        {
+            state.reset();
+        }
+        else
+        {
+            const Content::Display& display = ref.getDisplay(d);
+            const uint32_t refresh = display.getRefresh() ? display.getRefresh() : INTEL_HWC_DEFAULT_REFRESH_RATE;
+            const nsecs_t now = display.getFrameReceivedTime();
+            const int32_t video = findFullscreenVideo( display );
+
+            if ( video == -1 )
+            {
+                state.reset();
+            }
+            else
+            {
+                const buffer_handle_t handle = display.getLayerStack().getLayer( video ).getHandle();
+                if ( handle != state.mHandle )
+                {
+                    state.mHandle = handle;
+                    state.update( now, refresh );
+                }
+                else if ( state.mFps && ( now - state.mLastUpdate > cPauseTimeout ) )
+                {
+                    // Paused.
+                    state.mFps = 0;
+                    state.mCount = 0;
+                    state.mNext = 0;
+                }
+            }
+        }
+
+        if ( state.mFps && ( state.mFps != oldFps ) )
+        {
+            ++mDetections;
+        }
+    }
+
+    // The content is passed through unmodified. The InputAnalyzer publishes the cadence
+    // on the next frame (see getCadence), so the content is not copied to carry it.
+    return ref;
+}
+
+void VideoModeDetectionFilter::getCadence( uint32_t d, uint32_t& fps, uint32_t& pulldownMin, uint32_t& pulldownMax )
+{
+    fps = pulldownMin = pulldownMax = 0;
+    if ( d < cMaxSupportedSFDisplays )
+    {
+        const DisplayState& state = gVideoModeDetectionFilter.mDisplayState[d];
+        fps = state.mFps;
+        pulldownMin = state.mPulldownMin;
+        pulldownMax = state.mPulldownMax;
+    }
+}
+
+String8 VideoModeDetectionFilter::dump()
+{
+    String8 output = String8::format( "Detections:%u", mDetections );
+    for ( uint32_t d = 0; d < cMaxSupportedSFDisplays; ++d )
+    {
+        const DisplayState& state = mDisplayState[d];
+        if ( state.mFps )
+        {
+            output.appendFormat( " D%u:%ufps/%u:%u", d, state.mFps, state.mPulldownMin, state.mPulldownMax );
+        }
+    }
+    return output;
+}
 
 }; // namespace hwc
 }; // namespace ufo
@@ -18,12 +18,71 @@
 #define INTEL_UFO_HWC_VIDEOMODEDETECTIONFILTER_H
 
 #include "AbstractFilter.h"
+#include "Option.h"
 
 namespace intel {
 namespace ufo {
 namespace hwc {
 
+// This filter detects fullscreen video playback and the cadence at which the video
+// layer is being updated (eg 24fps with 3:2 pulldown on a 60Hz display).
+// The content is passed through unmodified. The result is published as a video cadence hint
+// on each Content::Display by the InputAnalyzer, which reads it with getCadence.
+// The plane allocator uses the hint to keep the video on a plane without pre-processing.
+class VideoModeDetectionFilter : public AbstractFilter
+{
+public:
+    VideoModeDetectionFilter();
+    virtual ~VideoModeDetectionFilter();
 
+    const char* getName() const { return "VideoModeDetectionFilter"; }
+    const Content& onApply(const Content& ref);
+    String8 dump();
+
+    // Get the cadence detected on SF display d up to the last frame (fps is 0 if none).
+    static void getCadence( uint32_t d, uint32_t& fps, uint32_t& pulldownMin, uint32_t& pulldownMax );
+
+private:
+    // Number of frame intervals used to detect the cadence.
+    static const uint32_t cHistory = 16;
+    // Number of consecutive inconsistent intervals before a detected cadence is dropped.
+    static const uint32_t cMaxMisses = 4;
+    // Video updates stalled for longer than this are treated as paused.
+    static const nsecs_t cPauseTimeout = 250000000;
+    // Tolerance when matching the measured rate to a nominal rate (percent).
+    static const uint32_t cRateTolerancePercent = 3;
+
+    // Returns the index of the single fullscreen video layer in the display or -1.
+    static int32_t findFullscreenVideo( const Content::Display& display );
+
+    // Snap a measured rate (in mHz) to a nominal video rate or return 0 if there is no match.
+    static uint32_t snapToNominalFps( uint64_t measuredMilliHz );
+
+    // Helper struct to contain per display state
+    struct DisplayState
+    {
+        DisplayState() { reset(); }
+        void reset();
+        // Record a video frame update. Returns true if the published cadence changed.
+        bool update( nsecs_t now, uint32_t refresh );
+        // Checks the history for a stable cadence.
+        void evaluate( uint32_t refresh, uint32_t& fps, uint32_t& pulldownMin, uint32_t& pulldownMax ) const;
+
+        buffer_handle_t mHandle;                // Last video handle.
+        nsecs_t         mLastUpdate;            // Time of last video handle change.
+        nsecs_t         mIntervals[cHistory];   // Ring of intervals between handle changes.
+        uint32_t        mNext;                  // Next interval slot.
+        uint32_t        mCount;                 // Number of valid intervals.
+        uint32_t        mMisses;                // Consecutive intervals inconsistent with the cadence.
+        uint32_t        mFps;                   // Published cadence.
+        uint32_t        mPulldownMin;
+        uint32_t        mPulldownMax;
+    };
+
+    Option          mOptionEnable;
+    DisplayState    mDisplayState[cMaxSupportedSFDisplays];
+    uint32_t        mDetections;                // Number of times a cadence was detected.
+};
 
 }; // namespace hwc
 }; // namespace ufo
@@ -74,17 +74,15 @@ const Content& VisibleRectFilter::onApply(const Content& ref)
                 ALOGD_IF ( VISIBLERECTFILTER_DEBUG, "\nBegin to clip layer in D%d: \n%s", d, layer.dump("").string());
 
                 // Copy layer
-                displayState.mLayers[ly] = layer;
-                displayState.mLayers[ly].onUpdateFrameState(layer);
+                Layer& clipped = layerStack.editLayer(ly, displayState.mLayers);
 
                 // Clip src/dst with visible regions
                 //    case 1: visible region is zero, remove this layer
                 //    case 2: visible region is non-zero, clip dst and src rect to match visible region
-                isVisibleLayer = clipLayerToDestRect( &displayState.mLayers[ly], visibleRect );
-                ALOGD_IF ( VISIBLERECTFILTER_DEBUG, "Clipped layer to visible region: \n%s", displayState.mLayers[ly].dump("").string());
+                isVisibleLayer = clipLayerToDestRect( &clipped, visibleRect );
+                ALOGD_IF ( VISIBLERECTFILTER_DEBUG, "Clipped layer to visible region: \n%s", clipped.dump("").string());
                 if( isVisibleLayer )
                 {
-                   layerStack.setLayer(ly, &displayState.mLayers[ly]);
                    ly++;
                    ALOGD_IF ( VISIBLERECTFILTER_DEBUG,"Clip layer to visible region.");
                 }
@@ -144,7 +142,7 @@ bool VisibleRectFilter::displayStatePrepare( uint32_t d, uint32_t layerCount)
 // Figure out the smallest box that can cover all visible rects of this layer
 hwc_rect_t VisibleRectFilter::getVisibleRegionBoundingBox(const Layer& layer)
 {
-    const Vector<hwc_rect_t>& visibleRegions = layer.getVisibleRegions();
+    const Layer::VisibleRegions& visibleRegions = layer.getVisibleRegions();
     hwc_rect_t visibleRect = visibleRegions[0];
     for (uint32_t r = 1; r < visibleRegions.size(); r++)
     {
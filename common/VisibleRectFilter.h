@@ -33,6 +33,8 @@ public:
 
     const char* getName() const { return "VisibleRectFilter"; }
     const Content& onApply(const Content& ref);
+    // The output is purely a function of the input.
+    bool getDependencySignature( uint64_t& signature ) const { signature = 0; return true; }
     String8 dump();
 protected:
     bool displayStatePrepare( uint32_t d, uint32_t layerCount);
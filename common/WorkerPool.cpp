@@ -0,0 +1,150 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "Common.h"
+#include "ThreadManager.h"
+#include "WorkerPool.h"
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+WorkerPool::WorkerPool(const char* pchName, uint32_t workers, int32_t priority) :
+    mpchName(pchName),
+    mWorkers(workers),
+    mPriority(priority),
+    mbStarted(false),
+    mbExit(false),
+    mSubmitted(0),
+    mRunByWaiter(0)
+{
+    mQueue.reserve(8);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        Mutex::Autolock _l(mLock);
+        ALOG_ASSERT(mQueue.empty(), "WorkerPool %s destroyed with queued jobs", mpchName);
+        mbExit = true;
+        mWork.broadcast();
+    }
+    for (sp<Worker>& pWorker : mpWorkers)
+    {
+        pWorker->requestExitAndWait();
+        pWorker = NULL;
+    }
+}
+
+void WorkerPool::start()
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    if (mbStarted)
+        return;
+    mpWorkers.resize(mWorkers);
+    for (uint32_t w = 0; w < mWorkers; w++)
+    {
+        mpWorkers[w] = new Worker(*this);
+        mpWorkers[w]->run(String8::format("%s_thread%u", mpchName, w).string(), mPriority);
+    }
+    mbStarted = true;
+}
+
+void WorkerPool::submit(Job& job)
+{
+    Mutex::Autolock _l(mLock);
+    ALOG_ASSERT((job.mState != Job::QUEUED) && (job.mState != Job::RUNNING));
+    start();
+    job.mState = Job::QUEUED;
+    mQueue.push_back(&job);
+    ++mSubmitted;
+    mWork.signal();
+}
+
+void WorkerPool::run(Job& job)
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
+    job.mState = Job::RUNNING;
+    mLock.unlock();
+    job.onRun();
+    mLock.lock();
+    job.mState = Job::DONE;
+    mDone.broadcast();
+}
+
+void WorkerPool::wait(Job& job)
+{
+    Mutex::Autolock _l(mLock);
+    if (job.mState == Job::QUEUED)
+    {
+        // Nobody has started it yet, so run it here rather than wait for a worker.
+        for (uint32_t j = 0; j < mQueue.size(); j++)
+        {
+            if (mQueue[j] == &job)
+            {
+                mQueue.erase(mQueue.begin() + j);
+                break;
+            }
+        }
+        ++mRunByWaiter;
+        run(job);
+    }
+    while (job.mState == Job::RUNNING)
+    {
+        mDone.wait(mLock);
+    }
+    ALOG_ASSERT(job.mState != Job::QUEUED);
+    job.mState = Job::IDLE;
+}
+
+bool WorkerPool::runNextJob()
+{
+    Mutex::Autolock _l(mLock);
+    while (mQueue.empty() && !mbExit)
+    {
+        mWork.wait(mLock);
+    }
+    if (mbExit)
+        return false;
+
+    // First come first served.
+    Job* pJob = mQueue.front();
+    mQueue.erase(mQueue.begin());
+    run(*pJob);
+    return true;
+}
+
+status_t WorkerPool::Worker::readyToRun()
+{
+    ThreadManager::get().registerThread(ThreadManager::eThreadFrame);
+    return NO_ERROR;
+}
+
+bool WorkerPool::Worker::threadLoop()
+{
+    return mPool.runNextJob();
+}
+
+String8 WorkerPool::dump()
+{
+    Mutex::Autolock _l(mLock);
+    return String8::format("Pool:%u Queued:%zu Submitted:%u RunByWaiter:%u",
+                           mbStarted ? mWorkers : 0, mQueue.size(), mSubmitted, mRunByWaiter);
+}
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
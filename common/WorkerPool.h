@@ -0,0 +1,108 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef INTEL_UFO_HWC_WORKERPOOL_H
+#define INTEL_UFO_HWC_WORKERPOOL_H
+
+#include "Common.h"
+#include <utils/Thread.h>
+#include <vector>
+
+namespace intel {
+namespace ufo {
+namespace hwc {
+
+// Fixed size pool of workers used to spread the work of a frame across threads.
+// Unlike the ScanPool, this is for work on the frame's critical path: the workers run at the
+// priority requested and every job is waited for within the frame.
+// Jobs are owned by the caller and are not copied, so submitting a job makes no allocation.
+// A job must not be destroyed or resubmitted until it has been waited for.
+// The workers are started on first use.
+class WorkerPool : NonCopyable
+{
+public:
+    class Job
+    {
+    public:
+        Job() : mState(IDLE) { }
+        virtual ~Job() { }
+
+    protected:
+        // Perform the job. Called from a worker or from the thread that waits for it.
+        virtual void onRun() = 0;
+
+    private:
+        friend class WorkerPool;
+        enum EState { IDLE, QUEUED, RUNNING, DONE };
+        EState          mState;
+    };
+
+    WorkerPool(const char* pchName, uint32_t workers, int32_t priority);
+    ~WorkerPool();
+
+    // Queue a job for the workers.
+    void submit(Job& job);
+
+    // Wait for a submitted job to complete.
+    // If no worker has picked the job up yet then it is run by the calling thread.
+    void wait(Job& job);
+
+    String8 dump();
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(WorkerPool& pool) : mPool(pool) { }
+    private:
+        virtual status_t readyToRun();
+        virtual bool threadLoop();
+        WorkerPool& mPool;
+    };
+
+    // Start the workers on first use.
+    // Lock must be held.
+    void start();
+
+    // Block until a job is available and run it. Returns false if the pool is stopping.
+    bool runNextJob();
+
+    // Run a job that has been taken from the queue.
+    // Lock must be held; it is released while the job runs.
+    void run(Job& job);
+
+    const char*                     mpchName;
+    const uint32_t                  mWorkers;
+    const int32_t                   mPriority;
+
+    Mutex                           mLock;
+    Condition                       mWork;
+    Condition                       mDone;
+    std::vector<Job*>               mQueue;
+    std::vector< sp<Worker> >       mpWorkers;
+    bool                            mbStarted:1;
+    bool                            mbExit:1;
+
+    // Statistics.
+    uint32_t                        mSubmitted;
+    uint32_t                        mRunByWaiter;       // Jobs run by the waiting thread.
+};
+
+}; // namespace hwc
+}; // namespace ufo
+}; // namespace intel
+
+#endif // INTEL_UFO_HWC_WORKERPOOL_H
@@ -24,6 +24,7 @@
 #include "AbstractPlatform.h"
 #include "HwcService.h"
 #include "DisplayState.h"
+#include "VSyncPhaseScheduler.h"
 #include <drm_fourcc.h>
 #include <cutils/properties.h>
 #include <math.h>
@@ -849,14 +850,34 @@ void DrmDisplay::allocateBlankingLayer( uint32_t width, uint32_t height )
     mBlankBufferFramesSinceLastUsed = 0;
 }
 
-void DrmDisplay::vsyncEvent(unsigned int, unsigned int, unsigned int)
+void DrmDisplay::vsyncEvent(unsigned int, unsigned int sec, unsigned int usec)
 {
     DRMDISPLAY_ASSERT_EXTERNAL_THREAD
     ATRACE_NAME("DrmDisplay::vsyncEvent");
     nsecs_t time = systemTime(SYSTEM_TIME_MONOTONIC);
+    notifyVSyncPhase( sec, usec );
     mPhysicalDisplayManager.notifyPhysicalVSync( this, time );
 }
 
+void DrmDisplay::notifyVSyncPhase( unsigned int sec, unsigned int usec )
+{
+    // Zero if the kernel did not provide a timestamp.
+    if ( sec || usec )
+    {
+        VSyncPhaseScheduler::get().onVSync( getDisplayManagerIndex(),
+                                            seconds_to_nanoseconds( sec ) + microseconds_to_nanoseconds( usec ),
+                                            getVSyncPeriod() );
+    }
+}
+
+void DrmDisplay::pageFlipEvent( unsigned int sec, unsigned int usec )
+{
+    // Page flips complete at vblank, so they keep the phase current for displays
+    // that do not have vsync events enabled.
+    notifyVSyncPhase( sec, usec );
+    mPageFlipHandler.pageFlipEvent();
+}
+
 void DrmDisplay::dropAllFrames( void )
 {
     ALOGD_IF( DRM_DEBUG, "DRMDisplay " DRMDISPLAY_ID_STR " dropAllFrames( )", DRMDISPLAY_ID_PARAMS );
@@ -1388,6 +1409,9 @@ void DrmDisplay::resetDisplay( void )
     // Release miscellaneous Drm resources.
     releaseDrmResources( );
 
+    // Stop staggering other displays' compositions against this one.
+    VSyncPhaseScheduler::get().reset( getDisplayManagerIndex() );
+
     // Display is now 'suspended'.
     setStatus( SUSPENDED );
 }
@@ -138,7 +138,8 @@ public:
     void vsyncEvent(unsigned int frame, unsigned int sec, unsigned int usec);
 
     // This must be called when a page flip event is received for this display.
-    void pageFlipEvent( void ) { mPageFlipHandler.pageFlipEvent(); }
+    // The timestamp is the time of the vblank at which the flip completed.
+    void pageFlipEvent( unsigned int sec, unsigned int usec );
 
     // Returns true if the display is attached and available.
     bool isAvailable( void ) const { return ( meStatus == AVAILABLE ); }
@@ -405,6 +406,9 @@ private:
     // Called from page flip handler to release the old frame when a new frame has been flipped.
     void releaseFlippedFrame( Frame* pOldFrame );
 
+    // Pass a vblank timestamp from a vsync or page flip event to the VSyncPhaseScheduler.
+    void notifyVSyncPhase( unsigned int sec, unsigned int usec );
+
     // Implements DisplayQueue::syncFlip( ).
     // This is called from the DisplayQueue worker to ensure the most recent Drm flip has completed.
     virtual void syncFlip( void );
@@ -17,6 +17,7 @@
 #include "DrmEventThread.h"
 #include "DrmDisplay.h"
 #include "Drm.h"
+#include "ThreadManager.h"
 
 #include <utils/Atomic.h>
 #include <utils/Thread.h>
@@ -220,7 +221,7 @@ void DrmEventThread::vblank_handler(int, unsigned int frame, unsigned int sec, u
     ALOG_ASSERT( false );
 }
 
-void DrmEventThread::page_flip_handler(int, unsigned int, unsigned int, unsigned int, void *data)
+void DrmEventThread::page_flip_handler(int, unsigned int, unsigned int sec, unsigned int usec, void *data)
 {
     ATRACE_CALL_IF(DISPLAY_TRACE);
     static Drm& drm = Drm::get();
@@ -230,7 +231,7 @@ void DrmEventThread::page_flip_handler(int, unsigned int, unsigned int, unsigned
         DrmDisplay* pDisplay = drm.getDrmDisplay( displayIndex );
         if ( pDisplay )
         {
-            pDisplay->pageFlipEvent();
+            pDisplay->pageFlipEvent( sec, usec );
             return;
         }
     }
@@ -256,6 +257,12 @@ void DrmEventThread::onFirstRef()
     run("DrmEventThread", PRIORITY_URGENT_DISPLAY + PRIORITY_MORE_FAVORABLE);
 }
 
+status_t DrmEventThread::readyToRun()
+{
+    ThreadManager::get().registerThread(ThreadManager::eThreadVsync, "DrmEventThread");
+    return NO_ERROR;
+}
+
 bool DrmEventThread::enableVSync(DrmDisplay* pDisp)
 {
     ALOG_ASSERT( pDisp );
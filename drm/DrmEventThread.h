@@ -41,6 +41,7 @@ class DrmEventThread : public Thread
     int             mDrmFd;
 
     virtual void onFirstRef();
+    virtual status_t readyToRun();
     virtual bool threadLoop();
 
 public:
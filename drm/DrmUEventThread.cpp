@@ -22,6 +22,7 @@
 #include "DrmDisplay.h"
 #include "AbstractPlatform.h"
 #include "HwcService.h"
+#include "ThreadManager.h"
 
 #include <sys/socket.h>
 #include <linux/netlink.h>
@@ -79,6 +80,8 @@ void DrmUEventThread::onFirstRef()
 
 status_t DrmUEventThread::readyToRun()
 {
+    ThreadManager::get().registerThread(ThreadManager::eThreadEvent, "hwc.uevent");
+
     struct sockaddr_nl addr;
     memset(&addr, 0, sizeof(addr));
     addr.nl_family = AF_NETLINK;
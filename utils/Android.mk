@@ -54,3 +54,9 @@ LOCAL_MODULE:= hwcprotect
 LOCAL_SRC_FILES:= Protect.cpp
 include $(LOCAL_PATH)/../Android.common.mk
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE:= hwcworkload
+LOCAL_SRC_FILES:= Workload.cpp
+include $(LOCAL_PATH)/../Android.common.mk
+include $(BUILD_EXECUTABLE)
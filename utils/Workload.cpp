@@ -0,0 +1,595 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Synthetic workload generator for the HWC.
+// This loads the HWC HAL directly and drives it with generated display contents at a fixed
+// rate, so that the composition paths can be characterised without SurfaceFlinger.
+// SurfaceFlinger must be stopped first (adb shell stop). If no display is connected, the HWC
+// runs on its FakeDisplay.
+
+#include <hardware/hardware.h>
+#include <hardware/hwcomposer.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Timers.h>
+#include <sync/sync.h>
+#include "ufo/graphics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace android;
+
+static const uint32_t cMaxDisplays = HWC_NUM_PHYSICAL_DISPLAY_TYPES;
+static const uint32_t cMaxConfigs = 64;
+static const int cRetireTimeoutMs = 1000;
+
+// A generated layer with a pair of buffers that are flipped every frame.
+struct WorkloadLayer
+{
+    sp<GraphicBuffer>   mpBuffers[2];
+    uint32_t            mCurrent;
+    uint32_t            mFormat;
+    uint32_t            mBlending;
+    hwc_frect_t         mSrc;
+    hwc_rect_t          mDst;
+    bool                mbVideo;
+};
+
+// Generated state for one display.
+struct WorkloadDisplay
+{
+    WorkloadDisplay() : mbConnected(false), mWidth(0), mHeight(0), mVsyncPeriod(0), mNumConfigs(0), mConfig(0), mpContents(NULL) {}
+
+    bool                        mbConnected;
+    uint32_t                    mWidth;
+    uint32_t                    mHeight;
+    nsecs_t                     mVsyncPeriod;
+    uint32_t                    maConfigs[cMaxConfigs];
+    size_t                      mNumConfigs;
+    uint32_t                    mConfig;
+    std::vector<WorkloadLayer>  mLayers;
+    sp<GraphicBuffer>           mpTarget;
+    hwc_display_contents_1_t*   mpContents;
+};
+
+// Workload parameters
+struct WorkloadParams
+{
+    uint32_t    frames      = 600;
+    uint32_t    rate        = 60;
+    uint32_t    layers      = 6;
+    uint32_t    video       = 1;
+    uint32_t    format      = HAL_PIXEL_FORMAT_RGBA_8888;
+    uint32_t    scale       = 0;
+    uint32_t    geometry    = 0;
+    uint32_t    hotplug     = 0;
+    uint32_t    modechange  = 0;
+    uint32_t    seed        = 1;
+    bool        bSync       = false;
+    bool        bQuiet      = false;
+};
+
+// Callback state. Hotplugs are recorded here and processed by the main loop between frames.
+static std::atomic<uint32_t> sHotplugPending(0);
+static std::atomic<uint32_t> sHotplugConnected(0);
+static std::atomic<uint32_t> sVsyncs(0);
+static std::atomic<uint32_t> sInvalidates(0);
+
+static void procInvalidate(const struct hwc_procs* /*procs*/)
+{
+    ++sInvalidates;
+}
+
+static void procVsync(const struct hwc_procs* /*procs*/, int /*disp*/, int64_t /*timestamp*/)
+{
+    ++sVsyncs;
+}
+
+static void procHotplug(const struct hwc_procs* /*procs*/, int disp, int connected)
+{
+    if ((disp < 0) || (uint32_t(disp) >= cMaxDisplays))
+        return;
+    if (connected)
+        sHotplugConnected |= (1 << disp);
+    else
+        sHotplugConnected &= ~(1 << disp);
+    sHotplugPending |= (1 << disp);
+}
+
+static const hwc_procs_t sProcs = { procInvalidate, procVsync, procHotplug };
+
+static uint32_t randomRange(uint32_t& seed, uint32_t range)
+{
+    return range ? (uint32_t(rand_r(&seed)) % range) : 0;
+}
+
+static bool allocateLayer(WorkloadLayer& layer, uint32_t bufferWidth, uint32_t bufferHeight)
+{
+    const uint32_t usage = GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_TEXTURE;
+    for (uint32_t b = 0; b < 2; ++b)
+    {
+        layer.mpBuffers[b] = new GraphicBuffer(bufferWidth, bufferHeight, layer.mFormat, usage);
+        if ((layer.mpBuffers[b] == NULL) || (layer.mpBuffers[b]->initCheck() != NO_ERROR))
+        {
+            printf("Failed to allocate %ux%u buffer format %u\n", bufferWidth, bufferHeight, layer.mFormat);
+            return false;
+        }
+    }
+    layer.mCurrent = 0;
+    layer.mSrc.left = 0;
+    layer.mSrc.top = 0;
+    layer.mSrc.right = bufferWidth;
+    layer.mSrc.bottom = bufferHeight;
+    return true;
+}
+
+// Place a layer of the given size somewhere on the display.
+static void placeLayer(WorkloadLayer& layer, const WorkloadDisplay& display, uint32_t w, uint32_t h, uint32_t& seed)
+{
+    layer.mDst.left = randomRange(seed, display.mWidth - w + 1);
+    layer.mDst.top = randomRange(seed, display.mHeight - h + 1);
+    layer.mDst.right = layer.mDst.left + w;
+    layer.mDst.bottom = layer.mDst.top + h;
+}
+
+static bool queryDisplay(hwc_composer_device_1_t* pDev, uint32_t d, WorkloadDisplay& display)
+{
+    display.mNumConfigs = cMaxConfigs;
+    if ((pDev->getDisplayConfigs(pDev, d, display.maConfigs, &display.mNumConfigs) != 0) || (display.mNumConfigs == 0))
+    {
+        printf("Display %u: no configs\n", d);
+        return false;
+    }
+
+    uint32_t config = display.maConfigs[0];
+#if defined(HWC_DEVICE_API_VERSION_1_4)
+    int active = pDev->getActiveConfig(pDev, d);
+    if ((active >= 0) && (uint32_t(active) < display.mNumConfigs))
+    {
+        display.mConfig = active;
+        config = display.maConfigs[active];
+    }
+#endif
+
+    const uint32_t attributes[] = { HWC_DISPLAY_WIDTH, HWC_DISPLAY_HEIGHT, HWC_DISPLAY_VSYNC_PERIOD, HWC_DISPLAY_NO_ATTRIBUTE };
+    int32_t values[3] = { 0, 0, 0 };
+    if (pDev->getDisplayAttributes(pDev, d, config, attributes, values) != 0)
+    {
+        printf("Display %u: failed to query attributes\n", d);
+        return false;
+    }
+    display.mWidth = values[0];
+    display.mHeight = values[1];
+    display.mVsyncPeriod = values[2];
+    return (display.mWidth > 0) && (display.mHeight > 0);
+}
+
+// Generate the layers for a display and allocate its contents structure.
+static bool createDisplay(hwc_composer_device_1_t* pDev, uint32_t d, WorkloadDisplay& display, const WorkloadParams& params, uint32_t& seed)
+{
+    if (!queryDisplay(pDev, d, display))
+        return false;
+
+    const uint32_t layerCount = std::max(params.layers, 1u);
+    display.mLayers.resize(layerCount);
+    for (uint32_t ly = 0; ly < layerCount; ++ly)
+    {
+        WorkloadLayer& layer = display.mLayers[ly];
+        uint32_t w, h, bufferWidth, bufferHeight;
+
+        // The bottom layer is a full screen opaque background, the top params.video layers
+        // above it are video and anything else is a partial screen blended UI layer.
+        layer.mbVideo = (ly > 0) && (ly <= params.video);
+        if (ly == 0)
+        {
+            w = display.mWidth;
+            h = display.mHeight;
+            layer.mFormat = params.format;
+            layer.mBlending = HWC_BLENDING_NONE;
+        }
+        else if (layer.mbVideo)
+        {
+            w = display.mWidth / 2 + randomRange(seed, display.mWidth / 2);
+            h = std::min(w * 9 / 16, display.mHeight);
+            layer.mFormat = HAL_PIXEL_FORMAT_NV12_Y_TILED_INTEL;
+            layer.mBlending = HWC_BLENDING_NONE;
+        }
+        else
+        {
+            w = display.mWidth / 4 + randomRange(seed, display.mWidth / 4);
+            h = display.mHeight / 4 + randomRange(seed, display.mHeight / 4);
+            layer.mFormat = params.format;
+            layer.mBlending = HWC_BLENDING_PREMULT;
+        }
+
+        // Video is always scaled, UI layers are scaled by 1.5x if chosen.
+        if (layer.mbVideo)
+        {
+            bufferWidth = 1280;
+            bufferHeight = 720;
+        }
+        else if (randomRange(seed, 100) < params.scale)
+        {
+            bufferWidth = std::max(w * 2 / 3, 1u);
+            bufferHeight = std::max(h * 2 / 3, 1u);
+        }
+        else
+        {
+            bufferWidth = w;
+            bufferHeight = h;
+        }
+
+        if (!allocateLayer(layer, bufferWidth, bufferHeight))
+            return false;
+        placeLayer(layer, display, w, h, seed);
+    }
+
+    display.mpTarget = new GraphicBuffer(display.mWidth, display.mHeight, HAL_PIXEL_FORMAT_RGBA_8888,
+                                         GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_FB);
+    if ((display.mpTarget == NULL) || (display.mpTarget->initCheck() != NO_ERROR))
+    {
+        printf("Display %u: failed to allocate framebuffer target\n", d);
+        return false;
+    }
+
+    // Layers plus the framebuffer target.
+    const uint32_t numHwLayers = layerCount + 1;
+    display.mpContents = (hwc_display_contents_1_t*)calloc(1, sizeof(hwc_display_contents_1_t) + numHwLayers * sizeof(hwc_layer_1_t));
+    if (display.mpContents == NULL)
+        return false;
+    display.mpContents->numHwLayers = numHwLayers;
+    display.mpContents->retireFenceFd = -1;
+    display.mbConnected = true;
+
+    printf("Display %u: %ux%u vsync %" PRId64 "ns, %u layers (%u video), %zu configs\n",
+        d, display.mWidth, display.mHeight, display.mVsyncPeriod, layerCount,
+        std::min(params.video, layerCount - 1), display.mNumConfigs);
+    return true;
+}
+
+static void destroyDisplay(WorkloadDisplay& display)
+{
+    free(display.mpContents);
+    display.mpContents = NULL;
+    display.mLayers.clear();
+    display.mpTarget = NULL;
+    display.mbConnected = false;
+}
+
+static void setupLayer(hwc_layer_1_t& hwLayer, buffer_handle_t handle, const hwc_frect_t& src, const hwc_rect_t& dst, uint32_t blending, bool bGeometryChanged)
+{
+    if (bGeometryChanged)
+    {
+        hwLayer.compositionType = HWC_FRAMEBUFFER;
+        hwLayer.hints = 0;
+    }
+    hwLayer.flags = 0;
+    hwLayer.handle = handle;
+    hwLayer.transform = 0;
+    hwLayer.blending = blending;
+    hwLayer.sourceCropf = src;
+    hwLayer.displayFrame = dst;
+    hwLayer.visibleRegionScreen.numRects = 1;
+    hwLayer.visibleRegionScreen.rects = &hwLayer.displayFrame;
+    hwLayer.acquireFenceFd = -1;
+    hwLayer.releaseFenceFd = -1;
+    hwLayer.planeAlpha = 0xFF;
+}
+
+// Fill in the contents for the next frame.
+static void updateContents(WorkloadDisplay& display, bool bGeometryChanged)
+{
+    hwc_display_contents_1_t& contents = *display.mpContents;
+    contents.flags = bGeometryChanged ? HWC_GEOMETRY_CHANGED : 0;
+    contents.retireFenceFd = -1;
+
+    for (uint32_t ly = 0; ly < display.mLayers.size(); ++ly)
+    {
+        WorkloadLayer& layer = display.mLayers[ly];
+        layer.mCurrent ^= 1;
+        setupLayer(contents.hwLayers[ly], layer.mpBuffers[layer.mCurrent]->handle, layer.mSrc, layer.mDst, layer.mBlending, bGeometryChanged);
+    }
+
+    hwc_frect_t src = { 0, 0, float(display.mWidth), float(display.mHeight) };
+    hwc_rect_t dst = { 0, 0, int(display.mWidth), int(display.mHeight) };
+    hwc_layer_1_t& target = contents.hwLayers[display.mLayers.size()];
+    setupLayer(target, display.mpTarget->handle, src, dst, HWC_BLENDING_PREMULT, bGeometryChanged);
+    target.compositionType = HWC_FRAMEBUFFER_TARGET;
+}
+
+// Close any fences returned by set, optionally waiting for retirement first.
+static void closeFences(WorkloadDisplay& display, bool bSync)
+{
+    hwc_display_contents_1_t& contents = *display.mpContents;
+    for (uint32_t ly = 0; ly < contents.numHwLayers; ++ly)
+    {
+        if (contents.hwLayers[ly].releaseFenceFd >= 0)
+        {
+            close(contents.hwLayers[ly].releaseFenceFd);
+            contents.hwLayers[ly].releaseFenceFd = -1;
+        }
+    }
+    if (contents.retireFenceFd >= 0)
+    {
+        if (bSync)
+            sync_wait(contents.retireFenceFd, cRetireTimeoutMs);
+        close(contents.retireFenceFd);
+        contents.retireFenceFd = -1;
+    }
+}
+
+static void setPower(hwc_composer_device_1_t* pDev, uint32_t d, bool bOn)
+{
+#if defined(HWC_DEVICE_API_VERSION_1_4)
+    pDev->setPowerMode(pDev, d, bOn ? HWC_POWER_MODE_NORMAL : HWC_POWER_MODE_OFF);
+#else
+    pDev->blank(pDev, d, bOn ? 0 : 1);
+#endif
+}
+
+static nsecs_t percentile(const std::vector<nsecs_t>& sorted, uint32_t pct)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min<size_t>((sorted.size() * pct) / 100, sorted.size() - 1)];
+}
+
+static void report(const char* pName, std::vector<nsecs_t>& times, nsecs_t period)
+{
+    if (times.empty())
+        return;
+
+    std::sort(times.begin(), times.end());
+    nsecs_t total = 0;
+    for (nsecs_t t : times)
+        total += t;
+
+    printf("%s: frames %zu min %.3fms avg %.3fms p50 %.3fms p90 %.3fms p99 %.3fms max %.3fms\n", pName,
+        times.size(), ns2us(times.front()) / 1000.0f, ns2us(total / times.size()) / 1000.0f,
+        ns2us(percentile(times, 50)) / 1000.0f, ns2us(percentile(times, 90)) / 1000.0f,
+        ns2us(percentile(times, 99)) / 1000.0f, ns2us(times.back()) / 1000.0f);
+
+    // Histogram in 1ms buckets up to two frame periods.
+    const uint32_t buckets = std::max<uint32_t>(uint32_t(ns2ms(2 * period)), 1);
+    std::vector<uint32_t> histogram(buckets + 1, 0);
+    for (nsecs_t t : times)
+        histogram[std::min<uint32_t>(uint32_t(ns2ms(t)), buckets)]++;
+    for (uint32_t b = 0; b <= buckets; ++b)
+    {
+        if (histogram[b])
+            printf("  %s%2ums %6u\n", (b == buckets) ? ">=" : "  ", b, histogram[b]);
+    }
+}
+
+static void usage()
+{
+    printf("Usage: hwcworkload [options]\n"
+           "Drives the HWC with synthetic content. Stop SurfaceFlinger first.\n"
+           "  --frames=N       Frames to run (600)\n"
+           "  --rate=FPS       Target frame rate (60)\n"
+           "  --layers=N       Layers per display (6)\n"
+           "  --video=N        Number of those layers that are NV12 video (1)\n"
+           "  --format=F       HAL format of UI layers (RGBA_8888)\n"
+           "  --scale=P        Percentage of UI layers that are scaled (0)\n"
+           "  --geometry=N     Move layers with a geometry change every N frames (0=never)\n"
+           "  --hotplug=N      Simulate an external hotplug toggle every N frames (0=never)\n"
+           "  --modechange=N   Cycle the primary display mode every N frames (0=never)\n"
+           "  --seed=S         Random seed (1)\n"
+           "  --sync           Wait for each frame to retire\n"
+           "  --quiet          Only report the summary\n");
+}
+
+int main(int argc, char** argv)
+{
+    WorkloadParams params;
+
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        const char* pArg = argv[argIndex];
+        if (strncmp(pArg, "--frames=", 9) == 0)
+            params.frames = atoi(pArg + 9);
+        else if (strncmp(pArg, "--rate=", 7) == 0)
+            params.rate = std::max(atoi(pArg + 7), 1);
+        else if (strncmp(pArg, "--layers=", 9) == 0)
+            params.layers = atoi(pArg + 9);
+        else if (strncmp(pArg, "--video=", 8) == 0)
+            params.video = atoi(pArg + 8);
+        else if (strncmp(pArg, "--format=", 9) == 0)
+            params.format = atoi(pArg + 9);
+        else if (strncmp(pArg, "--scale=", 8) == 0)
+            params.scale = atoi(pArg + 8);
+        else if (strncmp(pArg, "--geometry=", 11) == 0)
+            params.geometry = atoi(pArg + 11);
+        else if (strncmp(pArg, "--hotplug=", 10) == 0)
+            params.hotplug = atoi(pArg + 10);
+        else if (strncmp(pArg, "--modechange=", 13) == 0)
+            params.modechange = atoi(pArg + 13);
+        else if (strncmp(pArg, "--seed=", 7) == 0)
+            params.seed = atoi(pArg + 7);
+        else if (strcmp(pArg, "--sync") == 0)
+            params.bSync = true;
+        else if (strcmp(pArg, "--quiet") == 0)
+            params.bQuiet = true;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    const hw_module_t* pModule = NULL;
+    hwc_composer_device_1_t* pDev = NULL;
+    if ((hw_get_module(HWC_HARDWARE_MODULE_ID, &pModule) != 0) || (hwc_open_1(pModule, &pDev) != 0))
+    {
+        printf("Failed to open the HWC\n");
+        return 1;
+    }
+
+    // Hotplug simulation is exported by the HWC for validation.
+    typedef void (*SimulateHotPlugFunc)(bool connected);
+    SimulateHotPlugFunc pSimulateHotPlug = (SimulateHotPlugFunc)dlsym(pModule->dso, "hwcSimulateHotPlug");
+    if (params.hotplug && (pSimulateHotPlug == NULL))
+    {
+        printf("HWC does not support hotplug simulation\n");
+        params.hotplug = 0;
+    }
+
+    // The primary is always connected, other displays are reported through the hotplug callback.
+    sHotplugConnected |= (1 << HWC_DISPLAY_PRIMARY);
+    sHotplugPending |= (1 << HWC_DISPLAY_PRIMARY);
+    pDev->registerProcs(pDev, &sProcs);
+
+    WorkloadDisplay displays[cMaxDisplays];
+    hwc_display_contents_1_t* apContents[cMaxDisplays];
+    uint32_t seed = params.seed;
+
+    std::vector<nsecs_t> prepareTimes;
+    std::vector<nsecs_t> setTimes;
+    std::vector<nsecs_t> frameTimes;
+    prepareTimes.reserve(params.frames);
+    setTimes.reserve(params.frames);
+    frameTimes.reserve(params.frames);
+
+    const nsecs_t period = s2ns(1) / params.rate;
+    uint32_t missed = 0;
+    uint32_t hotplugs = 0;
+    uint32_t modeChanges = 0;
+    uint32_t geometryChanges = 0;
+    bool bExternalPlugged = false;
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    for (uint32_t frame = 0; frame < params.frames; ++frame)
+    {
+        const nsecs_t deadline = startTime + (frame + 1) * period;
+        bool bGeometryChanged = (frame == 0) || (params.geometry && ((frame % params.geometry) == 0));
+
+        // Hotplug storms toggle the external connection.
+        if (params.hotplug && frame && ((frame % params.hotplug) == 0))
+        {
+            bExternalPlugged = !bExternalPlugged;
+            pSimulateHotPlug(bExternalPlugged);
+            ++hotplugs;
+        }
+
+        // Mode changes cycle through the primary's configs.
+        WorkloadDisplay& primary = displays[HWC_DISPLAY_PRIMARY];
+        if (params.modechange && frame && ((frame % params.modechange) == 0) && (primary.mNumConfigs > 1))
+        {
+#if defined(HWC_DEVICE_API_VERSION_1_4)
+            uint32_t config = (primary.mConfig + 1) % primary.mNumConfigs;
+            if (pDev->setActiveConfig(pDev, HWC_DISPLAY_PRIMARY, config) == 0)
+            {
+                // Regenerate the primary content for the new mode.
+                destroyDisplay(primary);
+                sHotplugPending |= (1 << HWC_DISPLAY_PRIMARY);
+                ++modeChanges;
+            }
+#endif
+        }
+
+        // Process any connection changes.
+        uint32_t pending = sHotplugPending.exchange(0);
+        for (uint32_t d = 0; d < cMaxDisplays; ++d)
+        {
+            if (!(pending & (1 << d)))
+                continue;
+            destroyDisplay(displays[d]);
+            if (sHotplugConnected & (1 << d))
+            {
+                if (createDisplay(pDev, d, displays[d], params, seed))
+                    setPower(pDev, d, true);
+                else
+                    destroyDisplay(displays[d]);
+            }
+            bGeometryChanged = true;
+        }
+
+        // Move layers around on geometry changes.
+        if (bGeometryChanged && frame)
+        {
+            for (uint32_t d = 0; d < cMaxDisplays; ++d)
+            {
+                for (uint32_t ly = 1; ly < displays[d].mLayers.size(); ++ly)
+                {
+                    WorkloadLayer& layer = displays[d].mLayers[ly];
+                    placeLayer(layer, displays[d], layer.mDst.right - layer.mDst.left, layer.mDst.bottom - layer.mDst.top, seed);
+                }
+            }
+            ++geometryChanges;
+        }
+
+        for (uint32_t d = 0; d < cMaxDisplays; ++d)
+        {
+            apContents[d] = displays[d].mbConnected ? displays[d].mpContents : NULL;
+            if (apContents[d])
+                updateContents(displays[d], bGeometryChanged);
+        }
+
+        const nsecs_t frameStart = systemTime(SYSTEM_TIME_MONOTONIC);
+        pDev->prepare(pDev, cMaxDisplays, apContents);
+        const nsecs_t prepareEnd = systemTime(SYSTEM_TIME_MONOTONIC);
+        pDev->set(pDev, cMaxDisplays, apContents);
+        const nsecs_t setEnd = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        for (uint32_t d = 0; d < cMaxDisplays; ++d)
+        {
+            if (apContents[d])
+                closeFences(displays[d], params.bSync);
+        }
+        const nsecs_t frameEnd = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        prepareTimes.push_back(prepareEnd - frameStart);
+        setTimes.push_back(setEnd - prepareEnd);
+        frameTimes.push_back(frameEnd - frameStart);
+
+        if (frameEnd > deadline)
+        {
+            ++missed;
+            if (!params.bQuiet)
+                printf("Frame %u missed its deadline by %.3fms (prepare %.3fms set %.3fms)\n", frame,
+                    ns2us(frameEnd - deadline) / 1000.0f, ns2us(prepareEnd - frameStart) / 1000.0f, ns2us(setEnd - prepareEnd) / 1000.0f);
+        }
+        else
+        {
+            // Pace to the target rate.
+            usleep(ns2us(deadline - frameEnd));
+        }
+    }
+
+    const nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    printf("Ran %u frames in %.3fs at target %u fps: missed %u deadlines, %u geometry changes, %u hotplugs, %u mode changes, %u vsyncs, %u invalidates\n",
+        params.frames, ns2ms(elapsed) / 1000.0f, params.rate, missed, geometryChanges, hotplugs, modeChanges,
+        sVsyncs.load(), sInvalidates.load());
+    report("prepare", prepareTimes, period);
+    report("set", setTimes, period);
+    report(params.bSync ? "frame (to retire)" : "frame", frameTimes, period);
+
+    // Leave the external disconnected again.
+    if (bExternalPlugged)
+        pSimulateHotPlug(false);
+
+    for (uint32_t d = 0; d < cMaxDisplays; ++d)
+        destroyDisplay(displays[d]);
+    pDev->common.close(&pDev->common);
+    return 0;
+}
@@ -117,12 +117,13 @@ VpgBufferManager::Buffer::Buffer( GrallocClient& gralloc, Drm& drm, buffer_handl
 #if INTEL_HWC_INTERNAL_BUILD
     mAccessed( 0 ),
 #endif
-    mbOrphaned( false ),
     mbDeviceIdAllocFailed( false ),
     mbDmaBufFromPrime( false ),
     mbPurged( false ),
+    mbOrphaned( false ),
     mSurfaceFlingerRT( -1 ),
-    mUsageFlags(0)
+    mUsageFlags(0),
+    mContentAlpha( eContentAlpha_Unknown )
 {
     if ( pBi )
     {
@@ -171,6 +172,7 @@ void VpgBufferManager::Buffer::setPrime( void )
 
 uint32_t VpgBufferManager::Buffer::purge( void )
 {
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
 #if INTEL_UFO_HWC_WANT_PURGE
     int32_t m1 = getFreeMemory();
 #if INTEL_UFO_HWC_HAVE_FALLOC
@@ -203,6 +205,7 @@ uint32_t VpgBufferManager::Buffer::purge( void )
 
 uint32_t VpgBufferManager::Buffer::realize( void )
 {
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
 #if INTEL_UFO_HWC_WANT_PURGE
     int32_t m1 = getFreeMemory();
 #if INTEL_UFO_HWC_HAVE_FALLOC
@@ -258,7 +261,7 @@ String8 VpgBufferManager::Buffer::dump( bool bExpand )
               " prime %3d [Gralloc prime %d]"
               " hwc bo %3u fb %3u/%3u dmaBuf %3d"
               " setInfo %d bytes %5d KB deviceIdAllocFailed %d"
-              " refs %u status %s|%s|%s [LU:%5u] %s",
+              " refs %u status %s|%s|%s|%s [LU:%5u] %s",
               // Key handles and optional expanded description
               this, mHandle, expand.string(),
               mPrimeFd, mInfo.prime,
@@ -272,6 +275,7 @@ String8 VpgBufferManager::Buffer::dump( bool bExpand )
               mbOrphaned ? "O" : "-",
               mbPurged ? "P" : "-",
               mSurfaceFlingerRT >= 0 ? String8::format( "S%d", mSurfaceFlingerRT ).string() : "--",
+              mContentAlpha == eContentAlpha_Opaque ? "OP" : mContentAlpha == eContentAlpha_Translucent ? "TR" : "--",
               // Usage
               mLastUsedFrame,
               // Descriptor
@@ -306,6 +310,160 @@ VpgBufferManager::~VpgBufferManager( )
 {
 }
 
+VpgBufferManager::BufferRegistry::BufferRegistry( )
+{
+}
+
+uint32_t VpgBufferManager::BufferRegistry::hash( buffer_handle_t handle )
+{
+    // Handles are heap pointers; mix the bits so that alignment does not bias the stripes/slots.
+    uint64_t h = (uint64_t)(uintptr_t)handle;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+uint32_t VpgBufferManager::BufferRegistry::probe( const Stripe& stripe, uint32_t h, buffer_handle_t handle )
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( stripe.mLock );
+    ALOG_ASSERT( stripe.mEntries.size( ) );
+    // The low bits select the stripe so use the higher bits for the slot.
+    const uint32_t mask = stripe.mEntries.size( ) - 1;
+    uint32_t slot = ( h / cStripes ) & mask;
+    while ( ( stripe.mEntries[ slot ].mHandle != NULL ) && ( stripe.mEntries[ slot ].mHandle != handle ) )
+    {
+        slot = ( slot + 1 ) & mask;
+    }
+    return slot;
+}
+
+void VpgBufferManager::BufferRegistry::rehash( Stripe& stripe, uint32_t slots )
+{
+    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( stripe.mLock );
+    std::vector<Entry> entries( slots );
+    entries.swap( stripe.mEntries );
+    for ( const Entry& entry : entries )
+    {
+        if ( entry.mHandle != NULL )
+        {
+            stripe.mEntries[ probe( stripe, hash( entry.mHandle ), entry.mHandle ) ] = entry;
+        }
+    }
+}
+
+sp<VpgBufferManager::Buffer> VpgBufferManager::BufferRegistry::find( buffer_handle_t handle ) const
+{
+    const uint32_t h = hash( handle );
+    const Stripe& stripe = getStripe( h );
+    Mutex::Autolock _l( stripe.mLock );
+    ++stripe.mLookups;
+    if ( stripe.mCount == 0 )
+    {
+        return NULL;
+    }
+    return stripe.mEntries[ probe( stripe, h, handle ) ].mpBuffer;
+}
+
+sp<VpgBufferManager::Buffer> VpgBufferManager::BufferRegistry::add( buffer_handle_t handle, const sp<Buffer>& pBuffer )
+{
+    ALOG_ASSERT( handle );
+    const uint32_t h = hash( handle );
+    Stripe& stripe = getStripe( h );
+    Mutex::Autolock _l( stripe.mLock );
+    // Keep the load factor at most 1/2 so probe sequences stay short.
+    if ( ( stripe.mCount + 1 ) * 2 > stripe.mEntries.size( ) )
+    {
+        rehash( stripe, stripe.mEntries.size( ) ? stripe.mEntries.size( ) * 2 : cInitialSlots );
+    }
+    Entry& entry = stripe.mEntries[ probe( stripe, h, handle ) ];
+    sp<Buffer> pReplaced = entry.mpBuffer;
+    if ( entry.mHandle == NULL )
+    {
+        entry.mHandle = handle;
+        ++stripe.mCount;
+    }
+    entry.mpBuffer = pBuffer;
+    return pReplaced;
+}
+
+sp<VpgBufferManager::Buffer> VpgBufferManager::BufferRegistry::remove( buffer_handle_t handle )
+{
+    const uint32_t h = hash( handle );
+    Stripe& stripe = getStripe( h );
+    Mutex::Autolock _l( stripe.mLock );
+    sp<Buffer> pRemoved;
+    if ( stripe.mCount )
+    {
+        const uint32_t mask = stripe.mEntries.size( ) - 1;
+        uint32_t slot = probe( stripe, h, handle );
+        if ( stripe.mEntries[ slot ].mHandle != NULL )
+        {
+            pRemoved = stripe.mEntries[ slot ].mpBuffer;
+            --stripe.mCount;
+
+            // Backward shift deletion: move any following entries of the probe run into the
+            // hole so that lookups never need tombstones.
+            uint32_t next = ( slot + 1 ) & mask;
+            while ( stripe.mEntries[ next ].mHandle != NULL )
+            {
+                const uint32_t home = ( hash( stripe.mEntries[ next ].mHandle ) / cStripes ) & mask;
+                // Move the entry if its home slot is not cyclically within (slot, next].
+                if ( ( ( next - home ) & mask ) >= ( ( next - slot ) & mask ) )
+                {
+                    stripe.mEntries[ slot ] = stripe.mEntries[ next ];
+                    slot = next;
+                }
+                next = ( next + 1 ) & mask;
+            }
+            stripe.mEntries[ slot ] = Entry( );
+        }
+    }
+    return pRemoved;
+}
+
+void VpgBufferManager::BufferRegistry::getAll( std::vector< sp<Buffer> >& buffers ) const
+{
+    buffers.clear( );
+    for ( const Stripe& stripe : mStripes )
+    {
+        Mutex::Autolock _l( stripe.mLock );
+        for ( const Entry& entry : stripe.mEntries )
+        {
+            if ( entry.mHandle != NULL )
+            {
+                buffers.push_back( entry.mpBuffer );
+            }
+        }
+    }
+}
+
+uint32_t VpgBufferManager::BufferRegistry::size( void ) const
+{
+    uint32_t count = 0;
+    for ( const Stripe& stripe : mStripes )
+    {
+        Mutex::Autolock _l( stripe.mLock );
+        count += stripe.mCount;
+    }
+    return count;
+}
+
+String8 VpgBufferManager::BufferRegistry::dump( void ) const
+{
+    uint32_t count = 0, slots = 0, lookups = 0, maxCount = 0;
+    for ( const Stripe& stripe : mStripes )
+    {
+        Mutex::Autolock _l( stripe.mLock );
+        count += stripe.mCount;
+        slots += stripe.mEntries.size( );
+        lookups += stripe.mLookups;
+        maxCount = max( maxCount, stripe.mCount );
+    }
+    return String8::format( "Registry: Stripes:%u Buffers:%u Slots:%u MaxPerStripe:%u Lookups:%u",
+        cStripes, count, slots, maxCount, lookups );
+}
+
 void VpgBufferManager::registerTracker( Tracker& tracker )
 {
     HWC_UNUSED( tracker );
@@ -558,6 +716,8 @@ void VpgBufferManager::setBufferUsage( buffer_handle_t handle, BufferUsage usage
     sp<Buffer> pBuffer = acquireCompleteBuffer( handle );
     if (pBuffer != NULL)
     {
+        // Usage is consumed and cleared by processBufferHints.
+        Mutex::Autolock _l( mLock );
         pBuffer->mUsageFlags |= (1 << usage);
     }
 }
@@ -630,13 +790,14 @@ ECompressionType VpgBufferManager::getSurfaceFlingerCompression()
 String8 VpgBufferManager::dump( void )
 {
     Mutex::Autolock _l( mLock );
-    uint32_t countBuffers = mManagedBuffers.size();
+    std::vector< sp<Buffer> > buffers;
+    mManagedBuffers.getAll( buffers );
+    uint32_t countBuffers = buffers.size();
     uint32_t totalBytes = 0, totalRealizedBytes = 0, countPurged = 0, countSFRTs = 0;
     String8 output("");
     output += String8::format( "Hardware Composer Managed Buffers:\n" );
-    for ( auto pair : mManagedBuffers )
+    for ( const sp<Buffer>& pBuffer : buffers )
     {
-        auto pBuffer = pair.second;
         output += String8::format( "%s\n", pBuffer->dump( true ).string() );
         if ( pBuffer->mbSetInfo )
         {
@@ -652,17 +813,16 @@ String8 VpgBufferManager::dump( void )
     }
     output += String8::format( "Frame:%u Buffers:%u Bytes:%u KB SFRTs:%u Purged:%u %u KB Realized:%u KB\n",
         mFrameCounter, countBuffers, totalBytes/1024, countSFRTs, countPurged, (totalBytes-totalRealizedBytes)/1024, totalRealizedBytes/1024 );
+    output += mManagedBuffers.dump( ) + "\n";
     return output;
 }
 
 void VpgBufferManager::notifyBufferAlloc( buffer_handle_t handle, const intel_ufo_buffer_details_t* pBi )
 {
     ALOG_ASSERT( handle );
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
 
     Log::alogd( BUFFER_MANAGER_DEBUG, "BufferManager: Notification alloc buffer handle %p", handle );
     {
-        Mutex::Autolock _l( mLock );
 #if INTEL_UFO_GRALLOC_HAVE_BUFFER_DETAILS_1 && (INTEL_UFO_GRALLOC_BUFFER_DETAILS_LEVEL < 1)
         // intel_ufo_buffer_details_t is not intel_ufo_buffer_details_1_t
         addBuffer( handle, NULL );
@@ -689,17 +849,9 @@ void VpgBufferManager::notifyBufferAlloc( buffer_handle_t handle, const intel_uf
 void VpgBufferManager::notifyBufferFree( buffer_handle_t handle )
 {
     ALOG_ASSERT( handle );
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
 
     Log::alogd( BUFFER_MANAGER_DEBUG, "BufferManager: Notification free buffer handle %p", handle );
-    {
-        Mutex::Autolock _l( mLock );
-        const sp<Buffer> pBuffer = mManagedBuffers[handle];
-        if ( pBuffer != NULL )
-        {
-            removeBuffer( handle );
-        }
-    }
+    removeBuffer( handle );
 
     // Forward notification to trackers.
     {
@@ -718,7 +870,6 @@ void VpgBufferManager::notifyBufferFree( buffer_handle_t handle )
 bool VpgBufferManager::getBufferDetails( buffer_handle_t handle, bool bBlend, buffer_details_t& bi, uint64_t& deviceId, bool& bufferDeviceIdValid, ETilingFormat& tilingFormat)
 {
     ALOG_ASSERT( handle );
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
 
     bufferDeviceIdValid = false;
     deviceId = 0;
@@ -776,6 +927,7 @@ void VpgBufferManager::setSurfaceFlingerRT( buffer_handle_t handle, uint32_t dis
     sp<VpgBufferManager::Buffer> pBuffer = acquireCompleteBuffer( handle );
     if ( pBuffer != NULL )
     {
+        Mutex::Autolock _l( mLock );
         // We do not expect a SF buffer to be tagged as an RT on multiple displays.
         ALOG_ASSERT( ( pBuffer->mSurfaceFlingerRT == -1 )
                   || ( (uint32_t)pBuffer->mSurfaceFlingerRT == displayIndex ) );
@@ -785,37 +937,43 @@ void VpgBufferManager::setSurfaceFlingerRT( buffer_handle_t handle, uint32_t dis
 
 void VpgBufferManager::purgeSurfaceFlingerRenderTargets( uint32_t displayIndex )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
-    Mutex::Autolock _l( mLock );
     int32_t m1 = getFreeMemory();
     uint32_t changes = 0, memory = 0;
 
-    for ( auto pair : mManagedBuffers )
+    // Pick candidates with the lock held.
+    // Purging calls Gralloc so it is made with only the buffer lock held.
+    std::vector< sp<Buffer> > candidates;
     {
-        auto pBuffer = pair.second;
-        if ( (uint32_t)pBuffer->mSurfaceFlingerRT != displayIndex )
-            continue;
-        if ( pBuffer->mbPurged )
-            continue;
-        // Never purge a buffer that is still referenced.
-        // NOTE:
-        // Refs will be at least
-        //   1 for the mManagedBuffers[] ref
-        //  +1 for *this* pBuffer referfence.
-        if ( pBuffer->getStrongCount() > 2 )
-            continue;
-        uint32_t elapsedFramesSinceUsed = (uint32_t)int32_t( mFrameCounter - pBuffer->mLastUsedFrame );
-        if ( elapsedFramesSinceUsed >= mPurgeSurfaceFlingerRTThreshold )
+        Mutex::Autolock _l( mLock );
+        std::vector< sp<Buffer> > buffers;
+        mManagedBuffers.getAll( buffers );
+        for ( const sp<Buffer>& pBuffer : buffers )
         {
-            mLock.unlock();
-            memory += pBuffer->purge();
-            mLock.lock();
-            ++changes;
-            // Current policy is to purge at most one buffer per frame.
-            // This is to distribute the work.
-            break;
+            if ( (uint32_t)pBuffer->mSurfaceFlingerRT != displayIndex )
+                continue;
+            // Never purge a buffer that is still referenced.
+            // NOTE:
+            // Refs will be at least
+            //   1 for the mManagedBuffers ref
+            //  +1 for the buffers[] snapshot reference.
+            if ( pBuffer->getStrongCount() > 2 )
+                continue;
+            uint32_t elapsedFramesSinceUsed = (uint32_t)int32_t( mFrameCounter - pBuffer->mLastUsedFrame );
+            if ( elapsedFramesSinceUsed >= mPurgeSurfaceFlingerRTThreshold )
+                candidates.push_back( pBuffer );
         }
     }
+    for ( const sp<Buffer>& pBuffer : candidates )
+    {
+        Mutex::Autolock _b( pBuffer->mLock );
+        if ( pBuffer->mbPurged )
+            continue;
+        memory += pBuffer->purge();
+        ++changes;
+        // Current policy is to purge at most one buffer per frame.
+        // This is to distribute the work.
+        break;
+    }
     if ( changes )
     {
         int32_t m2 = getFreeMemory();
@@ -828,21 +986,30 @@ void VpgBufferManager::purgeSurfaceFlingerRenderTargets( uint32_t displayIndex )
 
 void VpgBufferManager::realizeSurfaceFlingerRenderTargets( uint32_t displayIndex )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
-    Mutex::Autolock _l( mLock );
     int32_t m1 = getFreeMemory();
     uint32_t changes = 0, memory = 0;
-    for ( auto pair : mManagedBuffers )
+
+    // Collect this display's RTs with the lock held.
+    // Realizing calls Gralloc so it is made with only the buffer lock held.
+    std::vector< sp<Buffer> > rts;
     {
-        auto pBuffer = pair.second;
-        if ( (uint32_t)pBuffer->mSurfaceFlingerRT != displayIndex )
-            continue;
-        pBuffer->mLastUsedFrame = mFrameCounter;
+        Mutex::Autolock _l( mLock );
+        std::vector< sp<Buffer> > buffers;
+        mManagedBuffers.getAll( buffers );
+        for ( const sp<Buffer>& pBuffer : buffers )
+        {
+            if ( (uint32_t)pBuffer->mSurfaceFlingerRT != displayIndex )
+                continue;
+            pBuffer->mLastUsedFrame = mFrameCounter;
+            rts.push_back( pBuffer );
+        }
+    }
+    for ( const sp<Buffer>& pBuffer : rts )
+    {
+        Mutex::Autolock _b( pBuffer->mLock );
         if ( !pBuffer->mbPurged )
             continue;
-        mLock.unlock();
         memory += pBuffer->realize();
-        mLock.lock();
         ++changes;
     }
     if ( changes )
@@ -858,26 +1025,52 @@ void VpgBufferManager::realizeSurfaceFlingerRenderTargets( uint32_t displayIndex
 
 uint32_t VpgBufferManager::purgeBuffer( buffer_handle_t handle )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
     sp<VpgBufferManager::Buffer> pBuffer = acquireCompleteBuffer( handle, NULL );
-    if ( ( pBuffer != NULL ) && !pBuffer->mbPurged )
+    if ( pBuffer != NULL )
     {
-        return pBuffer->purge();
+        Mutex::Autolock _b( pBuffer->mLock );
+        if ( !pBuffer->mbPurged )
+        {
+            return pBuffer->purge();
+        }
     }
     return 0;
 }
 
 uint32_t VpgBufferManager::realizeBuffer( buffer_handle_t handle )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
     sp<VpgBufferManager::Buffer> pBuffer = acquireCompleteBuffer( handle, NULL );
-    if ( ( pBuffer != NULL ) && pBuffer->mbPurged )
+    if ( pBuffer != NULL )
     {
-        return pBuffer->realize();
+        Mutex::Autolock _b( pBuffer->mLock );
+        if ( pBuffer->mbPurged )
+        {
+            return pBuffer->realize();
+        }
     }
     return 0;
 }
 
+void VpgBufferManager::setBufferContentAlpha( buffer_handle_t handle, EContentAlpha alpha )
+{
+    // Only buffers in the managed set are tracked; 'jit' records would be lost immediately.
+    const sp<Buffer> pBuffer = mManagedBuffers.find( handle );
+    if ( pBuffer != NULL )
+    {
+        pBuffer->mContentAlpha = alpha;
+    }
+}
+
+AbstractBufferManager::EContentAlpha VpgBufferManager::getBufferContentAlpha( buffer_handle_t handle )
+{
+    const sp<Buffer> pBuffer = mManagedBuffers.find( handle );
+    if ( pBuffer != NULL )
+    {
+        return pBuffer->mContentAlpha;
+    }
+    return eContentAlpha_Unknown;
+}
+
 #if HAVE_GRALLOC_RC_API
 bool VpgBufferManager::getResolveDetails( buffer_handle_t handle, intel_ufo_buffer_resolve_details_t& rd )
 {
@@ -898,15 +1091,17 @@ bool VpgBufferManager::getResolveDetails( buffer_handle_t handle, intel_ufo_buff
 void VpgBufferManager::validateCache( bool bEndOfFrame )
 {
     Mutex::Autolock _l( mLock );
+    std::vector< sp<Buffer> > buffers;
+    mManagedBuffers.getAll( buffers );
 
     uint32_t accessed = 0;
     uint32_t totalLookups = 0;
 
-    ALOGD_IF( BUFFER_MANAGER_DEBUG, "Buffer manager x%zu buffers", mManagedBuffers.size( ) );
+    ALOGD_IF( BUFFER_MANAGER_DEBUG, "Buffer manager x%zu buffers", buffers.size( ) );
 
-    for ( auto i = mManagedBuffers.begin(); i != mManagedBuffers.end(); ++i )
+    for ( auto i = buffers.begin(); i != buffers.end(); ++i )
     {
-        auto pBi = i->second;
+        auto pBi = *i;
         ALOGD_IF( BUFFER_MANAGER_DEBUG,
                   "Buffer manager buffer %s was accessed x%u",
                   pBi->dump().string(),
@@ -916,9 +1111,9 @@ void VpgBufferManager::validateCache( bool bEndOfFrame )
             ++accessed;
         totalLookups += pBi->mAccessed;
 
-        for ( auto j = std::next(i,1); j != mManagedBuffers.end(); ++j )
+        for ( auto j = std::next(i,1); j != buffers.end(); ++j )
         {
-            auto pBj = j->second;
+            auto pBj = *j;
             // Assert that handles are unique.
             ALOG_ASSERT( ( pBi->mHandle != pBj->mHandle ),
                 "Buffer manager validation error - Gralloc handles not unique\ni %s v\nj %s", pBi->dump().string(), pBj->dump().string() );
@@ -955,16 +1150,13 @@ void VpgBufferManager::validateCache( bool bEndOfFrame )
 
 sp<VpgBufferManager::Buffer> VpgBufferManager::acquireCompleteBuffer( buffer_handle_t handle, bool* pbBlend )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
     ALOG_ASSERT( handle );
 
 #if INTEL_HWC_INTERNAL_BUILD
     validateCache( );
 #endif
 
-    Mutex::Autolock _l( mLock );
-
-    const sp<VpgBufferManager::Buffer> pBuffer = mManagedBuffers[handle];
+    const sp<VpgBufferManager::Buffer> pBuffer = mManagedBuffers.find( handle );
     sp<VpgBufferManager::Buffer> pUpdateBuffer = NULL;
     if ( pBuffer == NULL )
     {
@@ -986,6 +1178,13 @@ sp<VpgBufferManager::Buffer> VpgBufferManager::acquireCompleteBuffer( buffer_han
         pUpdateBuffer = pBuffer;
     }
 
+    // Completion runs under the buffer lock only so the lookup above stays off the manager lock.
+    // This serializes completion with purge/realize of this buffer. Orphaning is not covered:
+    // add/removeBuffer set mbOrphaned under the manager lock, so the record may be orphaned
+    // while we complete it. That is benign; our reference keeps it alive and completion
+    // neither reads mbOrphaned nor touches the registry.
+    Mutex::Autolock _b( pUpdateBuffer->mLock );
+
 #if INTEL_HWC_INTERNAL_BUILD
     ++pUpdateBuffer->mAccessed;
 #endif
@@ -996,17 +1195,12 @@ sp<VpgBufferManager::Buffer> VpgBufferManager::acquireCompleteBuffer( buffer_han
       || ( pbBlend && (( *pbBlend && !pUpdateBuffer->mFbBlend )
       || ( !*pbBlend && !pUpdateBuffer->mFbOpaque ))))
     {
-        // Release lock while calling Gralloc to avoid risk of deadlock.
-        mLock.unlock( );
         completeDetails( pUpdateBuffer, handle, pbBlend );
-        mLock.lock( );
     }
 #if INTEL_HWC_INTERNAL_BUILD
     else
     {
-        mLock.unlock( );
         validateDetails( pUpdateBuffer, handle );
-        mLock.lock( );
     }
 #endif
 
@@ -1018,22 +1212,30 @@ sp<VpgBufferManager::Buffer> VpgBufferManager::addBuffer( buffer_handle_t handle
                                                  const buffer_details_t* pBi )
 {
     ALOG_ASSERT( handle );
-    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
-
-    if ( mManagedBuffers[handle] != NULL )
-    {
-        ALOGE( "Buffer manager add buffer handle %p for existing buffer - removing previous instance", handle );
-        removeBuffer( handle );
-    }
 
     sp<Buffer> pNewBuffer = new Buffer( mGralloc, Drm::get(), handle, pBi );
     if ( pNewBuffer == NULL )
     {
         ALOGE( "Failed to create managed buffer" );
+        removeBuffer( handle );
         return NULL;
     }
 
-    mManagedBuffers[handle] = pNewBuffer;
+    // The replaced buffer is released (and possibly destroyed) after the lock is dropped.
+    sp<Buffer> pPrevious;
+    {
+        Mutex::Autolock _l( mLock );
+        pPrevious = mManagedBuffers.add( handle, pNewBuffer );
+        if ( pPrevious != NULL )
+        {
+            ALOGE( "Buffer manager add buffer handle %p for existing buffer - removing previous instance", handle );
+            pPrevious->mbOrphaned = true;
+        }
+    }
+    if ( pPrevious != NULL )
+    {
+        Log::alogd( BUFFER_MANAGER_DEBUG, "BufferManager: Orphaning managed buffer %s", pPrevious->dump().string() );
+    }
 
     return pNewBuffer;
 }
@@ -1041,18 +1243,23 @@ sp<VpgBufferManager::Buffer> VpgBufferManager::addBuffer( buffer_handle_t handle
 void VpgBufferManager::removeBuffer( buffer_handle_t handle )
 {
     ALOG_ASSERT( handle );
-    INTEL_UFO_HWC_ASSERT_MUTEX_HELD( mLock );
 
-    sp<VpgBufferManager::Buffer> pDeleteBuffer = mManagedBuffers[handle];
-    ALOG_ASSERT( pDeleteBuffer != NULL );
-    mManagedBuffers.erase(handle);
-    pDeleteBuffer->mbOrphaned = true;
+    // The removed buffer is released (and possibly destroyed) after the lock is dropped.
+    sp<VpgBufferManager::Buffer> pDeleteBuffer;
+    {
+        Mutex::Autolock _l( mLock );
+        pDeleteBuffer = mManagedBuffers.remove( handle );
+        if ( pDeleteBuffer == NULL )
+        {
+            return;
+        }
+        pDeleteBuffer->mbOrphaned = true;
+    }
     Log::alogd( BUFFER_MANAGER_DEBUG, "BufferManager: Orphaning managed buffer %s", pDeleteBuffer->dump().string() );
 }
 
 void VpgBufferManager::completeDetails( sp<Buffer> pBuffer, buffer_handle_t handle, bool* pbBlend )
 {
-    INTEL_UFO_HWC_ASSERT_MUTEX_NOT_HELD( mLock );
     ALOG_ASSERT( pBuffer != NULL );
 
     // Complete info.
@@ -1226,17 +1433,19 @@ void VpgBufferManager::processBufferHints( )
 
     // Process managed buffers with lock held.
     mLock.lock();
-    numBuffers = mManagedBuffers.size( );
+    std::vector< sp<Buffer> > buffers;
+    mManagedBuffers.getAll( buffers );
+    numBuffers = buffers.size( );
     BufferHint *bufferHints = new BufferHint[ numBuffers ];
     if( bufferHints == NULL )
     {
+        mLock.unlock();
         ALOGE("VpgBufferManager::processBufferHints - failed to allocate memory!");
         return;
     }
 
-    for ( auto pair : mManagedBuffers )
+    for ( const sp<Buffer>& pBuffer : buffers )
     {
-        auto pBuffer = pair.second;
         if (pBuffer->mUsageFlags != 0)
         {
             ECompressionType comp = ECompressionType::GL_RC;
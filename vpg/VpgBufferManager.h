@@ -164,6 +164,14 @@ public:
     // Returns zero if the call fails or is not implemented.
     virtual uint32_t realizeBuffer( buffer_handle_t handle );
 
+    // Implements AbstractBufferManager.
+    // Record the result of analysing a buffer's current content.
+    virtual void setBufferContentAlpha( buffer_handle_t handle, EContentAlpha alpha );
+
+    // Implements AbstractBufferManager.
+    // Get the result last recorded by setBufferContentAlpha.
+    virtual EContentAlpha getBufferContentAlpha( buffer_handle_t handle );
+
     // Implements AbstractBufferManager.
     // Dump info about the buffermanager.
     virtual String8 dump( void );
@@ -246,23 +254,90 @@ private:
         bool                        mbAlpha:1;      // Is alpha blending format required.
         // Flags to indicate the immutable state have been retrieved.
         bool                        mbSetInfo:1;    // Have the buffer details been retrieved?
-        bool                        mbOrphaned:1;   // Has the buffer been removed from the manager set?
         bool                        mbDeviceIdAllocFailed:1;// Initial attempt to allocate fb/dmabuf handles failed
                                                             // (implies that this buffer must be composed)
         bool                        mbDmaBufFromPrime:1;    // When true, mDmaBuf comes from Gralloc prime.
         bool                        mbPurged:1;             // Is this buffer purged?
+        // Not a bitfield: this is set under the manager lock while the buffer lock may be held
+        // by another thread completing, purging or realizing the same buffer.
+        bool                        mbOrphaned;     // Has the buffer been removed from the manager set?
+        Mutex                       mLock;          // Serialises completion, purge and realize.
         int32_t                     mSurfaceFlingerRT;      // Is this buffer a SF RT? (==displayIndex or -1 if not a SF RT).
         uint32_t                    mUsageFlags;    // Flags specifying where a buffer has been used.
+        EContentAlpha               mContentAlpha;  // Cached analysis of the current content.
 
         // Purge the buffer - releasing physical memory.
         // Returns size in bytes of memory released.
+        // The buffer lock must be held.
         uint32_t purge( void );
 
         // Realize the buffer - acquiring physical memory.
         // Returns size in bytes of memory acquired.
+        // The buffer lock must be held.
         uint32_t realize( void );
     };
 
+    // Set of managed buffers keyed by Gralloc handle.
+    // Lookups come from SF prepare, composition threads and DisplayQueue workers concurrently,
+    // so rather than one lock the handles are spread across stripes, each with its own lock
+    // and its own open-addressing (linear probing) hash table.
+    // The registry only makes individual operations safe; VpgBufferManager::mLock serialises
+    // add/replace/remove and walks of the whole set.
+    class BufferRegistry
+    {
+    public:
+        BufferRegistry( );
+
+        // Find the buffer for handle. Returns NULL if it is not managed.
+        sp<Buffer> find( buffer_handle_t handle ) const;
+
+        // Add a buffer for handle. Returns any buffer that it replaced.
+        sp<Buffer> add( buffer_handle_t handle, const sp<Buffer>& pBuffer );
+
+        // Remove the buffer for handle. Returns the removed buffer or NULL if not managed.
+        sp<Buffer> remove( buffer_handle_t handle );
+
+        // Take references to every managed buffer (no locks are held on return).
+        void getAll( std::vector< sp<Buffer> >& buffers ) const;
+
+        uint32_t size( void ) const;
+        String8 dump( void ) const;
+
+    private:
+        // Number of lock stripes (power of 2).
+        static const uint32_t cStripes = 16;
+        // Initial table size for each stripe (power of 2).
+        static const uint32_t cInitialSlots = 16;
+
+        struct Entry
+        {
+            Entry( ) : mHandle( NULL ) { }
+            buffer_handle_t     mHandle;            // NULL if the slot is free.
+            sp<Buffer>          mpBuffer;
+        };
+
+        struct Stripe
+        {
+            Stripe( ) : mCount( 0 ), mLookups( 0 ) { }
+            mutable Mutex       mLock;
+            std::vector<Entry>  mEntries;           // Open-addressing table, size is 0 or a power of 2.
+            uint32_t            mCount;             // Occupied slots.
+            mutable uint32_t    mLookups;           // Statistics: finds.
+        };
+
+        static uint32_t hash( buffer_handle_t handle );
+        Stripe& getStripe( uint32_t hash ) const    { return mStripes[ hash & ( cStripes - 1 ) ]; }
+
+        // Return the slot index holding handle or the free slot where it would be inserted.
+        // The stripe must be locked and have a non-empty table.
+        static uint32_t probe( const Stripe& stripe, uint32_t hash, buffer_handle_t handle );
+
+        // Resize the stripe table to slots entries. The stripe must be locked.
+        static void rehash( Stripe& stripe, uint32_t slots );
+
+        mutable Stripe      mStripes[ cStripes ];
+    };
+
     // When Gralloc creates a buffer we need to be notified.
     // This will add the buffer to the set of managed buffers.
     // intel_ufo_buffer_details_t can be specified in pBi if it is known; it will be retrieved if pBi is NULL.
@@ -316,28 +391,26 @@ private:
     // Acquire the managed buffer for this handle, adding it to the managed set if necessary.
     // The fixed buffer state (info, bo, fb, dmaBuf) will be completed for the returned buffer.
     // Fb creation requires knowledge of the blending requirement - pbBlend must be provided to generate the fb.
-    // The lock MUST NOT be held when calling this.
     // Returns the managed buffer if successful.
     // Returns NULL if not successful.
     sp<Buffer> acquireCompleteBuffer( buffer_handle_t handle, bool* pbBlend = NULL );
 
     // Add a new buffer to the set of managed buffers.
     // buffer_details_t can be specified in pBi if it is known.
-    // The lock MUST be held when calling this.
     // Returns the managed buffer if successful.
     // Returns NULL if not successful.
     sp<Buffer> addBuffer( buffer_handle_t handle, const buffer_details_t* pBi = NULL );
 
     // Remove an existing buffer.
-    // The lock MUST be held when calling this.
     void removeBuffer( buffer_handle_t handle );
 
     // Complete managed buffer details (info, bo, fb, dmaBuf).
     // Fb creation requires knowledge of the blending requirement - pbBlend must be provided to generate the fb.
-    // The lock MUST NOT be held when calling this.
+    // The buffer lock must be held.
     void completeDetails( sp<Buffer> pBuffer, buffer_handle_t handle, bool* pbBlend );
 #if INTEL_HWC_INTERNAL_BUILD
     // Asserts a complete buffer's details have not changed.
+    // The buffer lock must be held.
     void validateDetails( sp<Buffer> pBuffer, buffer_handle_t handle );
 #endif
 
@@ -352,9 +425,10 @@ private:
     Drm&            mDrm;                   // Drm cached in C'tor.
     GrallocClient&  mGralloc;               // Gralloc client cached in C'tor.
     GrallocCallbacks mGrallocCallbacks;     // Callback structure registered with Gralloc.
-    Mutex           mLock;                  // Lock for public entry points - to protect managed set list.
+    Mutex           mLock;                  // Lock for registry add/remove and whole-registry walks.
+                                            // Never held across Gralloc calls (see notifyBufferFree).
     Mutex           mTrackerLock;           // Lock for tracker register/deregister/notifications.
-    std::map<buffer_handle_t, sp<Buffer> > mManagedBuffers;   // Set of currently managed buffers (cached state).
+    BufferRegistry  mManagedBuffers;        // Set of currently managed buffers (cached state).
     std::vector<Tracker*> mTrackers;        // Set of registered trackers.
     uint32_t        mFrameCounter;          // Incrementing counter used to timestamp accesses (frame).
 